@@ -60,8 +60,6 @@
 #include "larevt/CalibrationDBI/Interface/ChannelStatusService.h"
 #include "larevt/CalibrationDBI/Interface/ChannelStatusProvider.h"
 
-#include "larevt/SpaceCharge/SpaceCharge.h"
-
 // ROOT includes. Note: To look up the properties of the ROOT classes,
 // use the ROOT web site; e.g.,
 // <http://root.cern.ch/root/html532/ClassIndex.html>
@@ -86,12 +84,15 @@
 
 // Laser Module Classes
 // #include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserDistortionMap.h"
+#include "LaserObjects/LaserMapFile.h"
+#include "LaserObjects/LaserMapInterpolator.h"
 
 
 namespace 
 {
-  // Applies field correction to to a track
-  recob::Track TrackCorrector(const recob::Track& InputTrack);
+  // Builds the corrected track from its corrected points (SoA), the directions are recalculated from the points
+  recob::Track TrackCorrector(const recob::Track& InputTrack, const float* X, const float* Y, const float* Z);
 } // local namespace
 
 
@@ -118,6 +119,14 @@ namespace ApplyField
     std::string fTrackInstanceLabel;    ///< Track instance label
     art::InputTag fTrackTag; ///< Track tags
     
+    std::string fMapFileName;    ///< Binary map file (LaserMapFile) or ROOT file (LaserDisplacementMap::WriteHistograms)
+    std::string fMapPrefix;      ///< Prefix of the map histogram names
+    bool fVerifyMapChecksum;     ///< Check the payload checksum of binary map files (reads the whole map)
+    std::unique_ptr<lasercal::LaserMapInterpolator> fCorrectionMap; ///< Loaded once per job
+    
+    // Trajectory points of all tracks of the event, reused between events
+    std::vector<float> fPointsX, fPointsY, fPointsZ;
+    
   }; // class ApplyField
   
   DEFINE_ART_MODULE(ApplyField)
@@ -146,7 +155,27 @@ namespace ApplyField
   //-----------------------------------------------------------------------
   void ApplyField::beginJob()
   {
+    // Binary map files are used in place through a shared memory mapping, ROOT files are read into memory
+    if(lasercal::LaserMapFile::IsMapFile(fMapFileName))
+    {
+      std::shared_ptr<const lasercal::LaserMapFile> MapFile = std::make_shared<lasercal::LaserMapFile>(fMapFileName, fVerifyMapChecksum);
+      fCorrectionMap.reset(new lasercal::LaserMapInterpolator(MapFile));
+    }
+    else
+    {
+      std::unique_ptr<TFile> MapFile(TFile::Open(fMapFileName.c_str(), "READ"));
+      if(!MapFile || MapFile->IsZombie())
+      {
+        throw art::Exception(art::errors::FileOpenError) << "ApplyField: unable to open displacement map "
+                                                         << fMapFileName << "\n";
+      }
+      
+      fCorrectionMap.reset(new lasercal::LaserMapInterpolator(lasercal::LaserDisplacementMap::ReadHistograms(MapFile.get(), fMapPrefix)));
+    }
     
+    const auto& Grid = fCorrectionMap->GetGrid();
+    mf::LogInfo("ApplyField") << "Loaded displacement map " << fMapFileName << " with " 
+                              << Grid.Size[0] << " x " << Grid.Size[1] << " x " << Grid.Size[2] << " voxels";
   }
   
   
@@ -164,23 +193,49 @@ namespace ApplyField
     fTrackInstanceLabel = parameterSet.get< std::string >("TrackInstanceLabel");
     
     fTrackTag = art::InputTag(fTrackModuleLabel,fTrackInstanceLabel);
+    
+    fMapFileName = parameterSet.get< std::string >("MapFile");
+    fMapPrefix = parameterSet.get< std::string >("MapPrefix", "");
+    fVerifyMapChecksum = parameterSet.get< bool >("VerifyMapChecksum", false);
   }
 
   //-----------------------------------------------------------------------
   void ApplyField::produce(art::Event& event) 
   {
-    // Grab the space charge service handle which sets up the intorpolation polynomial
-    art::ServiceHandle<spacecharge::SpaceCharge> SpaceChargeHandle;
-    
     // Initialize output track (with applied correction)
     std::unique_ptr< std::vector<recob::Track> > CorrectedTracksPointer(new std::vector<recob::Track>); 
     
     // This is the handle to the raw data of this event (simply a pointer to std::vector<raw::RawDigit>)
     art::ValidHandle< std::vector<recob::Track> > TrackVecHandle = event.getValidHandle< std::vector<recob::Track> >(fTrackTag);
    
+    // Collect the trajectory points of all tracks, so that the whole event is corrected in one pass
+    size_t NumberOfPoints = 0;
+    for(const auto& Track : *TrackVecHandle) NumberOfPoints += Track.NumberTrajectoryPoints();
+    
+    fPointsX.resize(NumberOfPoints);
+    fPointsY.resize(NumberOfPoints);
+    fPointsZ.resize(NumberOfPoints);
+    
+    size_t PointIndex = 0;
+    for(const auto& Track : *TrackVecHandle)
+    {
+      for(unsigned int point_no = 0; point_no < Track.NumberTrajectoryPoints(); point_no++, PointIndex++)
+      {
+        const TVector3& Location = Track.LocationAtPoint(point_no);
+        fPointsX[PointIndex] = Location.X();
+        fPointsY[PointIndex] = Location.Y();
+        fPointsZ[PointIndex] = Location.Z();
+      }
+    }
+    
+    fCorrectionMap->Correct(fPointsX.data(), fPointsY.data(), fPointsZ.data(), NumberOfPoints);
+    
+    CorrectedTracksPointer->reserve(TrackVecHandle->size());
+    PointIndex = 0;
     for(const auto& Track : *TrackVecHandle)
     {
-      CorrectedTracksPointer->push_back(TrackCorrector(Track));
+      CorrectedTracksPointer->push_back(TrackCorrector(Track, fPointsX.data() + PointIndex, fPointsY.data() + PointIndex, fPointsZ.data() + PointIndex));
+      PointIndex += Track.NumberTrajectoryPoints();
 //       recob::Track CorrectedTrack( std::vector< TVector3 > const &  	xyz,
 // 		std::vector< TVector3 > const &  	dxdydz,
 // // 		std::vector< std::vector< double > >  	dQdx = std::vector< std::vector<double> >(0),
@@ -209,17 +264,37 @@ namespace ApplyField
 
 namespace
 {
-  recob::Track TrackCorrector(const recob::Track& InputTrack)
+  recob::Track TrackCorrector(const recob::Track& InputTrack, const float* X, const float* Y, const float* Z)
   {
+    const unsigned int NumberOfPoints = InputTrack.NumberTrajectoryPoints();
+    
     // Initialize corrected track points and directions
     std::vector<TVector3> TrackPointsCorrected;
     std::vector<TVector3> TrackDirectionsCorrected;
+    TrackPointsCorrected.reserve(NumberOfPoints);
+    TrackDirectionsCorrected.reserve(NumberOfPoints);
     
-    // Fill track points and apply correction
-    for(unsigned int point_no = 0; point_no < InputTrack.NumberTrajectoryPoints(); point_no++)
+    for(unsigned int point_no = 0; point_no < NumberOfPoints; point_no++)
     {
-      TrackPointsCorrected.push_back(InputTrack.LocationAtPoint(point_no)/*+ Correction*/);
-      TrackDirectionsCorrected.push_back(InputTrack.DirectionAtPoint(point_no)/* + Correction */);
+      TrackPointsCorrected.emplace_back(X[point_no], Y[point_no], Z[point_no]);
+    }
+    
+    // Directions by finite differences of the corrected points (central inside, one-sided at the ends). Tracks
+    // with a single point or coinciding neighbours keep the input direction.
+    for(unsigned int point_no = 0; point_no < NumberOfPoints; point_no++)
+    {
+      unsigned int Previous = (point_no > 0) ? point_no - 1 : point_no;
+      unsigned int Next = (point_no + 1 < NumberOfPoints) ? point_no + 1 : point_no;
+      
+      TVector3 Difference = TrackPointsCorrected[Next] - TrackPointsCorrected[Previous];
+      if(Difference.Mag2() > 0.)
+      {
+        TrackDirectionsCorrected.push_back(Difference.Unit());
+      }
+      else
+      {
+        TrackDirectionsCorrected.push_back(InputTrack.DirectionAtPoint(point_no));
+      }
     }
     
     // Create and return output track
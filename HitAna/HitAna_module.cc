@@ -49,7 +49,6 @@
 #include "TTree.h"
 #include "TLorentzVector.h"
 #include "TVector3.h"
-#include "TVectorT.h"
 #include "TFile.h"
 #include "TROOT.h"
 #include "TSystem.h"
@@ -68,6 +67,7 @@
 // Laser Module Classes
 #include "LaserObjects/LaserROI.h"
 #include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserSparseHist2D.h"
 
 
 namespace 
@@ -98,10 +98,15 @@ namespace HitAna {
 
     virtual void analyze(const art::Event& event) override;
     
-    virtual TGraphAsymmErrors* FillGraph(const std::vector<float>& WireNumber, 
-					 const std::vector<float>& PeakTime,
-					 const std::vector<float>& LowerHitTimeErr,
-					 const std::vector<float>& UpperHitTimeErr);
+    // Replaces the points of a hit graph (the graphs are reused for every event)
+    virtual void FillGraph(TGraphAsymmErrors* Graph,
+			   const std::vector<float>& WireNumber,
+			   const std::vector<float>& PeakTime,
+			   const std::vector<float>& LowerHitTimeErr,
+			   const std::vector<float>& UpperHitTimeErr);
+    
+    // Books the TH2D of a sparse histogram in the output file, fills and writes it and frees it again
+    void WriteHistogram(const lasercal::LaserSparseHist2D& Sparse);
     
 
   private:
@@ -134,18 +139,18 @@ namespace HitAna {
     // Threshold array
     std::array<float,3> fUVYThresholds;
     
-    // Hits Analysis Histogram
-    TH2D* fUHitWidthVsPeak;
-    TH2D* fUPeakDivWidth;
+    // Hits Analysis Histogram (only the filled bins are kept, the TH2D are made at the end of the job)
+    std::unique_ptr<lasercal::LaserSparseHist2D> fUHitWidthVsPeak;
+    std::unique_ptr<lasercal::LaserSparseHist2D> fUPeakDivWidth;
     
-    TH2D* fVHitWidthVsPeak;
-    TH2D* fVHitPeakDistVsPeak;
-    TH2D* fVHitPeakDistVsWidth;
-    TH2D* fVPeakDivWidth;
-    TH2D* fVPeakDivPeakDist;
+    std::unique_ptr<lasercal::LaserSparseHist2D> fVHitWidthVsPeak;
+    std::unique_ptr<lasercal::LaserSparseHist2D> fVHitPeakDistVsPeak;
+    std::unique_ptr<lasercal::LaserSparseHist2D> fVHitPeakDistVsWidth;
+    std::unique_ptr<lasercal::LaserSparseHist2D> fVPeakDivWidth;
+    std::unique_ptr<lasercal::LaserSparseHist2D> fVPeakDivPeakDist;
     
-    TH2D* fYHitWidthVsPeak;
-    TH2D* fYPeakDivWidth;
+    std::unique_ptr<lasercal::LaserSparseHist2D> fYHitWidthVsPeak;
+    std::unique_ptr<lasercal::LaserSparseHist2D> fYPeakDivWidth;
     
     // Hit Graphs for all planes
     TGraphAsymmErrors* fUPlaneHits;
@@ -157,6 +162,11 @@ namespace HitAna {
     TGraphAsymmErrors* fVPlaneHitsSelected;
     TGraphAsymmErrors* fYPlaneHitsSelected;
     
+    // All hits of a plane (both graphs above), drawn together
+    TMultiGraph* fUPlaneTot;
+    TMultiGraph* fVPlaneTot;
+    TMultiGraph* fYPlaneTot;
+    
     TLine* fULaserBeam;
     TLine* fVLaserBeam;
     TLine* fYLaserBeam;
@@ -196,22 +206,49 @@ namespace HitAna {
       fUCanvas = new TCanvas("U-Plane Hits","U-Plane Hits",1000,700);
       fVCanvas = new TCanvas("V-Plane Hits","V-Plane Hits",1000,700);
       fYCanvas = new TCanvas("Y-Plane Hits","Y-Plane Hits",1000,700);
+      
+      // Graphs and lines are made once and only refilled for every event
+      fUPlaneHits = new TGraphAsymmErrors();
+      fVPlaneHits = new TGraphAsymmErrors();
+      fYPlaneHits = new TGraphAsymmErrors();
+      
+      fUPlaneHitsSelected = new TGraphAsymmErrors();
+      fVPlaneHitsSelected = new TGraphAsymmErrors();
+      fYPlaneHitsSelected = new TGraphAsymmErrors();
+      fUPlaneHitsSelected->SetLineColor(2);
+      fVPlaneHitsSelected->SetLineColor(2);
+      fYPlaneHitsSelected->SetLineColor(2);
+      
+      // The multi graphs own the graphs
+      fUPlaneTot = new TMultiGraph();
+      fVPlaneTot = new TMultiGraph();
+      fYPlaneTot = new TMultiGraph();
+      fUPlaneTot->Add(fUPlaneHits);
+      fUPlaneTot->Add(fUPlaneHitsSelected);
+      fVPlaneTot->Add(fVPlaneHits);
+      fVPlaneTot->Add(fVPlaneHitsSelected);
+      fYPlaneTot->Add(fYPlaneHits);
+      fYPlaneTot->Add(fYPlaneHitsSelected);
+      
+      fULaserBeam = new TLine();
+      fVLaserBeam = new TLine();
+      fYLaserBeam = new TLine();
+      fULaserBeam->SetLineColor(3);
+      fVLaserBeam->SetLineColor(3);
+      fYLaserBeam->SetLineColor(3);
     }
     else
     {
-      // Initialize the Art TFile service
-      art::ServiceHandle<art::TFileService> TFileServiceHandle;
-    
-      // Make histograms
-      fUHitWidthVsPeak	   = TFileServiceHandle->make<TH2D>("U-Plane Width vs. Peak","Width vs. Peak",1000,0,1000,2100,0,2100);
-      fUPeakDivWidth	   = TFileServiceHandle->make<TH2D>("U-Plane Width vs. Peak/Width","Peak height devided by Width",1000,0,1000,2100,0,2100);
-      fVHitWidthVsPeak	   = TFileServiceHandle->make<TH2D>("V-Plane Width vs. Peak","Widtht vs. Peak",1000,0,1000,4100,0,4100);
-      fVHitPeakDistVsPeak  = TFileServiceHandle->make<TH2D>("V-Plane Peak Dist vs. Peak","PeakDist vs. Peak",1000,0,1000,4100,0,4100);
-      fVHitPeakDistVsWidth = TFileServiceHandle->make<TH2D>("V-Plane Peak Dist vs. Hit Width","PeakDist vs. HitWidth",1000,0,1000,1000,0,1000);
-      fVPeakDivWidth	   = TFileServiceHandle->make<TH2D>("V-Plane Width vs. Peak/Width","Peak height devided by Width",1000,0,1000,4100,0,4100);
-      fVPeakDivPeakDist	   = TFileServiceHandle->make<TH2D>("V-Plane PeakDist vs. Peak/PeakDist","Peak height devided by Peak distance",1000,0,1000,4100,0,4100);
-      fYHitWidthVsPeak	   = TFileServiceHandle->make<TH2D>("Y-Plane Width vs. Peak","Width vs. Peak",1000,0,1000,3500,0,3500);
-      fYPeakDivWidth	   = TFileServiceHandle->make<TH2D>("Y-Plane Width vs. Peak/Width","Peak height devided by Width",1000,0,1000,3500,0,3500);
+      // Make histograms (sparse, the TH2D are booked in the TFileService at the end of the job)
+      fUHitWidthVsPeak.reset(new lasercal::LaserSparseHist2D("U-Plane Width vs. Peak","Width vs. Peak",1000,0,1000,2100,0,2100));
+      fUPeakDivWidth.reset(new lasercal::LaserSparseHist2D("U-Plane Width vs. Peak/Width","Peak height devided by Width",1000,0,1000,2100,0,2100));
+      fVHitWidthVsPeak.reset(new lasercal::LaserSparseHist2D("V-Plane Width vs. Peak","Widtht vs. Peak",1000,0,1000,4100,0,4100));
+      fVHitPeakDistVsPeak.reset(new lasercal::LaserSparseHist2D("V-Plane Peak Dist vs. Peak","PeakDist vs. Peak",1000,0,1000,4100,0,4100));
+      fVHitPeakDistVsWidth.reset(new lasercal::LaserSparseHist2D("V-Plane Peak Dist vs. Hit Width","PeakDist vs. HitWidth",1000,0,1000,1000,0,1000));
+      fVPeakDivWidth.reset(new lasercal::LaserSparseHist2D("V-Plane Width vs. Peak/Width","Peak height devided by Width",1000,0,1000,4100,0,4100));
+      fVPeakDivPeakDist.reset(new lasercal::LaserSparseHist2D("V-Plane PeakDist vs. Peak/PeakDist","Peak height devided by Peak distance",1000,0,1000,4100,0,4100));
+      fYHitWidthVsPeak.reset(new lasercal::LaserSparseHist2D("Y-Plane Width vs. Peak","Width vs. Peak",1000,0,1000,3500,0,3500));
+      fYPeakDivWidth.reset(new lasercal::LaserSparseHist2D("Y-Plane Width vs. Peak/Width","Peak height devided by Width",1000,0,1000,3500,0,3500));
       gROOT->Reset();
     }
     
@@ -222,7 +259,32 @@ namespace HitAna {
   //-----------------------------------------------------------------------
   void  HitAna::endJob()
   {
-      
+    if(!fDrawHits)
+    {
+      WriteHistogram(*fUHitWidthVsPeak);
+      WriteHistogram(*fUPeakDivWidth);
+      WriteHistogram(*fVHitWidthVsPeak);
+      WriteHistogram(*fVHitPeakDistVsPeak);
+      WriteHistogram(*fVHitPeakDistVsWidth);
+      WriteHistogram(*fVPeakDivWidth);
+      WriteHistogram(*fVPeakDivPeakDist);
+      WriteHistogram(*fYHitWidthVsPeak);
+      WriteHistogram(*fYPeakDivWidth);
+    }
+  }
+  
+  //-----------------------------------------------------------------------
+  void HitAna::WriteHistogram(const lasercal::LaserSparseHist2D& Sparse)
+  {
+    art::ServiceHandle<art::TFileService> TFileServiceHandle;
+    
+    TH2D* Hist = TFileServiceHandle->make<TH2D>(Sparse.GetName().c_str(),Sparse.GetTitle().c_str(),
+						  Sparse.GetNbinsX(),Sparse.GetXmin(),Sparse.GetXmax(),
+						  Sparse.GetNbinsY(),Sparse.GetYmin(),Sparse.GetYmax());
+    
+    // Written into the TFileService directory and deleted right away, so that only one dense histogram is in
+    // memory at a time
+    Sparse.WriteTo(Hist);
   }
    
   //-----------------------------------------------------------------------
@@ -251,11 +313,6 @@ namespace HitAna {
   //-----------------------------------------------------------------------
   void HitAna::analyze(const art::Event& event) 
   {
-      // Hit Graphs for selected ROI of all planes
-      TMultiGraph* UPlaneTot = new TMultiGraph();
-      TMultiGraph* VPlaneTot = new TMultiGraph();
-      TMultiGraph* YPlaneTot = new TMultiGraph();
-      
     // This is the handle to the hit data of this event (simply a pointer to std::vector<recob::hit>)   
     art::ValidHandle< std::vector<recob::Hit> > UPlaneHitVecHandle = event.getValidHandle<std::vector<recob::Hit>>(fUPlaneTag);
     art::ValidHandle< std::vector<recob::Hit> > VPlaneHitVecHandle = event.getValidHandle<std::vector<recob::Hit>>(fVPlaneTag);
@@ -314,20 +371,15 @@ namespace HitAna {
       }
     }// end loop over u-plane hits entries
     
-    if(HitWireNumber.size())
-    {
-	fUCanvas->cd();
-	fUPlaneHits = FillGraph(HitWireNumber,HitTimeBin,LowerHitTimeErr,UpperHitTimeErr);
-	UPlaneTot->Add(fUPlaneHits);
-    }
-    if(HitWireNumberSel.size())
+    if(fDrawHits)
     {
-	fUPlaneHitsSelected = FillGraph(HitWireNumberSel,HitTimeBinSel,LowerHitTimeErrSel,UpperHitTimeErrSel);
-	fUPlaneHitsSelected->SetLineColor(2);
-	UPlaneTot->Add(fUPlaneHitsSelected);
+	FillGraph(fUPlaneHits,HitWireNumber,HitTimeBin,LowerHitTimeErr,UpperHitTimeErr);
+	FillGraph(fUPlaneHitsSelected,HitWireNumberSel,HitTimeBinSel,LowerHitTimeErrSel,UpperHitTimeErrSel);
 	
-	fULaserBeam = new TLine(ROI.GetEntryWire(0),ROI.GetEntryTimeTick(0),ROI.GetExitWire(0),ROI.GetExitTimeTick(0));
-	fULaserBeam->SetLineColor(3);
+	fULaserBeam->SetX1(ROI.GetEntryWire(0));
+	fULaserBeam->SetY1(ROI.GetEntryTimeTick(0));
+	fULaserBeam->SetX2(ROI.GetExitWire(0));
+	fULaserBeam->SetY2(ROI.GetExitTimeTick(0));
     }
     
     HitWireNumber.clear();
@@ -383,20 +435,15 @@ namespace HitAna {
       }
     } // end loop over v-plane hits entries
     
-    if(HitWireNumber.size())
-    {
-	fVCanvas->cd();
-	fVPlaneHits = FillGraph(HitWireNumber,HitTimeBin,LowerHitTimeErr,UpperHitTimeErr);
-	VPlaneTot->Add(fVPlaneHits);
-    }
-    if(HitWireNumberSel.size())
+    if(fDrawHits)
     {
-	fVPlaneHitsSelected = FillGraph(HitWireNumberSel,HitTimeBinSel,LowerHitTimeErrSel,UpperHitTimeErrSel);
-	fVPlaneHitsSelected->SetLineColor(2);
-	VPlaneTot->Add(fVPlaneHitsSelected);
+	FillGraph(fVPlaneHits,HitWireNumber,HitTimeBin,LowerHitTimeErr,UpperHitTimeErr);
+	FillGraph(fVPlaneHitsSelected,HitWireNumberSel,HitTimeBinSel,LowerHitTimeErrSel,UpperHitTimeErrSel);
 	
-	fVLaserBeam = new TLine(ROI.GetEntryWire(1),ROI.GetEntryTimeTick(1),ROI.GetExitWire(1),ROI.GetExitTimeTick(1));
-	fVLaserBeam->SetLineColor(3);
+	fVLaserBeam->SetX1(ROI.GetEntryWire(1));
+	fVLaserBeam->SetY1(ROI.GetEntryTimeTick(1));
+	fVLaserBeam->SetX2(ROI.GetExitWire(1));
+	fVLaserBeam->SetY2(ROI.GetExitTimeTick(1));
     }
     
     
@@ -446,21 +493,15 @@ namespace HitAna {
       }
     }// end loop over y-plane hits entries
     
-    if(HitWireNumber.size())
-    {
-	fYCanvas->cd();
-	fYPlaneHits = FillGraph(HitWireNumber,HitTimeBin,LowerHitTimeErr,UpperHitTimeErr);
-	YPlaneTot->Add(fYPlaneHits);
-	
-    }
-    if(HitWireNumberSel.size())
+    if(fDrawHits)
     {
-	fYPlaneHitsSelected = FillGraph(HitWireNumberSel,HitTimeBinSel,LowerHitTimeErrSel,UpperHitTimeErrSel);
-	fYPlaneHitsSelected->SetLineColor(2);
-	YPlaneTot->Add(fYPlaneHitsSelected);
+	FillGraph(fYPlaneHits,HitWireNumber,HitTimeBin,LowerHitTimeErr,UpperHitTimeErr);
+	FillGraph(fYPlaneHitsSelected,HitWireNumberSel,HitTimeBinSel,LowerHitTimeErrSel,UpperHitTimeErrSel);
 	
-	fYLaserBeam = new TLine(ROI.GetEntryWire(2),ROI.GetEntryTimeTick(2),ROI.GetExitWire(2),ROI.GetExitTimeTick(2));
-	fYLaserBeam->SetLineColor(3);
+	fYLaserBeam->SetX1(ROI.GetEntryWire(2));
+	fYLaserBeam->SetY1(ROI.GetEntryTimeTick(2));
+	fYLaserBeam->SetX2(ROI.GetExitWire(2));
+	fYLaserBeam->SetY2(ROI.GetExitTimeTick(2));
     }
     
     while(fDrawHits)
@@ -468,27 +509,27 @@ namespace HitAna {
       if(!gROOT->IsBatch())
       {
 	fUCanvas->cd();
-	if(HitWireNumber.size())
+	if(fUPlaneHits->GetN() || fUPlaneHitsSelected->GetN())
 	{
-	    UPlaneTot->Draw("AP");
+	    fUPlaneTot->Draw("AP");
 	    fULaserBeam->Draw("same");
 	}
 	fUCanvas->Modified();
 	fUCanvas->Update();
 	
 	fVCanvas->cd();
-	if(HitWireNumber.size()) 
+	if(fVPlaneHits->GetN() || fVPlaneHitsSelected->GetN())
 	{
-	    VPlaneTot->Draw("AP");
+	    fVPlaneTot->Draw("AP");
 	    fVLaserBeam->Draw("same");
 	}
 	fVCanvas->Modified();
 	fVCanvas->Update();
 	
 	fYCanvas->cd();
-	if(HitWireNumber.size()) 
+	if(fYPlaneHits->GetN() || fYPlaneHitsSelected->GetN())
 	{
-	    YPlaneTot->Draw("AP");
+	    fYPlaneTot->Draw("AP");
 	    fYLaserBeam->Draw("same");
 	}
 	fYCanvas->Modified();
@@ -506,27 +547,21 @@ namespace HitAna {
       if(gSystem->ProcessEvents()) break;
     }// end Draw loop
     
-    delete UPlaneTot;
-    delete VPlaneTot;
-    delete YPlaneTot;
-    
   } // HitAna::analyze()
   
-  TGraphAsymmErrors* HitAna::FillGraph(const std::vector<float>& WireNumber, 
-				       const std::vector<float>& PeakTime,
-				       const std::vector<float>& LowerHitTimeErr,
-				       const std::vector<float>& UpperHitTimeErr)
+  void HitAna::FillGraph(TGraphAsymmErrors* Graph,
+			 const std::vector<float>& WireNumber,
+			 const std::vector<float>& PeakTime,
+			 const std::vector<float>& LowerHitTimeErr,
+			 const std::vector<float>& UpperHitTimeErr)
   {
-    std::vector<float> WireError(WireNumber.size(),0.5);
-    
-    TVectorT<float> TWireNumber(WireNumber.size(),WireNumber.data());
-    TVectorT<float> TTimeBin(PeakTime.size(),PeakTime.data());
-    TVectorT<float> TLowerHitError(LowerHitTimeErr.size(),LowerHitTimeErr.data());
-    TVectorT<float> TUpperHitError(UpperHitTimeErr.size(),UpperHitTimeErr.data());
-    TVectorT<float> TWireError(WireError.size(),WireError.data());
-    
-    
-    return new TGraphAsymmErrors(TWireNumber,TTimeBin,TWireError,TWireError,TLowerHitError,TUpperHitError);
+    // Set keeps the allocated points if the graph shrinks
+    Graph->Set(WireNumber.size());
+    for(unsigned int hit_no = 0; hit_no < WireNumber.size(); hit_no++)
+    {
+      Graph->SetPoint(hit_no,WireNumber[hit_no],PeakTime[hit_no]);
+      Graph->SetPointError(hit_no,0.5,0.5,LowerHitTimeErr[hit_no],UpperHitTimeErr[hit_no]);
+    }
   }
 
 } // namespace HitAna
@@ -0,0 +1,161 @@
+#ifndef HitDump_Module
+#define HitDump_Module
+
+// LArSoft includes
+#include "lardata/RecoBase/Hit.h"
+
+// Framework includes
+#include "art/Utilities/Exception.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Core/ModuleMacros.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+#include "fhiclcpp/ParameterSet.h"
+
+// C++ Includes
+#include <vector>
+#include <string>
+#include <memory>
+
+// Laser Module Classes
+#include "LaserObjects/LaserColumnFile.h"
+
+
+namespace HitDump {
+
+  /**
+   * @brief Writes the hits of all events as flat binary columns for the python analysis tools
+   *
+   * Every hit is one row. Each column goes to its own file <OutputPrefix>.<column>.col (see
+   * lasercal::LaserColumnFile for the layout), so numpy can memory map the columns directly, without ROOT:
+   *   run, subrun, event, channel, wire (uint32), plane (uint16), peak_time, peak_amplitude (float32),
+   *   start_tick, end_tick (int32)
+   * python/datadefs/hitdump.py reads them back.
+   *
+   * Configuration parameters:
+   * - *HitTags* (list of input tags): hit collections to dump, e.g. ["LaserReco:YPlaneLaserHits"]
+   * - *OutputPrefix* (string, default "hits"): path and prefix of the column files
+   * - *BufferSize* (integer, default 65536): number of hits collected before a block is written
+   */
+  class HitDump : public art::EDAnalyzer
+  {
+  public:
+
+    explicit HitDump(fhicl::ParameterSet const& parameterSet);
+
+    virtual void beginJob() override;
+
+    virtual void endJob() override;
+
+    virtual void reconfigure(fhicl::ParameterSet const& parameterSet) override;
+
+    virtual void analyze(const art::Event& event) override;
+
+  private:
+
+    std::vector<art::InputTag> fHitTags;
+    std::string fOutputPrefix;
+    size_t fBufferSize;
+
+    // Opens the column file of one hit property
+    template<class T>
+    void OpenColumn(std::unique_ptr<lasercal::LaserColumnFile>& Column, const std::string& Name)
+    {
+      Column.reset(new lasercal::LaserColumnFile(
+              lasercal::LaserColumnFile::Make<T>(fOutputPrefix + "." + Name + ".col", fBufferSize)));
+    }
+
+    // Column files (only open between beginJob and endJob)
+    std::unique_ptr<lasercal::LaserColumnFile> fRun;
+    std::unique_ptr<lasercal::LaserColumnFile> fSubRun;
+    std::unique_ptr<lasercal::LaserColumnFile> fEvent;
+    std::unique_ptr<lasercal::LaserColumnFile> fChannel;
+    std::unique_ptr<lasercal::LaserColumnFile> fPlane;
+    std::unique_ptr<lasercal::LaserColumnFile> fWire;
+    std::unique_ptr<lasercal::LaserColumnFile> fPeakTime;
+    std::unique_ptr<lasercal::LaserColumnFile> fPeakAmplitude;
+    std::unique_ptr<lasercal::LaserColumnFile> fStartTick;
+    std::unique_ptr<lasercal::LaserColumnFile> fEndTick;
+
+  }; // class HitDump
+
+  DEFINE_ART_MODULE(HitDump)
+
+
+  //-----------------------------------------------------------------------
+  HitDump::HitDump(fhicl::ParameterSet const& pset) : EDAnalyzer(pset)
+  {
+    this->reconfigure(pset);
+  }
+
+  //-----------------------------------------------------------------------
+  void HitDump::reconfigure(fhicl::ParameterSet const& parameterSet)
+  {
+    fHitTags.clear();
+    for (auto const& Tag : parameterSet.get< std::vector<std::string> >("HitTags"))
+    {
+      fHitTags.push_back(art::InputTag(Tag));
+    }
+    fOutputPrefix = parameterSet.get< std::string >("OutputPrefix", "hits");
+    fBufferSize   = parameterSet.get< size_t >("BufferSize", 65536);
+  }
+
+  //-----------------------------------------------------------------------
+  void HitDump::beginJob()
+  {
+    OpenColumn<uint32_t>(fRun, "run");
+    OpenColumn<uint32_t>(fSubRun, "subrun");
+    OpenColumn<uint32_t>(fEvent, "event");
+    OpenColumn<uint32_t>(fChannel, "channel");
+    OpenColumn<uint16_t>(fPlane, "plane");
+    OpenColumn<uint32_t>(fWire, "wire");
+    OpenColumn<float>(fPeakTime, "peak_time");
+    OpenColumn<float>(fPeakAmplitude, "peak_amplitude");
+    OpenColumn<int32_t>(fStartTick, "start_tick");
+    OpenColumn<int32_t>(fEndTick, "end_tick");
+  }
+
+  //-----------------------------------------------------------------------
+  void HitDump::analyze(const art::Event& event)
+  {
+    const uint32_t Run = event.run();
+    const uint32_t SubRun = event.subRun();
+    const uint32_t EventNumber = event.id().event();
+
+    for (auto const& Tag : fHitTags)
+    {
+      art::ValidHandle< std::vector<recob::Hit> > HitVecHandle = event.getValidHandle< std::vector<recob::Hit> >(Tag);
+
+      for (auto const& Hit : *HitVecHandle)
+      {
+        fRun->push_back(Run);
+        fSubRun->push_back(SubRun);
+        fEvent->push_back(EventNumber);
+        fChannel->push_back((uint32_t) Hit.Channel());
+        fPlane->push_back((uint16_t) Hit.WireID().Plane);
+        fWire->push_back((uint32_t) Hit.WireID().Wire);
+        fPeakTime->push_back((float) Hit.PeakTime());
+        fPeakAmplitude->push_back((float) Hit.PeakAmplitude());
+        fStartTick->push_back((int32_t) Hit.StartTick());
+        fEndTick->push_back((int32_t) Hit.EndTick());
+      }
+    }
+  }
+
+  //-----------------------------------------------------------------------
+  void HitDump::endJob()
+  {
+    mf::LogInfo("HitDump") << "Wrote " << fRun->size() << " hits to " << fOutputPrefix << ".*.col";
+
+    for (auto Column : {&fRun, &fSubRun, &fEvent, &fChannel, &fPlane, &fWire,
+                        &fPeakTime, &fPeakAmplitude, &fStartTick, &fEndTick})
+    {
+      (*Column)->Close();
+      Column->reset();
+    }
+  }
+
+} // namespace HitDump
+
+#endif // HitDump_Module
@@ -38,6 +38,7 @@
 #include "art/Framework/Core/EDProducer.h"
 
 #include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Run.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art/Framework/Services/Optional/TFileService.h"
@@ -60,6 +61,7 @@
 #include "TLorentzVector.h"
 #include "TVector3.h"
 #include "TFile.h"
+#include "TROOT.h"
 
 // C++ Includes
 #include <map>
@@ -71,12 +73,16 @@
 #include <utility>
 #include <memory>
 #include <iterator>
+#include <algorithm>
 
 #include <fstream>
-#include <boost/tokenizer.hpp>
 
 // Laser Module Classes
 #include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserBeamTable.h"
+#include "LaserObjects/LaserDataFile.h"
+#include "LaserObjects/LaserTimeAligner.h"
+#include "LaserObjects/LaserRunDataStore.h"
 
 
 namespace LaserDataMerger
@@ -92,6 +98,8 @@ public:
 
     virtual void beginRun(art::Run& run);
 
+    virtual void endRun(art::Run& run) override;
+
     virtual void endJob() override;
 
     virtual void reconfigure(fhicl::ParameterSet const& parameterSet) override;
@@ -99,6 +107,9 @@ public:
     // The analysis routine, called once per event. 
     virtual void produce(art::Event& event) override;
     
+    // Builds the laser beam from a line of the laser data file
+    lasercal::LaserBeam MakeBeam(unsigned int LaserIndex);
+
     float LinearRawToAngle(float Angles);
 
     float AttenuatorTickToPercentage(float Tick);
@@ -113,11 +124,20 @@ private:
     unsigned int time_s;
     unsigned int time_ms;
 
-    std::map< Long64_t, unsigned int > timemap; ///< Key value: index of event, corresponding index in laser data file
-    std::vector< std::vector<float> > laser_values; ///< line by line csv container
+    std::unique_ptr< lasercal::LaserRunDataStore > fRunStore;  ///< Laser data per run (bounded number of runs)
+    const lasercal::LaserRunData* fRunData = nullptr;         ///< Laser data of the current run
+    size_t fRunCacheSize;                                     ///< Number of runs kept in memory after their end
+    std::vector< unsigned int > fPrefetchRuns;                ///< Runs of this job in order, read ahead in background
 
     bool fReadTimeMap = false;
     bool fGenerateTimeInfo = false;
+    bool fRunLevelTable = false;    ///< Put one LaserBeamTable per run instead of a LaserBeam per event
+    bool fUseDataCache = true;      ///< Read and write the binary caches of the laser data file and time map
+
+    bool fAlignOnline = false;      ///< Match event times to laser trigger times in produce (no time map)
+    double fAlignMaxTimeDelta;      ///< Maximum time difference of a match in seconds
+    double fAlignOffsetSmoothing;   ///< Weight of a new residual in the clock offset tracking
+    std::unique_ptr< lasercal::LaserTimeAligner > fTimeAligner;
 
     float fTickToAngle;     ///< Conversion constant from linear tick to angle (Heidenhain linear encoder)        
     std::array<float, 2> fDirCalLCS1 = {{-999., 999.}};  ///< Position calibration for LCS1 and LCS2:
@@ -138,6 +158,7 @@ private:
     std::array<float, 2> fEnergyMinMaxLCS1 = {{-999., 999.}};
     std::array<float, 2> fEnergyMinMaxLCS2 = {{-999., 999.}};
     
+    // Column order of the laser data file (parsed into lasercal::LaserDataRecord)
     enum DataStructure
     {
         LaserSystem, ///< which laser system: 1 or 2
@@ -176,7 +197,14 @@ LaserDataMerger::LaserDataMerger(fhicl::ParameterSet const& pset)
     // Read in the parameters from the .fcl file.
     this->reconfigure(pset);
 
-    produces< lasercal::LaserBeam >("LaserBeam");
+    if (fRunLevelTable)
+    {
+        produces< lasercal::LaserBeamTable, art::InRun >("LaserBeamTable");
+    }
+    else
+    {
+        produces< lasercal::LaserBeam >("LaserBeam");
+    }
 }
 
 
@@ -184,7 +212,11 @@ LaserDataMerger::LaserDataMerger(fhicl::ParameterSet const& pset)
 
 void LaserDataMerger::beginJob()
 {
-
+    // The first run can already be read while the other modules are set up
+    if (!fPrefetchRuns.empty() && (fReadTimeMap || fAlignOnline))
+    {
+        fRunStore->Prefetch(fPrefetchRuns.front(), fReadTimeMap);
+    }
 }
 
 void LaserDataMerger::beginRun(art::Run& run)
@@ -201,78 +233,84 @@ void LaserDataMerger::beginRun(art::Run& run)
         fTimeAnalysis->Branch("time_ms", &time_ms);
 
     }
-    else if (fReadTimeMap)
+    else if (fReadTimeMap || fAlignOnline)
     {
         RunNumber = run.run();
         
-        // read the timemap root file (generated in python)
-        std::string TimemapFile = "TimeMap-" + std::to_string(RunNumber) + ".root";
-        std::cout << "READING TIMEMAP FILE: " << TimemapFile << std::endl;
-        TFile* InputFile = new TFile(TimemapFile.c_str(), "READ");
-        TTree *tree = (TTree*) InputFile->Get("tree");
-
-        unsigned int map_root;
-        tree->SetBranchAddress("map", &map_root);
-        Long64_t nentries = tree->GetEntries();
+        // Time map and laser data file of this run (read from disk only if the run is not in memory yet)
+        fRunData = &fRunStore->Load(RunNumber, fReadTimeMap);
+        auto const& timemap = fRunData->TimeMap;
 
-        for (Long64_t idx = 0; idx < nentries; idx++)
+        // Read the next run of the list in the background while this one is processed
+        auto RunInList = std::find(fPrefetchRuns.begin(), fPrefetchRuns.end(), RunNumber);
+        if (RunInList != fPrefetchRuns.end() && std::next(RunInList) != fPrefetchRuns.end())
         {
-            tree->GetEntry(idx);
-            timemap.insert(std::pair< Long64_t, unsigned int >(idx, map_root));
+            fRunStore->Prefetch(*std::next(RunInList), fReadTimeMap);
+        }
+        auto const& laser_values = fRunData->LaserData;
 
-            if (DEBUG)
+        if (DEBUG)
+        {
+            for (size_t idx = 0; idx < timemap.size(); idx++)
             {
-                std::cout << "idx: " << idx << " mapped to: " << timemap.at(idx) << std::endl;
+                std::cout << "idx: " << idx << " mapped to: " << timemap[idx] << std::endl;
+            }
+            for (auto const& Line : laser_values)
+            {
+                std::cout << Line.LaserSystem << " " << Line.RotaryPosition << " " << Line.LinearPosition << " "
+                          << Line.TriggerTimeSec << " " << Line.TriggerTimeUsec << " " << Line.TriggerCount << std::endl;
             }
         }
-        delete InputFile;
 
+        if (!laser_values.empty())
+        {
+            LCS_ID = laser_values.back().LaserSystem;
+        }
 
-        // read the laser data file into a vector
-        std::string LaserFile = "Run-" + std::to_string(RunNumber) + ".txt";
-        fstream file(LaserFile, std::ios::in);
+        if (fAlignOnline)
+        {
+            // Events are matched to the laser triggers by their time in produce, no time map needed
+            fTimeAligner.reset(new lasercal::LaserTimeAligner(laser_values, fAlignMaxTimeDelta, fAlignOffsetSmoothing));
+        }
 
-        if (file)
+        if (fRunLevelTable)
         {
-            typedef boost::tokenizer< boost::char_separator<char> > Tokenizer;
-            boost::char_separator<char> sep(" ");
-            std::string line;
+            // All beams of the run in one product, the index is the event number as in the timemap
+            std::unique_ptr< lasercal::LaserBeamTable > BeamTable(new lasercal::LaserBeamTable());
+            BeamTable->reserve(timemap.size());
 
-            while (getline(file, line))
+            for (size_t idx = 0; idx < timemap.size(); idx++)
             {
-                Tokenizer info(line, sep); // tokenize the line of data
-                std::vector<float> values;
-
-                for (Tokenizer::iterator it = info.begin(); it != info.end(); ++it)
-                {
-                    // convert data into double value, and store
-                    values.push_back(std::strtof(it->c_str(), 0));
-                }
-
-                // store array of values
-                laser_values.push_back(values);
-
-                if (DEBUG)
-                {
-                    for (unsigned int idx = 0; idx < 15; idx++)
-                    {
-                        std::cout << laser_values.back().at(idx) << " ";
-                    }
-                    std::cout << std::endl;
-                }
-
+                if (fRunData->HasLaser(idx)) BeamTable->SetBeam(idx, MakeBeam(timemap[idx]));
             }
-            LCS_ID = laser_values.back().at(DataStructure::LaserSystem);
-            file.close();
-        }
-        else
-        {
-            std::cerr << "Error: Unable to open file " << LaserFile << std::endl;
+            mf::LogInfo("LaserDataMerger") << "Run " << RunNumber << ": " << BeamTable->NumberOfBeams()
+                                           << " laser beams in run-level table";
+
+            run.put(std::move(BeamTable), "LaserBeamTable");
         }
     }
     return;
 }
 
+void LaserDataMerger::endRun(art::Run& run)
+{
+    if (fRunData)
+    {
+        fRunStore->Release(run.run());
+        fRunData = nullptr;
+
+        mf::LogInfo("LaserDataMerger") << "Laser data in memory after run " << run.run() << ": "
+                                       << fRunStore->size() << " runs, "
+                                       << fRunStore->MemoryFootprint() / 1024 << " kB";
+    }
+
+    if (fTimeAligner)
+    {
+        fTimeAligner->PrintSummary();
+        fTimeAligner.reset();
+    }
+}
+
 void LaserDataMerger::endJob()
 {
 }
@@ -283,6 +321,24 @@ void LaserDataMerger::reconfigure(fhicl::ParameterSet const& parameterSet)
     // to p.get<TYPE> must match names in the .fcl file.
     fReadTimeMap = parameterSet.get< bool >("ReadTimeMap");
     fGenerateTimeInfo = parameterSet.get< bool >("GenerateTimeInfo");
+    fRunLevelTable = parameterSet.get< bool >("RunLevelTable", false);
+    fUseDataCache = parameterSet.get< bool >("UseDataCache", true);
+    fRunCacheSize = parameterSet.get< size_t >("RunCacheSize", 0);
+    fPrefetchRuns = parameterSet.get< std::vector<unsigned int> >("PrefetchRuns", {});
+    fAlignOnline = parameterSet.get< bool >("AlignOnline", false);
+    fAlignMaxTimeDelta = parameterSet.get< double >("AlignMaxTimeDelta", 0.1);
+    fAlignOffsetSmoothing = parameterSet.get< double >("AlignOffsetSmoothing", 0.1);
+
+    fRunStore.reset(new lasercal::LaserRunDataStore(fRunCacheSize, fUseDataCache));
+
+    // The time maps are read with ROOT on the prefetch thread
+    if (!fPrefetchRuns.empty()) ROOT::EnableThreadSafety();
+
+    if (fAlignOnline && (fReadTimeMap || fRunLevelTable))
+    {
+        throw art::Exception(art::errors::Configuration) << "LaserDataMerger: AlignOnline can not be combined with "
+                                                         << "ReadTimeMap or RunLevelTable\n";
+    }
     fTickToAngle = parameterSet.get< float >("TickToAngle");
     fDirCalLCS1 = parameterSet.get< std::array<float, 2> >("DirCalLCS1");
     fDirCalLCS2 = parameterSet.get< std::array<float, 2> >("DirCalLCS2");
@@ -323,60 +379,77 @@ void LaserDataMerger::produce(art::Event& event)
         fTimeAnalysis->Fill();
 
     }
-    else if (fReadTimeMap)
+    else if (fAlignOnline)
     {
-        int laser_id = timemap.at(fEvent);
+        int laser_id = fTimeAligner->Match(fEvent, event.time().timeHigh(), event.time().timeLow());
         if (DEBUG) std::cout << "Event idx: " << fEvent << " Laser idx: " << laser_id << std::endl;
-        
-        //auto LaserAA = std::make_unique<lasercal::LaserBeam>;
-        std::unique_ptr < lasercal::LaserBeam > LaserAA(new lasercal::LaserBeam());
-        // This is just for convinience, the TVector2 holds only the two angles
-        
-        float Theta;
-        float Phi;
-        
-        float Theta_raw =  laser_values.at(laser_id).at(DataStructure::LinearPosition);
-        float Phi_raw =     laser_values.at(laser_id).at(DataStructure::RotaryPosition);
-        
-        
-        
-        TVector3 Position;        
-        TVector2 CalibratedAngles;
 
-        if (LCS_ID == 1){ // The downstream laser system (sitting at z = -20)
-            Theta = TMath::DegToRad() * (90 - LinearRawToAngle(Theta_raw - fDirCalLCS1[1]));
-            Phi = TMath::DegToRad() * Phi_raw - fDirCalLCS1[0];
-            Position = PositionLCS1;
-        }
-        else if (LCS_ID == 2) { // The upstream laser system (sitting at z = 1020)
-            Theta = TMath::DegToRad() * (90 - LinearRawToAngle(Theta_raw - fDirCalLCS2[1]));
-            Phi = TMath::DegToRad() * (Phi_raw - fDirCalLCS2[0]);
-            Position = PositionLCS2;
-        }
-        else {
-            std::cerr << "Laser System not recognized " << std::endl;
+        // Events without laser trigger get no laser beam
+        if (laser_id < 0) return;
+
+        std::unique_ptr < lasercal::LaserBeam > LaserAA(new lasercal::LaserBeam(MakeBeam(laser_id)));
+
+        event.put(std::move(LaserAA), "LaserBeam");
+    }
+    else if (fReadTimeMap && !fRunLevelTable)
+    {
+        // Events without laser data get no laser beam
+        if (!fRunData->HasLaser(fEvent))
+        {
+            mf::LogWarning("LaserDataMerger") << "No laser data for event " << fEvent;
+            return;
         }
-        //CalibratedAngles.Set(TMath::DegToRad() * 45, TMath::DegToRad() * 190);
-        lasercal::LaserBeam Laser(Position, Phi, Theta);
-        Laser.SetLaserID(LCS_ID);
-        Laser.SetLaserEventID(laser_values.at(laser_id).at(DataStructure::TriggerCount));
-        Laser.SetAssID(laser_id);
-        Laser.SetPower(AttenuatorTickToPercentage(laser_values.at(laser_id).at(DataStructure::AttenuatorPosition)));
-        Laser.SetTime(laser_values.at(laser_id).at(DataStructure::TriggerTimeSec),
-                      laser_values.at(laser_id).at(DataStructure::TriggerTimeUsec));
-        if (DEBUG) Laser.Print();
-        
+        int laser_id = fRunData->TimeMap[fEvent];
+        if (DEBUG) std::cout << "Event idx: " << fEvent << " Laser idx: " << laser_id << std::endl;
         
-        *LaserAA = Laser;
+        std::unique_ptr < lasercal::LaserBeam > LaserAA(new lasercal::LaserBeam(MakeBeam(laser_id)));
         
         event.put(std::move(LaserAA), "LaserBeam");
-        
-        //for (auto i : fPositionLCS1)
-        //    std::cout << i << std::endl;
-        
     }
 }
 
+lasercal::LaserBeam LaserDataMerger::MakeBeam(unsigned int laser_id)
+{
+    // This is just for convinience, the TVector2 holds only the two angles
+    
+    float Theta;
+    float Phi;
+    
+    auto const& Line = fRunData->LaserData.at(laser_id);
+
+    double Theta_raw =  Line.LinearPosition;
+    double Phi_raw =    Line.RotaryPosition;
+    
+    
+    
+    TVector3 Position;        
+    TVector2 CalibratedAngles;
+
+    if (LCS_ID == 1){ // The downstream laser system (sitting at z = -20)
+        Theta = TMath::DegToRad() * (90 - LinearRawToAngle(Theta_raw - fDirCalLCS1[1]));
+        Phi = TMath::DegToRad() * Phi_raw - fDirCalLCS1[0];
+        Position = PositionLCS1;
+    }
+    else if (LCS_ID == 2) { // The upstream laser system (sitting at z = 1020)
+        Theta = TMath::DegToRad() * (90 - LinearRawToAngle(Theta_raw - fDirCalLCS2[1]));
+        Phi = TMath::DegToRad() * (Phi_raw - fDirCalLCS2[0]);
+        Position = PositionLCS2;
+    }
+    else {
+        std::cerr << "Laser System not recognized " << std::endl;
+    }
+    //CalibratedAngles.Set(TMath::DegToRad() * 45, TMath::DegToRad() * 190);
+    lasercal::LaserBeam Laser(Position, Phi, Theta);
+    Laser.SetLaserID(LCS_ID);
+    Laser.SetLaserEventID(Line.TriggerCount);
+    Laser.SetAssID(laser_id);
+    Laser.SetPower(AttenuatorTickToPercentage(Line.AttenuatorPosition));
+    Laser.SetTime(lasercal::Time{(unsigned long) Line.TriggerTimeSec, (unsigned long) Line.TriggerTimeUsec});
+    if (DEBUG) Laser.Print();
+    
+    return Laser;
+}
+
 float LaserDataMerger::AttenuatorTickToPercentage(float Tick){
     if (LCS_ID == 1) {
         return (Tick - fEnergyMinMaxLCS1[0]) / (fEnergyMinMaxLCS1[1] - fEnergyMinMaxLCS1[0]);
@@ -0,0 +1,177 @@
+// TimeMapExtractor.cc
+//
+// Standalone replacement for a TimeMapProducer job. It opens the art ROOT files directly and reads only the
+// EventAuxiliary branch of the Events tree, so no services, geometry or raw digits are touched. The event times
+// are written in the same format as TimeMapProducer (TimeMapProducer/TimeAnalysis with event, time_s, time_ms),
+// one file TimeInfo-<run>.root per run, sorted by event number. This is the input of python/Merger.py.
+//
+// Usage: TimeMapExtractor [-j threads] [-o output directory] file.root [file.root ...]
+//        A file name starting with @ is read as a list of files (one per line).
+
+// Framework includes
+#include "art/Persistency/Provenance/EventAuxiliary.h"
+
+// ROOT includes
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TROOT.h"
+
+// C++ Includes
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    struct EventTime {
+        unsigned int Run;
+        unsigned int Event;
+        unsigned int TimeSec;
+        unsigned int TimeNsec;
+    };
+
+    // Reads run, event and time of all events of one file
+    bool ReadEventTimes(const std::string &FileName, std::vector<EventTime> &Times) {
+        std::unique_ptr<TFile> InputFile(TFile::Open(FileName.c_str(), "READ"));
+        if (!InputFile || InputFile->IsZombie()) {
+            std::cerr << "Error: Unable to open file " << FileName << std::endl;
+            return false;
+        }
+
+        TTree *Events = (TTree *) InputFile->Get("Events");
+        TBranch *AuxBranch = Events ? Events->GetBranch("EventAuxiliary") : nullptr;
+        if (!AuxBranch) {
+            std::cerr << "Error: No Events tree with EventAuxiliary branch in " << FileName << std::endl;
+            return false;
+        }
+
+        // Only the auxiliary branch is read, all data products stay on disk
+        Events->SetBranchStatus("*", 0);
+        Events->SetBranchStatus("EventAuxiliary*", 1);
+
+        art::EventAuxiliary Auxiliary;
+        art::EventAuxiliary *pAuxiliary = &Auxiliary;
+        AuxBranch->SetAddress(&pAuxiliary);
+
+        Long64_t NumberOfEvents = AuxBranch->GetEntries();
+        Times.reserve(Times.size() + NumberOfEvents);
+
+        for (Long64_t entry = 0; entry < NumberOfEvents; entry++) {
+            AuxBranch->GetEntry(entry);
+            Times.push_back({(unsigned int) Auxiliary.run(), (unsigned int) Auxiliary.event(),
+                             (unsigned int) Auxiliary.time().timeHigh(), (unsigned int) Auxiliary.time().timeLow()});
+        }
+        AuxBranch->ResetAddress();
+        return true;
+    }
+
+    // Writes the times of one run in the TimeMapProducer format
+    bool WriteRun(const std::string &FileName, std::vector<EventTime> &Times) {
+        std::sort(Times.begin(), Times.end(),
+                  [](const EventTime &a, const EventTime &b) { return a.Event < b.Event; });
+
+        TFile OutputFile(FileName.c_str(), "RECREATE");
+        if (OutputFile.IsZombie()) {
+            std::cerr << "Error: Unable to create file " << FileName << std::endl;
+            return false;
+        }
+        TDirectory *Directory = OutputFile.mkdir("TimeMapProducer");
+        Directory->cd();
+
+        unsigned int event, time_s, time_ms;
+        TTree TimeAnalysis("TimeAnalysis", "TimeAnalysis");
+        TimeAnalysis.Branch("event", &event);
+        TimeAnalysis.Branch("time_s", &time_s);
+        TimeAnalysis.Branch("time_ms", &time_ms);
+
+        for (const auto &Time : Times) {
+            event = Time.Event;
+            time_s = Time.TimeSec;
+            time_ms = Time.TimeNsec;
+            TimeAnalysis.Fill();
+        }
+        TimeAnalysis.Write();
+        OutputFile.Close();
+        return true;
+    }
+
+    void Usage() {
+        std::cerr << "Usage: TimeMapExtractor [-j threads] [-o output directory] file.root [file.root ...]\n"
+                  << "       A file name starting with @ is read as a list of files (one per line)." << std::endl;
+    }
+
+} // local namespace
+
+
+int main(int argc, char **argv) {
+    unsigned int NumberOfThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::string OutputDirectory = ".";
+    std::vector<std::string> FileNames;
+
+    for (int arg = 1; arg < argc; arg++) {
+        std::string Argument = argv[arg];
+        if (Argument == "-j" && arg + 1 < argc) {
+            NumberOfThreads = std::max(std::atoi(argv[++arg]), 1);
+        } else if (Argument == "-o" && arg + 1 < argc) {
+            OutputDirectory = argv[++arg];
+        } else if (Argument == "-h" || Argument == "--help") {
+            Usage();
+            return 0;
+        } else if (!Argument.empty() && Argument[0] == '@') {
+            std::ifstream List(Argument.substr(1));
+            std::string Line;
+            while (std::getline(List, Line)) {
+                if (!Line.empty() && Line[0] != '#') FileNames.push_back(Line);
+            }
+        } else {
+            FileNames.push_back(Argument);
+        }
+    }
+
+    if (FileNames.empty()) {
+        Usage();
+        return 1;
+    }
+
+    // Every thread opens its own files
+    ROOT::EnableThreadSafety();
+    NumberOfThreads = std::min<unsigned int>(NumberOfThreads, FileNames.size());
+
+    std::vector<std::vector<EventTime> > ThreadTimes(NumberOfThreads);
+    std::atomic<size_t> NextFile(0);
+    std::atomic<bool> Failed(false);
+
+    std::vector<std::thread> Threads;
+    for (unsigned int thread_no = 0; thread_no < NumberOfThreads; thread_no++) {
+        Threads.emplace_back([&, thread_no]() {
+            for (size_t file_no = NextFile++; file_no < FileNames.size(); file_no = NextFile++) {
+                if (!ReadEventTimes(FileNames[file_no], ThreadTimes[thread_no])) Failed = true;
+            }
+        });
+    }
+    for (auto &Thread : Threads) Thread.join();
+
+    // Collect the events of all files per run
+    std::map<unsigned int, std::vector<EventTime> > RunTimes;
+    for (auto &Times : ThreadTimes) {
+        for (const auto &Time : Times) RunTimes[Time.Run].push_back(Time);
+        Times.clear();
+    }
+
+    for (auto &Run : RunTimes) {
+        std::string OutputFile = OutputDirectory + "/TimeInfo-" + std::to_string(Run.first) + ".root";
+        std::cout << "Run " << Run.first << ": " << Run.second.size() << " events -> " << OutputFile << std::endl;
+        if (!WriteRun(OutputFile, Run.second)) Failed = true;
+    }
+
+    return Failed ? 1 : 0;
+}
@@ -1 +1,312 @@
 #include "Laser.h"
+
+#include "art/Utilities/Exception.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace lasercal
+{
+  Laser::Laser(){}
+
+  Laser::Laser(std::vector<lasercal::LaserTrack> Track) : fLaserTracks(std::move(Track))
+  {
+    fLaserBeams.assign(fLaserTracks.begin(), fLaserTracks.end());
+  }
+
+  Laser::Laser(std::vector<lasercal::LaserBeam> LaserBeam) : fLaserBeams(std::move(LaserBeam)){}
+
+  void Laser::AppendTrack(const lasercal::LaserTrack& Track)
+  {
+    fLaserTracks.push_back(Track);
+    fLaserBeams.push_back(Track);
+    fIndexValid = false;
+  }
+
+  void Laser::AppendBeam(const lasercal::LaserBeam& Beam)
+  {
+    fLaserBeams.push_back(Beam);
+  }
+
+  const lasercal::LaserTrack& Laser::GetTrack(const unsigned long int& TrackNumber) const
+  {
+    return fLaserTracks.at(TrackNumber);
+  }
+
+  const lasercal::LaserBeam& Laser::GetBeam(const unsigned long int& BeamNumber) const
+  {
+    return fLaserBeams.at(BeamNumber);
+  }
+
+  unsigned long int Laser::GetNumberOfTracks() const
+  {
+    return fLaserTracks.size();
+  }
+
+  unsigned long int Laser::GetNumberOfBeams() const
+  {
+    return fLaserBeams.size();
+  }
+
+  TVector3 Laser::GetSamplePosition(const LaserSampleRef& Ref) const
+  {
+    return fLaserTracks.at(Ref.Track).GetSamplePosition(Ref.Sample);
+  }
+
+  void Laser::BuildIndex(float CellSize)
+  {
+    if(!(CellSize > 0.f))
+    {
+      throw art::Exception(art::errors::Configuration) << "Laser: cell size of the index has to be positive\n";
+    }
+
+    // Bounding box of all samples
+    size_t NumberOfSamples = 0;
+    float Min[3], Max[3];
+    std::fill(Min, Min + 3, std::numeric_limits<float>::max());
+    std::fill(Max, Max + 3, std::numeric_limits<float>::lowest());
+    for(const auto& Track : fLaserTracks)
+    {
+      const LaserSampleView Samples = Track.GetSamples();
+      const float* Coordinates[3] = {Samples.X, Samples.Y, Samples.Z};
+      for(unsigned int axis = 0; axis < 3; axis++)
+      {
+        for(unsigned long sample_no = 0; sample_no < Samples.Size; sample_no++)
+        {
+          Min[axis] = std::min(Min[axis], Coordinates[axis][sample_no]);
+          Max[axis] = std::max(Max[axis], Coordinates[axis][sample_no]);
+        }
+      }
+      NumberOfSamples += Samples.Size;
+    }
+    if(NumberOfSamples >= std::numeric_limits<uint32_t>::max())
+    {
+      throw art::Exception(art::errors::LogicError) << "Laser: too many samples for the index\n";
+    }
+    if(NumberOfSamples == 0)
+    {
+      std::fill(Min, Min + 3, 0.f);
+      std::fill(Max, Max + 3, 0.f);
+    }
+
+    // Coarsen the cells for sparse scans, far more cells than samples only cost memory
+    size_t MaxCells = 8 * std::max<size_t>(NumberOfSamples, 1);
+    while(true)
+    {
+      size_t NumberOfCells = 1;
+      for(unsigned int axis = 0; axis < 3; axis++)
+      {
+        fIndexGrid.Origin[axis] = Min[axis];
+        fIndexGrid.Spacing[axis] = CellSize;
+        fIndexGrid.Size[axis] = (unsigned int) std::floor((Max[axis] - Min[axis]) / CellSize) + 1;
+        NumberOfCells *= fIndexGrid.Size[axis];
+      }
+      if(NumberOfCells <= MaxCells) break;
+      CellSize *= 1.26f;
+    }
+
+    // Counting sort of the samples by cell
+    const size_t NumberOfCells = fIndexGrid.NumberOfVoxels();
+    std::vector<uint32_t> SampleCells(NumberOfSamples);
+    fCellStart.assign(NumberOfCells + 1, 0);
+    size_t sample_index = 0;
+    for(const auto& Track : fLaserTracks)
+    {
+      const LaserSampleView Samples = Track.GetSamples();
+      for(unsigned long sample_no = 0; sample_no < Samples.Size; sample_no++)
+      {
+        const float Sample[3] = {Samples.X[sample_no], Samples.Y[sample_no], Samples.Z[sample_no]};
+        long Cell = fIndexGrid.VoxelIndex(Sample[0], Sample[1], Sample[2]);
+        // Samples on the upper border (rounding) go to the last cell
+        if(Cell < 0)
+        {
+          unsigned int Bin[3];
+          for(unsigned int axis = 0; axis < 3; axis++)
+          {
+            float Position = (Sample[axis] - fIndexGrid.Origin[axis]) / CellSize;
+            Bin[axis] = std::min((unsigned int) std::max(Position, 0.f), fIndexGrid.Size[axis] - 1);
+          }
+          Cell = fIndexGrid.Index(Bin[0], Bin[1], Bin[2]);
+        }
+        SampleCells[sample_index++] = (uint32_t) Cell;
+        fCellStart[Cell + 1]++;
+      }
+    }
+    for(size_t cell_no = 0; cell_no < NumberOfCells; cell_no++) fCellStart[cell_no + 1] += fCellStart[cell_no];
+
+    fCellSamples.resize(NumberOfSamples);
+    fCellX.resize(NumberOfSamples);
+    fCellY.resize(NumberOfSamples);
+    fCellZ.resize(NumberOfSamples);
+    std::vector<uint32_t> Fill(fCellStart.begin(), fCellStart.end() - 1);
+    sample_index = 0;
+    for(uint32_t track_no = 0; track_no < fLaserTracks.size(); track_no++)
+    {
+      const LaserSampleView Samples = fLaserTracks[track_no].GetSamples();
+      for(uint32_t sample_no = 0; sample_no < Samples.Size; sample_no++)
+      {
+        uint32_t Position = Fill[SampleCells[sample_index++]]++;
+        fCellSamples[Position] = {track_no, sample_no};
+        fCellX[Position] = Samples.X[sample_no];
+        fCellY[Position] = Samples.Y[sample_no];
+        fCellZ[Position] = Samples.Z[sample_no];
+      }
+    }
+
+    fIndexValid = true;
+  }
+
+  void Laser::CheckIndex() const
+  {
+    if(!fIndexValid)
+    {
+      throw art::Exception(art::errors::LogicError) << "Laser: spatial index is not built or out of date, "
+                                                    << "call BuildIndex after appending tracks\n";
+    }
+  }
+
+  bool Laser::CellRange(const float Min[3], const float Max[3], unsigned int Low[3], unsigned int High[3]) const
+  {
+    for(unsigned int axis = 0; axis < 3; axis++)
+    {
+      float Lower = (Min[axis] - fIndexGrid.Origin[axis]) / fIndexGrid.Spacing[axis];
+      float Upper = (Max[axis] - fIndexGrid.Origin[axis]) / fIndexGrid.Spacing[axis];
+      if(!(Upper >= 0.f) || !(Lower < float(fIndexGrid.Size[axis])) || Upper < Lower) return false;
+      Low[axis] = (unsigned int) std::max(Lower, 0.f);
+      High[axis] = std::min((unsigned int) Upper, fIndexGrid.Size[axis] - 1);
+    }
+    return true;
+  }
+
+  template<class Test>
+  void Laser::CollectCells(const unsigned int Low[3], const unsigned int High[3], const Test& Accept,
+                           std::vector<LaserSampleRef>& Result) const
+  {
+    for(unsigned int k = Low[2]; k <= High[2]; k++)
+    {
+      for(unsigned int j = Low[1]; j <= High[1]; j++)
+      {
+        // Cells along x are contiguous, so are their samples
+        uint32_t First = fCellStart[fIndexGrid.Index(Low[0], j, k)];
+        uint32_t Last = fCellStart[fIndexGrid.Index(High[0], j, k) + 1];
+        for(uint32_t position = First; position < Last; position++)
+        {
+          if(Accept(fCellX[position], fCellY[position], fCellZ[position])) Result.push_back(fCellSamples[position]);
+        }
+      }
+    }
+  }
+
+  void Laser::FindSamples(const TVector3& Point, float Radius, std::vector<LaserSampleRef>& Result) const
+  {
+    CheckIndex();
+    Result.clear();
+
+    const float Center[3] = {(float) Point.X(), (float) Point.Y(), (float) Point.Z()};
+    const float Min[3] = {Center[0] - Radius, Center[1] - Radius, Center[2] - Radius};
+    const float Max[3] = {Center[0] + Radius, Center[1] + Radius, Center[2] + Radius};
+    unsigned int Low[3], High[3];
+    if(!CellRange(Min, Max, Low, High)) return;
+
+    const float RadiusSquared = Radius * Radius;
+    auto Inside = [&Center, RadiusSquared](float X, float Y, float Z)
+    {
+      float dX = X - Center[0], dY = Y - Center[1], dZ = Z - Center[2];
+      return dX * dX + dY * dY + dZ * dZ <= RadiusSquared;
+    };
+    CollectCells(Low, High, Inside, Result);
+  }
+
+  void Laser::FindSamplesInBox(const float Min[3], const float Max[3], std::vector<LaserSampleRef>& Result) const
+  {
+    CheckIndex();
+    Result.clear();
+
+    unsigned int Low[3], High[3];
+    if(!CellRange(Min, Max, Low, High)) return;
+
+    auto Inside = [Min, Max](float X, float Y, float Z)
+    {
+      return X >= Min[0] && X <= Max[0] && Y >= Min[1] && Y <= Max[1] && Z >= Min[2] && Z <= Max[2];
+    };
+    CollectCells(Low, High, Inside, Result);
+  }
+
+  void Laser::FindSamplesAlongRay(const TVector3& Origin, const TVector3& Direction, float Radius,
+                                  std::vector<LaserSampleRef>& Result) const
+  {
+    CheckIndex();
+    Result.clear();
+    if(Direction.Mag() == 0.)
+    {
+      throw art::Exception(art::errors::LogicError) << "Laser: ray query without direction\n";
+    }
+
+    const TVector3 Unit = Direction.Unit();
+    const float Start[3] = {(float) Origin.X(), (float) Origin.Y(), (float) Origin.Z()};
+    const float Step[3] = {(float) Unit.X(), (float) Unit.Y(), (float) Unit.Z()};
+
+    // Clip the ray to the grid box widened by the radius (slab test)
+    float Enter = 0.f, Exit = std::numeric_limits<float>::max();
+    for(unsigned int axis = 0; axis < 3; axis++)
+    {
+      float Lower = fIndexGrid.Origin[axis] - Radius;
+      float Upper = fIndexGrid.Origin[axis] + fIndexGrid.Size[axis] * fIndexGrid.Spacing[axis] + Radius;
+      if(Step[axis] == 0.f)
+      {
+        if(Start[axis] < Lower || Start[axis] > Upper) return;
+        continue;
+      }
+      float Near = (Lower - Start[axis]) / Step[axis];
+      float Far = (Upper - Start[axis]) / Step[axis];
+      if(Near > Far) std::swap(Near, Far);
+      Enter = std::max(Enter, Near);
+      Exit = std::min(Exit, Far);
+    }
+    if(Enter > Exit) return;
+
+    // March in half cell steps, every point within the radius of the ray lies in the widened box of a step
+    const float Spacing = std::min({fIndexGrid.Spacing[0], fIndexGrid.Spacing[1], fIndexGrid.Spacing[2]});
+    const float StepLength = 0.5f * Spacing;
+    const float Reach = Radius + 0.5f * StepLength;
+    // Integer step count, a float parameter summed up step by step would drift on long rays
+    const unsigned long NumberOfSteps = (unsigned long) std::ceil((Exit - Enter) / StepLength);
+    std::vector<uint32_t> Cells;
+    for(unsigned long step_no = 0; step_no <= NumberOfSteps; step_no++)
+    {
+      float Parameter = std::min(Enter + step_no * StepLength, Exit);
+      float Min[3], Max[3];
+      for(unsigned int axis = 0; axis < 3; axis++)
+      {
+        float Position = Start[axis] + Parameter * Step[axis];
+        Min[axis] = Position - Reach;
+        Max[axis] = Position + Reach;
+      }
+      unsigned int Low[3], High[3];
+      if(!CellRange(Min, Max, Low, High)) continue;
+      for(unsigned int k = Low[2]; k <= High[2]; k++)
+        for(unsigned int j = Low[1]; j <= High[1]; j++)
+          for(unsigned int i = Low[0]; i <= High[0]; i++) Cells.push_back((uint32_t) fIndexGrid.Index(i, j, k));
+    }
+    std::sort(Cells.begin(), Cells.end());
+    Cells.erase(std::unique(Cells.begin(), Cells.end()), Cells.end());
+
+    const float RadiusSquared = Radius * Radius;
+    for(uint32_t Cell : Cells)
+    {
+      for(uint32_t position = fCellStart[Cell]; position < fCellStart[Cell + 1]; position++)
+      {
+        float Relative[3] = {fCellX[position] - Start[0], fCellY[position] - Start[1], fCellZ[position] - Start[2]};
+        float Projection = std::max(Relative[0] * Step[0] + Relative[1] * Step[1] + Relative[2] * Step[2], 0.f);
+        float DistanceSquared = 0.f;
+        for(unsigned int axis = 0; axis < 3; axis++)
+        {
+          float Distance = Relative[axis] - Projection * Step[axis];
+          DistanceSquared += Distance * Distance;
+        }
+        if(DistanceSquared <= RadiusSquared) Result.push_back(fCellSamples[position]);
+      }
+    }
+  }
+}
@@ -1,33 +1,120 @@
+/**
+ * @file   Laser.h
+ * @brief  Collection of laser tracks and beams with a spatial index over the track samples
+ */
+
+/// C/C++ standard library
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// Root library
+#include <TVector3.h>
+
+/// Laser library
 #include "LaserBeam.h"
 #include "LaserTrack.h"
+#include "LaserDistortionMap.h"
+
+#ifndef LASER_H
+#define LASER_H
 
 namespace lasercal
 {
+  /// Reference to one sample of a track in the collection
+  struct LaserSampleRef
+  {
+    uint32_t Track;
+    uint32_t Sample;
+  };
+
   /**
    * @brief Provides a base class for laser analysis purpose
-   * 
-   * 
+   *
+   * Holds all tracks (and beams) of a scan. After BuildIndex the samples of all tracks are sorted into a uniform
+   * grid of cells, so that neighbourhood and ray queries only look at the samples of the cells close to the query
+   * instead of scanning all tracks. Appending tracks invalidates the index.
    */
   class Laser
   {
-    Laser();
-    // Constructor using track (this includes already beam)
-    Laser(std::vector<lasercal::LaserTrack> Track);
-    // Constructor using beam and only beam is filled
-    Laser(std::vector<lasercal::LaserBeam> LaserBeam);
-    
-    std::vector<lasercal::LaserTrack> fLaserTracks;
-    std::vector<lasercal::LaserBeam> fLaserBeams;
-    
-    // here beam and track are filled
-    void AppendTrack(lasercal::LaserTrack);
-    // only beam is filled
-    void AppendBeam(lasercal::LaserBeam);
-    
-    lasercal::LaserTrack GetTrack(const unsigned long int&);
-    lasercal::LaserBeam GetBeam(const unsigned long int&);
-    
-    unsigned long int GetNumberOfTracks();
-    unsigned long int GetNumberOfBeams();
+    public:
+
+      Laser();
+      // Constructor using track (this includes already beam)
+      Laser(std::vector<lasercal::LaserTrack> Track);
+      // Constructor using beam and only beam is filled
+      Laser(std::vector<lasercal::LaserBeam> LaserBeam);
+
+      // here beam and track are filled
+      void AppendTrack(const lasercal::LaserTrack&);
+      // only beam is filled
+      void AppendBeam(const lasercal::LaserBeam&);
+
+      const lasercal::LaserTrack& GetTrack(const unsigned long int&) const;
+      const lasercal::LaserBeam& GetBeam(const unsigned long int&) const;
+
+      const std::vector<lasercal::LaserTrack>& GetTracks() const {return fLaserTracks;}
+
+      unsigned long int GetNumberOfTracks() const;
+      unsigned long int GetNumberOfBeams() const;
+
+      /**
+       * @brief Sorts the samples of all tracks into cells
+       * @param CellSize edge length of the cubic cells (cm), about the typical query radius works best
+       *
+       * The grid covers the bounding box of all samples. The cell size is increased if the grid would get
+       * more cells than eight times the number of samples.
+       */
+      void BuildIndex(float CellSize);
+
+      bool HasIndex() const {return fIndexValid;}
+
+      /**
+       * @brief All samples within Radius of Point
+       * @param Result found samples (cleared first)
+       * @throws art::Exception (LogicError) if the index is not built
+       */
+      void FindSamples(const TVector3& Point, float Radius, std::vector<LaserSampleRef>& Result) const;
+
+      /**
+       * @brief All samples inside the box (e.g. a voxel of a distortion map)
+       * @param Min, Max corners of the box
+       * @param Result found samples (cleared first)
+       */
+      void FindSamplesInBox(const float Min[3], const float Max[3], std::vector<LaserSampleRef>& Result) const;
+
+      /**
+       * @brief All samples within Radius of the ray Origin + t * Direction, t >= 0
+       * @param Result found samples (cleared first)
+       */
+      void FindSamplesAlongRay(const TVector3& Origin, const TVector3& Direction, float Radius,
+                               std::vector<LaserSampleRef>& Result) const;
+
+      /// Position of a found sample
+      TVector3 GetSamplePosition(const LaserSampleRef& Ref) const;
+
+    private:
+
+      std::vector<lasercal::LaserTrack> fLaserTracks;
+      std::vector<lasercal::LaserBeam> fLaserBeams;
+
+      /// Appends the samples of the cells in the (inclusive) cell range to the result if the test passes
+      template<class Test>
+      void CollectCells(const unsigned int Low[3], const unsigned int High[3], const Test& Accept,
+                        std::vector<LaserSampleRef>& Result) const;
+
+      void CheckIndex() const;
+
+      /// Cell range covering the box, false if the box misses the grid
+      bool CellRange(const float Min[3], const float Max[3], unsigned int Low[3], unsigned int High[3]) const;
+
+      // Spatial index: samples sorted by cell, the samples of cell c are [fCellStart[c], fCellStart[c + 1])
+      bool fIndexValid = false;
+      lasercal::LaserVoxelGrid fIndexGrid;
+      std::vector<uint32_t> fCellStart;
+      std::vector<LaserSampleRef> fCellSamples;
+      std::vector<float> fCellX, fCellY, fCellZ;   ///< sample positions in cell order (for the distance tests)
   };
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include "LaserObjects/LaserActiveVolume.h"
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "larcore/Geometry/Geometry.h"
+#include "larcore/Geometry/GeometryCore.h"
+
+#include <mutex>
+
+namespace {
+    std::mutex gActiveVolumeMutex;
+    bool gActiveVolumeSet = false;
+    lasercal::ActiveVolumeBox gActiveVolume;
+}
+
+void lasercal::LaserBeamArrays::reserve(size_t Size) {
+    PositionX.reserve(Size);
+    PositionY.reserve(Size);
+    PositionZ.reserve(Size);
+    DirectionX.reserve(Size);
+    DirectionY.reserve(Size);
+    DirectionZ.reserve(Size);
+}
+
+void lasercal::LaserBeamArrays::push_back(float X, float Y, float Z, float DirX, float DirY, float DirZ) {
+    PositionX.push_back(X);
+    PositionY.push_back(Y);
+    PositionZ.push_back(Z);
+    DirectionX.push_back(DirX);
+    DirectionY.push_back(DirY);
+    DirectionZ.push_back(DirZ);
+}
+
+void lasercal::LaserIntersectionArrays::resize(size_t Size) {
+    EntryX.resize(Size);
+    EntryY.resize(Size);
+    EntryZ.resize(Size);
+    ExitX.resize(Size);
+    ExitY.resize(Size);
+    ExitZ.resize(Size);
+    Hit.resize(Size);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+const lasercal::ActiveVolumeBox &lasercal::GetActiveVolume() {
+    std::lock_guard<std::mutex> Lock(gActiveVolumeMutex);
+
+    if (!gActiveVolumeSet) {
+        // Load geometry core
+        geo::GeometryCore const *Geometry = &*(art::ServiceHandle<geo::Geometry>());
+
+        // Create the active Volume (same definition as used before in LaserBeam)
+        gActiveVolume.Min[0] = 0;
+        gActiveVolume.Max[0] = 2 * Geometry->TPC().ActiveHalfWidth();
+        gActiveVolume.Min[1] = -Geometry->TPC().ActiveHalfHeight();
+        gActiveVolume.Max[1] = Geometry->TPC().ActiveHalfHeight();
+        gActiveVolume.Min[2] = 0;
+        gActiveVolume.Max[2] = Geometry->TPC().ActiveLength();
+
+        gActiveVolumeSet = true;
+    }
+    return gActiveVolume;
+}
+
+void lasercal::SetActiveVolume(const lasercal::ActiveVolumeBox &Box) {
+    std::lock_guard<std::mutex> Lock(gActiveVolumeMutex);
+
+    gActiveVolume = Box;
+    gActiveVolumeSet = true;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::IntersectBeams(const lasercal::ActiveVolumeBox &Box, const lasercal::LaserBeamArrays &Beams,
+                              lasercal::LaserIntersectionArrays &Intersections) {
+    const size_t NumberOfBeams = Beams.size();
+    Intersections.resize(NumberOfBeams);
+
+    const float *PX = Beams.PositionX.data();
+    const float *PY = Beams.PositionY.data();
+    const float *PZ = Beams.PositionZ.data();
+    const float *DX = Beams.DirectionX.data();
+    const float *DY = Beams.DirectionY.data();
+    const float *DZ = Beams.DirectionZ.data();
+
+    // Plain loop over contiguous arrays without branches, so that the compiler can vectorize it
+    for (size_t beam_no = 0; beam_no < NumberOfBeams; beam_no++) {
+        const float Position[3] = {PX[beam_no], PY[beam_no], PZ[beam_no]};
+        const float Direction[3] = {DX[beam_no], DY[beam_no], DZ[beam_no]};
+
+        float EntryParameter, ExitParameter;
+        const bool Hit = IntersectActiveVolume(Box, Position, Direction, EntryParameter, ExitParameter);
+
+        // Missing beams get zero entry and exit points (as in LaserBeam)
+        const float EntryScale = Hit ? EntryParameter : 0.f;
+        const float ExitScale = Hit ? ExitParameter : 0.f;
+        const float Mask = Hit ? 1.f : 0.f;
+
+        Intersections.EntryX[beam_no] = Mask * Position[0] + EntryScale * Direction[0];
+        Intersections.EntryY[beam_no] = Mask * Position[1] + EntryScale * Direction[1];
+        Intersections.EntryZ[beam_no] = Mask * Position[2] + EntryScale * Direction[2];
+        Intersections.ExitX[beam_no] = Mask * Position[0] + ExitScale * Direction[0];
+        Intersections.ExitY[beam_no] = Mask * Position[1] + ExitScale * Direction[1];
+        Intersections.ExitZ[beam_no] = Mask * Position[2] + ExitScale * Direction[2];
+        Intersections.Hit[beam_no] = Hit;
+    }
+}
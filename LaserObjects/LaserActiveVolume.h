@@ -0,0 +1,100 @@
+/**
+ * @file   LaserActiveVolume.h
+ * @brief  Cached TPC active volume and batch beam intersection (slab method)
+ */
+
+#ifndef lasercal_LaserActiveVolume_H
+#define lasercal_LaserActiveVolume_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+
+namespace lasercal
+{
+    /// Axis aligned box of the TPC active volume (same coordinates as LaserBeam)
+    struct ActiveVolumeBox {
+        float Min[3];
+        float Max[3];
+    };
+
+    /// Laser beams in structure-of-arrays layout for the batch intersection
+    struct LaserBeamArrays {
+        std::vector<float> PositionX, PositionY, PositionZ;
+        std::vector<float> DirectionX, DirectionY, DirectionZ;
+
+        size_t size() const { return PositionX.size(); }
+
+        void reserve(size_t Size);
+
+        void push_back(float X, float Y, float Z, float DirX, float DirY, float DirZ);
+    };
+
+    /// Entry and exit points of the batch intersection, Hit is 0 for beams missing the volume
+    struct LaserIntersectionArrays {
+        std::vector<float> EntryX, EntryY, EntryZ;
+        std::vector<float> ExitX, ExitY, ExitZ;
+        std::vector<unsigned char> Hit;
+
+        size_t size() const { return Hit.size(); }
+
+        void resize(size_t Size);
+    };
+
+    /**
+     * @brief Returns the TPC active volume, it is read from the geometry service only on the first call
+     */
+    const ActiveVolumeBox &GetActiveVolume();
+
+    /**
+     * @brief Overrides the cached active volume (e.g. for jobs without geometry service)
+     */
+    void SetActiveVolume(const ActiveVolumeBox &Box);
+
+    /**
+     * @brief Intersects a single beam with the box (slab method)
+     * @param Box active volume
+     * @param Position start point of the beam
+     * @param Direction direction of the beam (does not need to be normalized)
+     * @param EntryParameter line parameter of the entry point (output)
+     * @param ExitParameter line parameter of the exit point (output)
+     * @return true if the beam hits the volume in forward direction
+     *
+     * Same convention as geo::BoxBoundedGeo::GetIntersections: only intersections in forward direction count
+     * and a beam which starts inside the volume only has an exit point, which is also returned as entry point.
+     */
+    template<typename T>
+    inline bool IntersectActiveVolume(const ActiveVolumeBox &Box, const T Position[3], const T Direction[3],
+                                      T &EntryParameter, T &ExitParameter) {
+        T Near = -std::numeric_limits<T>::infinity();
+        T Far = std::numeric_limits<T>::infinity();
+
+        // Loop over the three slabs, parallel directions give infinite parameters
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            T Inverse = T(1) / Direction[axis];
+            T First = (T(Box.Min[axis]) - Position[axis]) * Inverse;
+            T Second = (T(Box.Max[axis]) - Position[axis]) * Inverse;
+
+            Near = std::max(Near, std::min(First, Second));
+            Far = std::min(Far, std::max(First, Second));
+        }
+
+        EntryParameter = (Near >= T(0)) ? Near : Far;
+        ExitParameter = Far;
+
+        return Far >= std::max(Near, T(0));
+    }
+
+    /**
+     * @brief Intersects all beams with the box at once
+     * @param Box active volume
+     * @param Beams start points and directions of all beams
+     * @param Intersections entry and exit points (resized to the number of beams, zero if not hit)
+     */
+    void IntersectBeams(const ActiveVolumeBox &Box, const LaserBeamArrays &Beams,
+                        LaserIntersectionArrays &Intersections);
+
+} // namespace lasercal
+
+#endif // lasercal_LaserActiveVolume_H
@@ -1,4 +1,5 @@
 #include "LaserBeam.h"
+#include "LaserActiveVolume.h"
 
 lasercal::LaserBeam::LaserBeam()
 {
@@ -18,6 +19,46 @@ lasercal::LaserBeam::LaserBeam(const TVector3& LaserPosition, const float& Phi,
     SetDirection(Phi,Theta);
 }
 
+lasercal::LaserBeam::LaserBeam(const lasercal::LaserBeamRecord& Record)
+{
+    fLaserPosition.SetXYZ(Record.Position[0], Record.Position[1], Record.Position[2]);
+    fDirection.SetXYZ(Record.Direction[0], Record.Direction[1], Record.Direction[2]);
+    fEntryPoint.SetXYZ(Record.EntryPoint[0], Record.EntryPoint[1], Record.EntryPoint[2]);
+    fExitPoint.SetXYZ(Record.ExitPoint[0], Record.ExitPoint[1], Record.ExitPoint[2]);
+    
+    fTime.sec = (unsigned long) Record.TimeSec;
+    fTime.usec = (unsigned long) Record.TimeUsec;
+    fLaserID = Record.LaserID;
+    fLaserEventID = Record.LaserEventID;
+    fAssosiateEventID = Record.AssociateEventID;
+    fAperturePosition = Record.AperturePosition;
+    fPower = Record.Power;
+}
+
+lasercal::LaserBeamRecord lasercal::LaserBeam::GetRecord() const
+{
+    lasercal::LaserBeamRecord Record;
+    
+    for(unsigned int axis = 0; axis < 3; axis++)
+    {
+	Record.Position[axis] = fLaserPosition[axis];
+	Record.Direction[axis] = fDirection[axis];
+	Record.EntryPoint[axis] = fEntryPoint[axis];
+	Record.ExitPoint[axis] = fExitPoint[axis];
+    }
+    
+    Record.TimeSec = fTime.sec;
+    Record.TimeUsec = fTime.usec;
+    Record.Power = fPower;
+    Record.AperturePosition = fAperturePosition;
+    Record.LaserID = fLaserID;
+    Record.LaserEventID = fLaserEventID;
+    Record.AssociateEventID = fAssosiateEventID;
+    Record.Reserved = 0;
+    
+    return Record;
+}
+
 void lasercal::LaserBeam::SetPosition(const TVector3& LaserPosition, const bool& ReCalcFlag)
 {
     fLaserPosition = LaserPosition;
@@ -67,31 +108,27 @@ void lasercal::LaserBeam::SetTime(const float& sec, const float& usec)
     fTime.usec = (unsigned long) usec;
 }
 
-// TODO: Fix class compilation if including GeometryCore.h and others!!!
 void lasercal::LaserBeam::SetIntersectionPoints()
 {   
-    // Load geometry core
-    geo::GeometryCore const* Geometry = &*(art::ServiceHandle<geo::Geometry>());
+    // Active volume is read from the geometry only once and then cached
+    const lasercal::ActiveVolumeBox& ActiveVolume = lasercal::GetActiveVolume();
     
-    // Create the active Volume
-    geo::BoxBoundedGeo ActiveVolume( 0,2*Geometry->TPC().ActiveHalfWidth(), // xmin, xmax
-				     -Geometry->TPC().ActiveHalfHeight(),Geometry->TPC().ActiveHalfHeight(), // ymin, ymax  
-				     0,Geometry->TPC().ActiveLength() // zmin, zmax 
-				    );
+    double Position[] = {fLaserPosition[0],fLaserPosition[1],fLaserPosition[2]};
+    double Direction[] = {fDirection[0],fDirection[1],fDirection[2]};
     
-    // Get the active volume and its intersection points
-    auto IntersectionPoints = ActiveVolume.GetIntersections(fLaserPosition, fDirection);
-
-    // Check if there is only an exit point (if laser head is in TPC volume)
-    if(IntersectionPoints.size() == 0)
+    // Get the intersection points of the beam with the active volume
+    double EntryParameter, ExitParameter;
+    
+    // Check if there is no intersection at all (if only an exit point exists it is used for both)
+    if(!lasercal::IntersectActiveVolume(ActiveVolume, Position, Direction, EntryParameter, ExitParameter))
     {
 	fEntryPoint = TVector3(0,0,0);
 	fExitPoint = TVector3(0,0,0);
     }
     else
     {
-	fEntryPoint = IntersectionPoints.front();
-	fExitPoint = IntersectionPoints.back();
+	fEntryPoint = fLaserPosition + EntryParameter*fDirection;
+	fExitPoint = fLaserPosition + ExitParameter*fDirection;
     }
 }
 
@@ -27,6 +27,8 @@
 
 #include "larcore/SimpleTypesAndConstants/geo_types.h"
 
+#include "LaserBeamRecord.h"
+
 // Framework includes
 
 
@@ -113,6 +115,19 @@ namespace lasercal
       
      
      #ifndef __GCCXML__
+     /**
+     * @brief Constructor: restores a laser beam from its compact record
+     * @param Record plain data record (see GetRecord)
+     *
+     * The intersection points are taken from the record and not recalculated.
+     */
+      explicit LaserBeam(const lasercal::LaserBeamRecord& Record);
+      
+     /**
+     * @brief Returns the compact plain data record of this beam (for run-level storage)
+     */
+      lasercal::LaserBeamRecord GetRecord() const;
+      
      /**
      * @brief Sets laser Position
      * @param LaserPosition start position of the laser 
@@ -138,6 +153,12 @@ namespace lasercal
      */
       void SetTime(const float& sec, const float& usec);
       
+    /**
+     * @brief Sets laser trigger time without the float conversion (keeps the full epoch precision)
+     * @param Time trigger time
+     */
+      inline void SetTime(const Time& Time) {fTime = Time;}
+      
       /**
        * @brief Return laser trigger time as Time struct
        */
@@ -0,0 +1,52 @@
+/**
+ * @file   LaserBeamRecord.h
+ * @brief  Compact plain data record of a laser beam for run-level storage
+ */
+
+#ifndef LASERBEAMRECORD_H
+#define LASERBEAMRECORD_H
+
+#include <cstdint>
+
+#ifndef __GCCXML__
+#include <type_traits>
+#endif
+
+namespace lasercal
+{
+  /**
+   * @brief Plain, trivially copyable copy of the lasercal::LaserBeam data members
+   *
+   * LaserBeam holds its vectors as TVector3 (TObject with streamer), which makes every beam large and slow
+   * to stream. This record stores the same information in fixed size members only, so ROOT can split it
+   * into one branch per member and it can be read as a flat table (also from numpy).
+   * Positions and directions are stored with float precision, times with their full integer precision.
+   * The error vectors of LaserBeam are not stored, they are not filled anywhere yet.
+   */
+  struct LaserBeamRecord
+  {
+    int64_t TimeSec;               ///< Trigger time recorded by laser server (epoch seconds)
+    int64_t TimeUsec;              ///< Fraction of the trigger time in microseconds
+
+    float Position[3];             ///< Laser start position (last mirror before the TPC)
+    float Direction[3];            ///< Direction of the Laser beam
+    float EntryPoint[3];           ///< First Point in TPC
+    float ExitPoint[3];            ///< Last Point in TPC
+
+    float Power;                   ///< Attenuator setting (not measured pulse energy)
+    float AperturePosition;        ///< Aperture position
+
+    uint32_t LaserID;              ///< Laser System identifier (1 = upstream, 2 = downstream, 0 = no beam)
+    uint32_t LaserEventID;         ///< Laser event id (not daq)
+    uint32_t AssociateEventID;     ///< ID of the assosiate event id
+    uint32_t Reserved;             ///< Padding to a multiple of 8 bytes, always 0
+  };
+
+#ifndef __GCCXML__
+  static_assert(std::is_trivial<LaserBeamRecord>::value && std::is_standard_layout<LaserBeamRecord>::value,
+                "LaserBeamRecord has to stay a plain data record");
+  static_assert(sizeof(LaserBeamRecord) == 88, "LaserBeamRecord layout changed, update the readers");
+#endif
+}
+
+#endif
@@ -0,0 +1,46 @@
+#include "LaserBeamTable.h"
+
+#include "art/Utilities/Exception.h"
+
+#include <algorithm>
+
+void lasercal::LaserBeamTable::SetBeam(std::size_t Event, const lasercal::LaserBeam& LaserBeam)
+{
+    SetRecord(Event, LaserBeam.GetRecord());
+}
+
+void lasercal::LaserBeamTable::SetRecord(std::size_t Event, const lasercal::LaserBeamRecord& Record)
+{
+    if (Event >= fRecords.size())
+    {
+	// Value initialization gives empty records (LaserID 0) for the skipped events
+	fRecords.resize(Event + 1, lasercal::LaserBeamRecord());
+    }
+    fRecords[Event] = Record;
+}
+
+lasercal::LaserBeam lasercal::LaserBeamTable::GetBeam(std::size_t Event) const
+{
+    if (!HasBeam(Event))
+    {
+	throw art::Exception(art::errors::ProductNotFound) << "LaserBeamTable: no laser beam for event "
+	    << Event << " (table size " << fRecords.size() << ")\n";
+    }
+    return lasercal::LaserBeam(fRecords[Event]);
+}
+
+const lasercal::LaserBeamRecord& lasercal::LaserBeamTable::GetRecord(std::size_t Event) const
+{
+    if (Event >= fRecords.size())
+    {
+	throw art::Exception(art::errors::ProductNotFound) << "LaserBeamTable: no record for event "
+	    << Event << " (table size " << fRecords.size() << ")\n";
+    }
+    return fRecords[Event];
+}
+
+std::size_t lasercal::LaserBeamTable::NumberOfBeams() const
+{
+    return std::count_if(fRecords.begin(), fRecords.end(),
+			 [](const lasercal::LaserBeamRecord& Record) { return Record.LaserID != 0; });
+}
@@ -0,0 +1,81 @@
+/**
+ * @file   LaserBeamTable.h
+ * @brief  Run-level table of all laser beams of a run, indexed by event number
+ */
+
+#ifndef LASERBEAMTABLE_H
+#define LASERBEAMTABLE_H
+
+#include <vector>
+#include <cstddef>
+
+#include "LaserBeamRecord.h"
+#include "LaserBeam.h"
+
+namespace lasercal
+{
+  /**
+   * @brief All laser beams of one run as a single art::Run product
+   *
+   * The LaserDataMerger can put this table once per run instead of a LaserBeam into every event. The beams are
+   * stored as LaserBeamRecord in a dense vector indexed by the event number, so consumers fetch their entry in
+   * constant time and modules can look at the whole scan already in beginRun. Events without laser data keep
+   * an empty record (LaserID 0).
+   */
+  class LaserBeamTable
+  {
+    public:
+      LaserBeamTable() = default;
+
+#ifndef __GCCXML__
+      /**
+       * @brief Stores the beam of an event, the table grows as needed
+       */
+      void SetBeam(std::size_t Event, const lasercal::LaserBeam& LaserBeam);
+
+      /**
+       * @brief Stores the record of an event, the table grows as needed
+       */
+      void SetRecord(std::size_t Event, const lasercal::LaserBeamRecord& Record);
+
+      /**
+       * @brief True if a beam was stored for this event
+       */
+      bool HasBeam(std::size_t Event) const
+      {
+        return Event < fRecords.size() && fRecords[Event].LaserID != 0;
+      }
+
+      /**
+       * @brief Returns the beam of an event
+       * @throws art::Exception (ProductNotFound) if there is no beam for this event
+       */
+      lasercal::LaserBeam GetBeam(std::size_t Event) const;
+
+      /**
+       * @brief Returns the record of an event (check HasBeam first)
+       * @throws art::Exception (ProductNotFound) if the event is beyond the table
+       */
+      const lasercal::LaserBeamRecord& GetRecord(std::size_t Event) const;
+
+      /// All records, index is the event number
+      const std::vector<lasercal::LaserBeamRecord>& GetRecords() const { return fRecords; }
+
+      /// Size of the table (largest stored event number + 1)
+      std::size_t size() const { return fRecords.size(); }
+
+      /// Number of events with a stored beam
+      std::size_t NumberOfBeams() const;
+
+      void reserve(std::size_t Size) { fRecords.reserve(Size); }
+
+      void clear() { fRecords.clear(); }
+#endif
+
+    private:
+      std::vector<lasercal::LaserBeamRecord> fRecords;   ///< Beam records, index is the event number
+
+  }; // class LaserBeamTable
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "LaserObjects/LaserColumnFile.h"
+
+#include "art/Utilities/Exception.h"
+#include "cetlib/exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <algorithm>
+
+#include <unistd.h>
+
+namespace {
+    const char kColumnMagic[8] = {'L', 'A', 'S', 'E', 'R', 'C', 'O', 'L'};
+    const uint32_t kColumnVersion = 1;
+
+    struct ColumnHeader {
+        char Magic[8];
+        uint32_t Version;
+        char Type[4];
+        uint64_t Count;
+        uint64_t Reserved;
+    };
+
+    static_assert(sizeof(ColumnHeader) == lasercal::LaserColumnFile::kHeaderSize, "Column header layout changed");
+
+    inline bool IsLittleEndian() {
+        const uint16_t Probe = 1;
+        return *reinterpret_cast<const uint8_t *>(&Probe) == 1;
+    }
+
+    void WriteHeader(std::FILE *File, const char *Type, uint64_t Count) {
+        ColumnHeader Header;
+        std::memcpy(Header.Magic, kColumnMagic, sizeof(kColumnMagic));
+        Header.Version = kColumnVersion;
+        std::memset(Header.Type, 0, sizeof(Header.Type));
+        std::strncpy(Header.Type, Type, sizeof(Header.Type) - 1);
+        Header.Count = Count;
+        Header.Reserved = 0;
+        std::fwrite(&Header, sizeof(Header), 1, File);
+    }
+}
+
+constexpr size_t lasercal::LaserColumnFile::kHeaderSize;
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserColumnFile::LaserColumnFile(const std::string &FileName, const char *Type, size_t ElementSize,
+                                           size_t BufferSize)
+        : fFileName(FileName), fTempName(FileName + ".tmp" + std::to_string(getpid())), fType(Type),
+          fTypeName(Type) {
+    if (!IsLittleEndian()) {
+        throw art::Exception(art::errors::UnimplementedFeature)
+                << "LaserColumnFile: only little endian hosts are supported\n";
+    }
+
+    fFile = std::fopen(fTempName.c_str(), "wb");
+    if (!fFile) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserColumnFile: unable to create " << fTempName << "\n";
+    }
+
+    // Placeholder header, the count is set in Close
+    WriteHeader(fFile, fType.c_str(), 0);
+    fBuffer.reserve(std::max<size_t>(BufferSize, 1) * ElementSize);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserColumnFile::LaserColumnFile(LaserColumnFile &&Other)
+        : fFileName(std::move(Other.fFileName)), fTempName(std::move(Other.fTempName)),
+          fType(std::move(Other.fType)), fTypeName(Other.fTypeName), fFile(Other.fFile),
+          fBuffer(std::move(Other.fBuffer)), fCount(Other.fCount) {
+    Other.fFile = nullptr;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserColumnFile::~LaserColumnFile() {
+    if (!fFile) return;
+    try {
+        Close();
+    } catch (...) {
+        mf::LogWarning("LaserColumnFile") << "Unable to close column " << fFileName;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserColumnFile::Flush() {
+    if (fBuffer.empty()) return;
+    if (std::fwrite(fBuffer.data(), 1, fBuffer.size(), fFile) != fBuffer.size()) {
+        throw cet::exception("FileWriteError") << "LaserColumnFile: unable to write to " << fTempName << "\n";
+    }
+    fBuffer.clear();
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserColumnFile::TypeMismatch(const char *Type) const {
+    throw art::Exception(art::errors::LogicError) << "LaserColumnFile: value of type " << Type << " appended to "
+                                                  << fFileName << " of type " << fType << "\n";
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserColumnFile::Close() {
+    if (!fFile) return;
+    Flush();
+
+    // Rewrite the header with the final count
+    std::rewind(fFile);
+    WriteHeader(fFile, fType.c_str(), fCount);
+    bool Failed = std::ferror(fFile);
+    Failed |= (std::fclose(fFile) != 0);
+    fFile = nullptr;
+
+    if (Failed || std::rename(fTempName.c_str(), fFileName.c_str()) != 0) {
+        std::remove(fTempName.c_str());
+        throw cet::exception("FileWriteError") << "LaserColumnFile: unable to write " << fFileName << "\n";
+    }
+}
@@ -0,0 +1,114 @@
+/**
+ * @file   LaserColumnFile.h
+ * @brief  Buffered writer for flat binary column files that numpy can memory map
+ */
+
+#ifndef lasercal_LaserColumnFile_H
+#define lasercal_LaserColumnFile_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+namespace lasercal
+{
+    /// numpy type string of the column element types (little endian)
+    template<class T> struct ColumnType;
+    template<> struct ColumnType<uint8_t>  { static constexpr const char *Name() { return "|u1"; } };
+    template<> struct ColumnType<int16_t>  { static constexpr const char *Name() { return "<i2"; } };
+    template<> struct ColumnType<uint16_t> { static constexpr const char *Name() { return "<u2"; } };
+    template<> struct ColumnType<int32_t>  { static constexpr const char *Name() { return "<i4"; } };
+    template<> struct ColumnType<uint32_t> { static constexpr const char *Name() { return "<u4"; } };
+    template<> struct ColumnType<int64_t>  { static constexpr const char *Name() { return "<i8"; } };
+    template<> struct ColumnType<uint64_t> { static constexpr const char *Name() { return "<u8"; } };
+    template<> struct ColumnType<float>    { static constexpr const char *Name() { return "<f4"; } };
+    template<> struct ColumnType<double>   { static constexpr const char *Name() { return "<f8"; } };
+
+    /**
+     * @brief Writes one column (one value per row) to a flat binary file
+     *
+     * File layout: a 32 byte header followed by the values as a plain little endian array.
+     *   char     Magic[8]   "LASERCOL"
+     *   uint32   Version    1
+     *   char     Type[4]    numpy type string, e.g. "<f4"
+     *   uint64   Count      number of values
+     *   uint64   Reserved   0
+     * In python: numpy.memmap(FileName, dtype=Type, mode="r", offset=32, shape=(Count,))
+     *
+     * Values are collected in a buffer and written in large blocks. Write failures throw a cet::exception of category
+     * FileWriteError. The file is written as <FileName>.tmp<pid> and only renamed to its final name by Close (after
+     * the count in the header is set), so readers never see a half written column.
+     */
+    class LaserColumnFile {
+    public:
+        static constexpr size_t kHeaderSize = 32;
+
+        /**
+         * @brief Opens the column file
+         * @param FileName final name of the file
+         * @param Type numpy type string of the values (see ColumnType)
+         * @param ElementSize size of one value in bytes
+         * @param BufferSize number of values collected before a block is written
+         * @throws art::Exception (FileOpenError) if the file cannot be created
+         */
+        LaserColumnFile(const std::string &FileName, const char *Type, size_t ElementSize, size_t BufferSize = 65536);
+
+        /// Makes a column for values of type T
+        template<class T>
+        static LaserColumnFile Make(const std::string &FileName, size_t BufferSize = 65536) {
+            static_assert(std::is_trivially_copyable<T>::value, "Columns hold plain values only");
+            return LaserColumnFile(FileName, ColumnType<T>::Name(), sizeof(T), BufferSize);
+        }
+
+        LaserColumnFile(LaserColumnFile &&Other);
+
+        LaserColumnFile(const LaserColumnFile &) = delete;
+
+        LaserColumnFile &operator=(const LaserColumnFile &) = delete;
+
+        ~LaserColumnFile();
+
+        /**
+         * @brief Appends one value
+         * @throws art::Exception (LogicError) if T does not match the type given at construction
+         */
+        template<class T>
+        void push_back(const T &Value) {
+            // Usually the same literal, the string compare only runs if the linker did not merge them
+            const char *Type = ColumnType<T>::Name();
+            if (Type != fTypeName && std::strcmp(Type, fTypeName) != 0) TypeMismatch(Type);
+            if (fBuffer.size() + sizeof(T) > fBuffer.capacity()) Flush();
+            const char *Bytes = reinterpret_cast<const char *>(&Value);
+            fBuffer.insert(fBuffer.end(), Bytes, Bytes + sizeof(T));
+            fCount++;
+        }
+
+        /// Number of values written so far
+        uint64_t size() const { return fCount; }
+
+        const std::string &GetFileName() const { return fFileName; }
+
+        /// Writes the remaining values and the final header and moves the file to its final name
+        void Close();
+
+    private:
+        void Flush();
+
+        [[noreturn]] void TypeMismatch(const char *Type) const;
+
+        std::string fFileName;
+        std::string fTempName;
+        std::string fType;
+        const char *fTypeName;      ///< type given at construction (checked by push_back)
+        std::FILE *fFile = nullptr;
+        std::vector<char> fBuffer;
+        uint64_t fCount = 0;
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserColumnFile_H
@@ -0,0 +1,227 @@
+#include "LaserObjects/LaserDataFile.h"
+
+#include "art/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+    // Binary cache layout: header followed by the records as they are in memory
+    const char kCacheMagic[8] = {'L', 'A', 'S', 'E', 'R', 'D', 'A', 'T'};
+    const uint32_t kCacheVersion = 1;
+
+    struct CacheHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t RecordSize;
+        uint64_t Count;
+        uint64_t SourceSize;
+        int64_t SourceTime;
+    };
+
+    const unsigned int kNumberOfColumns = 15;
+
+    inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserDataFile::LaserDataFile(const std::string &FileName, bool UseCache) : fFileName(FileName) {
+    struct stat Status;
+    if (stat(fFileName.c_str(), &Status) != 0) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserDataFile: unable to open file " << fFileName << "\n";
+    }
+    fSourceSize = Status.st_size;
+    fSourceTime = Status.st_mtime;
+
+    if (UseCache && ReadCache()) {
+        fFromCache = true;
+        return;
+    }
+
+    ParseText();
+
+    if (UseCache) WriteCache();
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+std::string lasercal::LaserDataFile::CacheName(const std::string &FileName) {
+    return FileName + ".cache";
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+size_t lasercal::LaserDataFile::Parse(const char *Begin, const char *End, std::vector<LaserDataRecord> &Records) {
+    // Each token is copied to a small buffer, since strtod needs a terminated string and the mapped file is not
+    char Token[64];
+    double Values[kNumberOfColumns];
+
+    const char *Position = Begin;
+    size_t LineNumber = 0;
+
+    while (Position < End) {
+        LineNumber++;
+        unsigned int Column = 0;
+
+        // Loop over the tokens of one line
+        while (Position < End && *Position != '\n') {
+            if (IsBlank(*Position)) {
+                Position++;
+                continue;
+            }
+
+            const char *TokenBegin = Position;
+            while (Position < End && !IsBlank(*Position) && *Position != '\n') Position++;
+            size_t Length = Position - TokenBegin;
+
+            // Additional columns are ignored, as in the old reader
+            if (Column >= kNumberOfColumns) continue;
+            if (Length >= sizeof(Token)) return LineNumber;
+
+            std::memcpy(Token, TokenBegin, Length);
+            Token[Length] = '\0';
+
+            char *TokenEnd;
+            Values[Column] = std::strtod(Token, &TokenEnd);
+            if (TokenEnd != Token + Length) return LineNumber;
+            Column++;
+        }
+        if (Position < End) Position++; // skip the line break
+
+        // Empty lines are skipped, incomplete lines are an error
+        if (Column == 0) continue;
+        if (Column < kNumberOfColumns) return LineNumber;
+
+        LaserDataRecord Record;
+        Record.LaserSystem = (int32_t) Values[0];
+        Record.Status = (int32_t) Values[1];
+        Record.RotaryPosition = Values[2];
+        Record.LinearPosition = Values[3];
+        Record.AttenuatorPosition = Values[4];
+        Record.AperturePosition = Values[5];
+        Record.TriggerTimeSec = (int64_t) Values[6];
+        Record.TriggerTimeUsec = (int64_t) Values[7];
+        Record.TriggerCount = (int32_t) Values[8];
+        Record.RunControlStep = (int32_t) Values[9];
+        Record.LaserShotCounter = (int32_t) Values[10];
+        Record.MirrorBoxAxis1 = Values[11];
+        Record.MirrorBoxAxis2 = Values[12];
+        Record.MirrorFeedthroughAxis1 = Values[13];
+        Record.MirrorFeedthroughAxis2 = Values[14];
+        Record.Reserved = 0;
+
+        Records.push_back(Record);
+    }
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDataFile::ParseText() {
+    fRecords.clear();
+    if (fSourceSize == 0) return;
+
+    int FileDescriptor = open(fFileName.c_str(), O_RDONLY);
+    if (FileDescriptor < 0) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserDataFile: unable to open file " << fFileName << "\n";
+    }
+
+    void *Mapping = mmap(nullptr, fSourceSize, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+    close(FileDescriptor);
+    if (Mapping == MAP_FAILED) {
+        throw art::Exception(art::errors::FileReadError) << "LaserDataFile: unable to map file " << fFileName << "\n";
+    }
+    madvise(Mapping, fSourceSize, MADV_SEQUENTIAL);
+
+    const char *Begin = static_cast<const char *>(Mapping);
+    const char *End = Begin + fSourceSize;
+
+    // A line has at least 30 characters, this avoids most of the reallocations
+    fRecords.reserve(fSourceSize / 30);
+    size_t BadLine = Parse(Begin, End, fRecords);
+
+    munmap(Mapping, fSourceSize);
+
+    if (BadLine) {
+        throw art::Exception(art::errors::FileReadError) << "LaserDataFile: malformed line " << BadLine
+                                                         << " in " << fFileName << "\n";
+    }
+    fRecords.shrink_to_fit();
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+bool lasercal::LaserDataFile::ReadCache() {
+    struct stat CacheStatus;
+    if (stat(CacheName(fFileName).c_str(), &CacheStatus) != 0) return false;
+
+    std::ifstream Cache(CacheName(fFileName), std::ios::in | std::ios::binary);
+    if (!Cache) return false;
+
+    CacheHeader Header;
+    if (!Cache.read(reinterpret_cast<char *>(&Header), sizeof(Header))) return false;
+
+    // Only use the cache if it belongs to exactly this version of the text file
+    if (std::memcmp(Header.Magic, kCacheMagic, sizeof(kCacheMagic)) != 0
+        || Header.Version != kCacheVersion
+        || Header.RecordSize != sizeof(LaserDataRecord)
+        || Header.SourceSize != fSourceSize
+        || Header.SourceTime != fSourceTime) {
+        mf::LogInfo("LaserDataFile") << "Cache of " << fFileName << " is outdated, parsing the text file";
+        return false;
+    }
+
+    // The record count has to match the cache size, a corrupt count must not allocate before the read fails
+    if ((uint64_t) CacheStatus.st_size < sizeof(Header)
+        || Header.Count != ((uint64_t) CacheStatus.st_size - sizeof(Header)) / sizeof(LaserDataRecord)
+        || ((uint64_t) CacheStatus.st_size - sizeof(Header)) % sizeof(LaserDataRecord) != 0) {
+        mf::LogWarning("LaserDataFile") << "Cache of " << fFileName << " is corrupt, parsing the text file";
+        return false;
+    }
+
+    fRecords.resize(Header.Count);
+    if (!Cache.read(reinterpret_cast<char *>(fRecords.data()), Header.Count * sizeof(LaserDataRecord))) {
+        fRecords.clear();
+        return false;
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDataFile::WriteCache() const {
+    CacheHeader Header;
+    std::memcpy(Header.Magic, kCacheMagic, sizeof(kCacheMagic));
+    Header.Version = kCacheVersion;
+    Header.RecordSize = sizeof(LaserDataRecord);
+    Header.Count = fRecords.size();
+    Header.SourceSize = fSourceSize;
+    Header.SourceTime = fSourceTime;
+
+    // Write to a temporary file first, so that concurrent jobs never see a half written cache
+    std::string CacheFile = CacheName(fFileName);
+    std::string TempFile = CacheFile + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream Cache(TempFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        Cache.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+        Cache.write(reinterpret_cast<const char *>(fRecords.data()), fRecords.size() * sizeof(LaserDataRecord));
+        if (!Cache) {
+            std::remove(TempFile.c_str());
+            mf::LogWarning("LaserDataFile") << "Unable to write cache " << CacheFile;
+            return;
+        }
+    }
+    if (std::rename(TempFile.c_str(), CacheFile.c_str()) != 0) {
+        std::remove(TempFile.c_str());
+        mf::LogWarning("LaserDataFile") << "Unable to write cache " << CacheFile;
+    }
+}
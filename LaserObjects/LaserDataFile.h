@@ -0,0 +1,109 @@
+/**
+ * @file   LaserDataFile.h
+ * @brief  Memory mapped reader for the laser data files (Run-<N>.txt) with a binary cache
+ */
+
+#ifndef lasercal_LaserDataFile_H
+#define lasercal_LaserDataFile_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+namespace lasercal
+{
+    /**
+     * @brief One line of the laser data file with typed columns
+     *
+     * The columns are the same as in the text file (see DataStructure in LaserDataMerger). Times and counters
+     * are stored as integers, so the epoch seconds do not lose precision as they did in float.
+     */
+    struct LaserDataRecord {
+        int64_t TriggerTimeSec;             ///< Epoch time (in seconds) of Laser Server at receive of Encoder data
+        int64_t TriggerTimeUsec;            ///< Fraction to add to Epoch time in microseconds
+
+        double RotaryPosition;              ///< Position Rotary Heidenhain Encoder
+        double LinearPosition;              ///< Position Linear Heidenhain Encoder
+        double AttenuatorPosition;          ///< Position Attenuator Watt Pilot
+        double AperturePosition;            ///< Position Iris Standa
+        double MirrorBoxAxis1;              ///< Motorized Mirror Zaber T-OMG at box
+        double MirrorBoxAxis2;              ///< Motorized Mirror Zaber T-OMG at box
+        double MirrorFeedthroughAxis1;      ///< Motorized Mirror Zaber T-OMG at flange
+        double MirrorFeedthroughAxis2;      ///< Motorized Mirror Zaber T-OMG at flange
+
+        int32_t LaserSystem;                ///< which laser system: 1 or 2
+        int32_t Status;                     ///< not defined yet
+        int32_t TriggerCount;               ///< Trigger Counter by Heidenhain Encoder
+        int32_t RunControlStep;             ///< Run Counter of step in calibration run
+        int32_t LaserShotCounter;           ///< Number of pulses shot with UV laser (not yet read out)
+        int32_t Reserved;                   ///< Padding, always 0
+    };
+
+    static_assert(std::is_trivial<LaserDataRecord>::value && std::is_standard_layout<LaserDataRecord>::value,
+                  "LaserDataRecord is written to the binary cache as is");
+
+    /**
+     * @brief Reads a laser data file into typed records
+     *
+     * The text file is memory mapped and parsed in one pass without any per line allocation. After parsing,
+     * the records are written to a binary cache next to the text file (<file>.cache). Later jobs load this cache
+     * directly, as long as size and modification time of the text file did not change. If the cache cannot be
+     * written (e.g. read only directory) the text file is simply parsed every time.
+     */
+    class LaserDataFile {
+    public:
+        /**
+         * @brief Reads the file (or its cache)
+         * @param FileName path of the text file
+         * @param UseCache read and write the binary cache
+         * @throws art::Exception (FileOpenError / FileReadError) if the file is missing or malformed
+         */
+        explicit LaserDataFile(const std::string &FileName, bool UseCache = true);
+
+        const std::vector<LaserDataRecord> &GetRecords() const { return fRecords; }
+
+        /// Moves the records out of the reader (the reader is empty afterwards)
+        std::vector<LaserDataRecord> TakeRecords() { return std::move(fRecords); }
+
+        const LaserDataRecord &at(size_t Index) const { return fRecords.at(Index); }
+
+        size_t size() const { return fRecords.size(); }
+
+        bool empty() const { return fRecords.empty(); }
+
+        /// True if the records were loaded from the binary cache
+        bool FromCache() const { return fFromCache; }
+
+        /// Name of the binary cache belonging to a text file
+        static std::string CacheName(const std::string &FileName);
+
+        /**
+         * @brief Parses the text of a laser data file (whitespace separated, 15 columns per line)
+         * @param Begin first character
+         * @param End one past the last character (the text does not need to be null terminated)
+         * @param Records parsed records are appended here
+         * @return 0 on success, otherwise the number of the first malformed line (starting at 1)
+         */
+        static size_t Parse(const char *Begin, const char *End, std::vector<LaserDataRecord> &Records);
+
+    private:
+        void ParseText();
+
+        bool ReadCache();
+
+        void WriteCache() const;
+
+        std::string fFileName;
+        uint64_t fSourceSize = 0;
+        int64_t fSourceTime = 0;
+        bool fFromCache = false;
+
+        std::vector<LaserDataRecord> fRecords;
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserDataFile_H
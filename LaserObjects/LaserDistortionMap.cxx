@@ -0,0 +1,496 @@
+#include "LaserObjects/LaserDistortionMap.h"
+
+#include "art/Utilities/Exception.h"
+#include "cetlib/exception.h"
+
+#include <TDirectory.h>
+#include <TH3F.h>
+
+#include <thread>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+
+namespace {
+    const char kAccumulatorMagic[8] = {'L', 'A', 'S', 'E', 'R', 'A', 'C', 'C'};
+    const uint32_t kAccumulatorVersion = 1;
+
+    struct AccumulatorHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t HeaderSize;
+        float Origin[3];
+        float Spacing[3];
+        uint32_t Size[3];
+        uint32_t RecordSize;
+        uint32_t FirstRun;
+        uint32_t LastRun;
+        uint64_t Outside;
+        uint64_t Inputs;
+    };
+
+    static_assert(sizeof(AccumulatorHeader) == 80, "Accumulator header layout changed");
+    static_assert(sizeof(lasercal::VoxelDisplacement) == 56, "Voxel record layout changed");
+
+    // Displacement from the point to its projection onto the line (Direction has to be normalized)
+    inline void LineDisplacement(const double Position[3], const double Direction[3],
+                                 double X, double Y, double Z, double Displacement[3]) {
+        double Relative[3] = {X - Position[0], Y - Position[1], Z - Position[2]};
+        double Projection = Relative[0] * Direction[0] + Relative[1] * Direction[1] + Relative[2] * Direction[2];
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            Displacement[axis] = Projection * Direction[axis] - Relative[axis];
+        }
+    }
+
+    // Plain arrays of the line, the direction is normalized
+    inline void LineArrays(const TVector3 &LinePosition, const TVector3 &LineDirection,
+                           double Position[3], double Direction[3]) {
+        TVector3 Unit = LineDirection.Unit();
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            Position[axis] = LinePosition[axis];
+            Direction[axis] = Unit[axis];
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserVoxelGrid::LaserVoxelGrid() : Origin{0.f, 0.f, 0.f}, Spacing{1.f, 1.f, 1.f}, Size{0, 0, 0} {
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserVoxelGrid::LaserVoxelGrid(const ActiveVolumeBox &Box, const unsigned int NumberOfVoxels[3]) {
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        if (NumberOfVoxels[axis] == 0 || !(Box.Max[axis] > Box.Min[axis])) {
+            throw art::Exception(art::errors::Configuration) << "LaserVoxelGrid: empty grid along axis " << axis
+                                                             << "\n";
+        }
+        Origin[axis] = Box.Min[axis];
+        Size[axis] = NumberOfVoxels[axis];
+        Spacing[axis] = (Box.Max[axis] - Box.Min[axis]) / NumberOfVoxels[axis];
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserVoxelGrid::VoxelCenter(size_t VoxelIndex, float Center[3]) const {
+    size_t Bin[3];
+    Bin[0] = VoxelIndex % Size[0];
+    Bin[1] = (VoxelIndex / Size[0]) % Size[1];
+    Bin[2] = VoxelIndex / (size_t(Size[0]) * Size[1]);
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        Center[axis] = Origin[axis] + (Bin[axis] + 0.5f) * Spacing[axis];
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::VoxelDisplacement::Merge(const VoxelDisplacement &Other) {
+    Entries += Other.Entries;
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        Sum[axis] += Other.Sum[axis];
+        SumSquares[axis] += Other.SumSquares[axis];
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+double lasercal::VoxelDisplacement::RMS(unsigned int axis) const {
+    if (!Entries) return 0.;
+    double Mean = Sum[axis] / Entries;
+    // Rounding can give tiny negative variances for constant displacements
+    return std::sqrt(std::max(SumSquares[axis] / Entries - Mean * Mean, 0.));
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDisplacementMap::WriteHistograms(TDirectory *Directory, const std::string &Prefix) const {
+    const char *Names[8] = {"DisplacementX", "DisplacementY", "DisplacementZ", "RMSX", "RMSY", "RMSZ", "Entries",
+                            "Valid"};
+    const std::vector<float> *Values[6] = {&DisplacementX, &DisplacementY, &DisplacementZ, &RMSX, &RMSY, &RMSZ};
+
+    TDirectory::TContext Context(Directory);
+    for (unsigned int hist_no = 0; hist_no < 8; hist_no++) {
+        std::string Name = Prefix + Names[hist_no];
+        TH3F Hist(Name.c_str(), Name.c_str(),
+                  Grid.Size[0], Grid.Origin[0], Grid.Origin[0] + Grid.Size[0] * Grid.Spacing[0],
+                  Grid.Size[1], Grid.Origin[1], Grid.Origin[1] + Grid.Size[1] * Grid.Spacing[1],
+                  Grid.Size[2], Grid.Origin[2], Grid.Origin[2] + Grid.Size[2] * Grid.Spacing[2]);
+        Hist.SetDirectory(nullptr);
+
+        for (unsigned int k = 0; k < Grid.Size[2]; k++) {
+            for (unsigned int j = 0; j < Grid.Size[1]; j++) {
+                for (unsigned int i = 0; i < Grid.Size[0]; i++) {
+                    size_t Index = Grid.Index(i, j, k);
+                    float Value = (hist_no < 6) ? (*Values[hist_no])[Index]
+                                                : (float) ((hist_no == 6) ? Entries[Index] : Valid[Index]);
+                    Hist.SetBinContent(i + 1, j + 1, k + 1, Value);
+                }
+            }
+        }
+        Directory->WriteTObject(&Hist);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserDisplacementMap lasercal::LaserDisplacementMap::ReadHistograms(TDirectory *Directory,
+                                                                            const std::string &Prefix) {
+    const char *Names[8] = {"DisplacementX", "DisplacementY", "DisplacementZ", "RMSX", "RMSY", "RMSZ", "Entries",
+                            "Valid"};
+
+    LaserDisplacementMap Map;
+    std::vector<float> *Values[6] = {&Map.DisplacementX, &Map.DisplacementY, &Map.DisplacementZ,
+                                     &Map.RMSX, &Map.RMSY, &Map.RMSZ};
+
+    TH3 *Reference = nullptr;
+    if (Directory) Directory->GetObject((Prefix + Names[0]).c_str(), Reference);
+    if (!Reference) {
+        throw art::Exception(art::errors::FileReadError) << "LaserDisplacementMap: no histogram "
+                                                         << Prefix + Names[0] << "\n";
+    }
+
+    const TAxis *Axes[3] = {Reference->GetXaxis(), Reference->GetYaxis(), Reference->GetZaxis()};
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        Map.Grid.Origin[axis] = Axes[axis]->GetXmin();
+        Map.Grid.Size[axis] = Axes[axis]->GetNbins();
+        Map.Grid.Spacing[axis] = (Axes[axis]->GetXmax() - Axes[axis]->GetXmin()) / Axes[axis]->GetNbins();
+    }
+    const size_t NumberOfVoxels = Map.Grid.NumberOfVoxels();
+
+    bool HasEntries = true, HasValid = true;
+    for (unsigned int hist_no = 0; hist_no < 8; hist_no++) {
+        TH3 *Hist = nullptr;
+        Directory->GetObject((Prefix + Names[hist_no]).c_str(), Hist);
+
+        // Only the displacements are required
+        if (!Hist && hist_no >= 3) {
+            if (hist_no < 6) Values[hist_no]->assign(NumberOfVoxels, 0.f);
+            else if (hist_no == 6) Map.Entries.assign(NumberOfVoxels, 0);
+            HasEntries &= (hist_no != 6);
+            HasValid &= (hist_no != 7);
+            continue;
+        }
+        if (!Hist || Hist->GetNbinsX() != (int) Map.Grid.Size[0] || Hist->GetNbinsY() != (int) Map.Grid.Size[1]
+            || Hist->GetNbinsZ() != (int) Map.Grid.Size[2]) {
+            throw art::Exception(art::errors::FileReadError) << "LaserDisplacementMap: missing or inconsistent "
+                                                             << "histogram " << Prefix + Names[hist_no] << "\n";
+        }
+
+        std::vector<float> Content(NumberOfVoxels);
+        for (unsigned int k = 0; k < Map.Grid.Size[2]; k++) {
+            for (unsigned int j = 0; j < Map.Grid.Size[1]; j++) {
+                for (unsigned int i = 0; i < Map.Grid.Size[0]; i++) {
+                    Content[Map.Grid.Index(i, j, k)] = Hist->GetBinContent(i + 1, j + 1, k + 1);
+                }
+            }
+        }
+
+        if (hist_no < 6) {
+            *Values[hist_no] = std::move(Content);
+        } else if (hist_no == 6) {
+            Map.Entries.assign(Content.begin(), Content.end());
+        } else {
+            for (auto Flag : Content) Map.Valid.push_back(Flag > 0.5f);
+        }
+    }
+
+    // Older files have no validity: the voxels with entries are valid, without entries all voxels
+    if (!HasValid) {
+        Map.Valid.resize(NumberOfVoxels);
+        for (size_t voxel_no = 0; voxel_no < NumberOfVoxels; voxel_no++) {
+            Map.Valid[voxel_no] = HasEntries ? (Map.Entries[voxel_no] > 0) : 1;
+        }
+    }
+
+    return Map;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserDistortionMapBuilder::LaserDistortionMapBuilder(const LaserVoxelGrid &Grid,
+                                                               unsigned int NumberOfThreads)
+        : fGrid(Grid), fNumberOfThreads(std::max(NumberOfThreads, 1u)), fPartialGrids(1) {
+    fPartialGrids.front().Voxels.resize(fGrid.NumberOfVoxels());
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::Fill(PartialGrid &Partial, const TVector3 &LinePosition,
+                                               const TVector3 &LineDirection, const float *X, const float *Y,
+                                               const float *Z, size_t NumberOfPoints) const {
+    double Position[3], Direction[3], Displacement[3];
+    LineArrays(LinePosition, LineDirection, Position, Direction);
+
+    for (size_t point_no = 0; point_no < NumberOfPoints; point_no++) {
+        long Voxel = fGrid.VoxelIndex(X[point_no], Y[point_no], Z[point_no]);
+        if (Voxel < 0) {
+            Partial.Outside++;
+            continue;
+        }
+        LineDisplacement(Position, Direction, X[point_no], Y[point_no], Z[point_no], Displacement);
+        Partial.Voxels[Voxel].Add(Displacement[0], Displacement[1], Displacement[2]);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::FillTrack(PartialGrid &Partial, const LaserTrack &Track) const {
+    const LaserSampleView Samples = Track.GetSamples();
+    Fill(Partial, Track.GetLaserPosition(), Track.GetLaserDirection(), Samples.X, Samples.Y, Samples.Z, Samples.Size);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::AddPoints(const float *X, const float *Y, const float *Z,
+                                                    size_t NumberOfPoints, const TVector3 &LinePosition,
+                                                    const TVector3 &LineDirection) {
+    fFilled = true;
+    Fill(fPartialGrids.front(), LinePosition, LineDirection, X, Y, Z, NumberOfPoints);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::AddTrack(const LaserTrack &Track) {
+    fFilled = true;
+    FillTrack(fPartialGrids.front(), Track);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::AddTracks(const std::vector<LaserTrack> &Tracks) {
+    fFilled = true;
+
+    // Small inputs are not worth the extra grids
+    unsigned int NumberOfThreads = (unsigned int) std::min<size_t>(fNumberOfThreads, Tracks.size());
+    if (NumberOfThreads <= 1) {
+        for (const auto &Track : Tracks) FillTrack(fPartialGrids.front(), Track);
+        return;
+    }
+
+    // The first partial grid belongs to the calling thread, the others are added until the next reduction
+    if (fPartialGrids.size() < NumberOfThreads) {
+        fPartialGrids.resize(NumberOfThreads);
+        for (auto &Partial : fPartialGrids) Partial.Voxels.resize(fGrid.NumberOfVoxels());
+    }
+    fReduced = false;
+
+    size_t TracksPerThread = (Tracks.size() + NumberOfThreads - 1) / NumberOfThreads;
+    auto Worker = [this, &Tracks, TracksPerThread](unsigned int thread_no) {
+        size_t First = thread_no * TracksPerThread;
+        size_t Last = std::min(First + TracksPerThread, Tracks.size());
+        for (size_t track_no = First; track_no < Last; track_no++) {
+            FillTrack(fPartialGrids[thread_no], Tracks[track_no]);
+        }
+    };
+
+    std::vector<std::thread> Threads;
+    for (unsigned int thread_no = 1; thread_no < NumberOfThreads; thread_no++) {
+        Threads.emplace_back(Worker, thread_no);
+    }
+    Worker(0);
+    for (auto &Thread : Threads) Thread.join();
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::Reduce() {
+    if (fReduced) return;
+
+    PartialGrid &Total = fPartialGrids.front();
+    for (size_t grid_no = 1; grid_no < fPartialGrids.size(); grid_no++) {
+        const PartialGrid &Partial = fPartialGrids[grid_no];
+        for (size_t voxel_no = 0; voxel_no < Total.Voxels.size(); voxel_no++) {
+            Total.Voxels[voxel_no].Merge(Partial.Voxels[voxel_no]);
+        }
+        Total.Outside += Partial.Outside;
+    }
+
+    // Free the partial grids, they are only allocated again for the next multi-threaded fill
+    fPartialGrids.resize(1);
+    fReduced = true;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+const std::vector<lasercal::VoxelDisplacement> &lasercal::LaserDistortionMapBuilder::GetVoxels() {
+    Reduce();
+    return fPartialGrids.front().Voxels;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserDisplacementMap lasercal::LaserDistortionMapBuilder::GetMap(unsigned int MinEntries) {
+    const std::vector<VoxelDisplacement> &Voxels = GetVoxels();
+
+    LaserDisplacementMap Map;
+    Map.Grid = fGrid;
+    size_t NumberOfVoxels = Voxels.size();
+    for (auto *Values : {&Map.DisplacementX, &Map.DisplacementY, &Map.DisplacementZ,
+                         &Map.RMSX, &Map.RMSY, &Map.RMSZ}) {
+        Values->assign(NumberOfVoxels, 0.f);
+    }
+    Map.Entries.assign(NumberOfVoxels, 0);
+    Map.Valid.assign(NumberOfVoxels, 0);
+
+    for (size_t voxel_no = 0; voxel_no < NumberOfVoxels; voxel_no++) {
+        const VoxelDisplacement &Voxel = Voxels[voxel_no];
+        Map.Entries[voxel_no] = (uint32_t) std::min<uint64_t>(Voxel.Entries, UINT32_MAX);
+        if (Voxel.Entries == 0 || Voxel.Entries < MinEntries) continue;
+
+        Map.Valid[voxel_no] = 1;
+        Map.DisplacementX[voxel_no] = Voxel.Mean(0);
+        Map.DisplacementY[voxel_no] = Voxel.Mean(1);
+        Map.DisplacementZ[voxel_no] = Voxel.Mean(2);
+        Map.RMSX[voxel_no] = Voxel.RMS(0);
+        Map.RMSY[voxel_no] = Voxel.RMS(1);
+        Map.RMSZ[voxel_no] = Voxel.RMS(2);
+    }
+
+    return Map;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+size_t lasercal::LaserDistortionMapBuilder::GetNumberOfOutside() const {
+    size_t Outside = 0;
+    for (const auto &Partial : fPartialGrids) Outside += Partial.Outside;
+    return Outside;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::MergeRuns(unsigned int FirstRun, unsigned int LastRun) {
+    if (FirstRun == 0 && LastRun == 0) return;
+    if (fFirstRun == 0 && fLastRun == 0) {
+        fFirstRun = FirstRun;
+        fLastRun = LastRun;
+        return;
+    }
+    fFirstRun = std::min(fFirstRun, FirstRun);
+    fLastRun = std::max(fLastRun, LastRun);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::Merge(LaserDistortionMapBuilder &Other) {
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        if (Other.fGrid.Size[axis] != fGrid.Size[axis] || Other.fGrid.Origin[axis] != fGrid.Origin[axis]
+            || Other.fGrid.Spacing[axis] != fGrid.Spacing[axis]) {
+            throw art::Exception(art::errors::Configuration) << "LaserDistortionMapBuilder: cannot merge "
+                                                             << "different grids\n";
+        }
+    }
+
+    const std::vector<VoxelDisplacement> &OtherVoxels = Other.GetVoxels();
+    Reduce();
+    PartialGrid &Total = fPartialGrids.front();
+    for (size_t voxel_no = 0; voxel_no < Total.Voxels.size(); voxel_no++) {
+        Total.Voxels[voxel_no].Merge(OtherVoxels[voxel_no]);
+    }
+    Total.Outside += Other.fPartialGrids.front().Outside;
+
+    fMergedInputs += Other.fMergedInputs + (Other.fFilled ? 1 : 0);
+    MergeRuns(Other.fFirstRun, Other.fLastRun);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::Merge(const std::string &FileName) {
+    std::FILE *File = std::fopen(FileName.c_str(), "rb");
+    if (!File) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserDistortionMapBuilder: unable to open "
+                                                         << FileName << "\n";
+    }
+
+    AccumulatorHeader Header;
+    bool Valid = (std::fread(&Header, sizeof(Header), 1, File) == 1)
+                 && std::memcmp(Header.Magic, kAccumulatorMagic, sizeof(kAccumulatorMagic)) == 0
+                 && Header.Version == kAccumulatorVersion
+                 && Header.HeaderSize == sizeof(AccumulatorHeader)
+                 && Header.RecordSize == sizeof(VoxelDisplacement);
+    for (unsigned int axis = 0; Valid && axis < 3; axis++) {
+        Valid = Header.Size[axis] == fGrid.Size[axis] && Header.Origin[axis] == fGrid.Origin[axis]
+                && Header.Spacing[axis] == fGrid.Spacing[axis];
+    }
+    if (!Valid) {
+        std::fclose(File);
+        throw art::Exception(art::errors::FileReadError) << "LaserDistortionMapBuilder: " << FileName
+                                                         << " is not an accumulator (version "
+                                                         << kAccumulatorVersion << ") of this grid\n";
+    }
+
+    // Read in blocks and add right away, so the file never needs a second full grid in memory
+    Reduce();
+    PartialGrid &Total = fPartialGrids.front();
+    std::vector<VoxelDisplacement> Block(std::min<size_t>(Total.Voxels.size(), 65536));
+    for (size_t first = 0; first < Total.Voxels.size(); first += Block.size()) {
+        size_t BlockSize = std::min(Block.size(), Total.Voxels.size() - first);
+        if (std::fread(Block.data(), sizeof(VoxelDisplacement), BlockSize, File) != BlockSize) {
+            std::fclose(File);
+            throw art::Exception(art::errors::FileReadError) << "LaserDistortionMapBuilder: " << FileName
+                                                             << " is truncated\n";
+        }
+        for (size_t voxel_no = 0; voxel_no < BlockSize; voxel_no++) {
+            Total.Voxels[first + voxel_no].Merge(Block[voxel_no]);
+        }
+    }
+    std::fclose(File);
+
+    Total.Outside += Header.Outside;
+    fMergedInputs += Header.Inputs;
+    MergeRuns(Header.FirstRun, Header.LastRun);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::Write(const std::string &FileName) {
+    const std::vector<VoxelDisplacement> &Voxels = GetVoxels();
+
+    AccumulatorHeader Header;
+    std::memset(&Header, 0, sizeof(Header));
+    std::memcpy(Header.Magic, kAccumulatorMagic, sizeof(kAccumulatorMagic));
+    Header.Version = kAccumulatorVersion;
+    Header.HeaderSize = sizeof(AccumulatorHeader);
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        Header.Origin[axis] = fGrid.Origin[axis];
+        Header.Spacing[axis] = fGrid.Spacing[axis];
+        Header.Size[axis] = fGrid.Size[axis];
+    }
+    Header.RecordSize = sizeof(VoxelDisplacement);
+    Header.FirstRun = fFirstRun;
+    Header.LastRun = fLastRun;
+    Header.Outside = GetNumberOfOutside();
+    Header.Inputs = fMergedInputs + (fFilled ? 1 : 0);
+
+    // Write to a temporary file first, so that a merge never reads a half written accumulator
+    std::string TempName = FileName + ".tmp" + std::to_string(getpid());
+    std::FILE *File = std::fopen(TempName.c_str(), "wb");
+    if (!File) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserDistortionMapBuilder: unable to create "
+                                                         << TempName << "\n";
+    }
+
+    bool Failed = (std::fwrite(&Header, sizeof(Header), 1, File) != 1);
+    Failed |= (std::fwrite(Voxels.data(), sizeof(VoxelDisplacement), Voxels.size(), File) != Voxels.size());
+    Failed |= (std::fclose(File) != 0);
+
+    if (Failed || std::rename(TempName.c_str(), FileName.c_str()) != 0) {
+        std::remove(TempName.c_str());
+        throw cet::exception("FileWriteError") << "LaserDistortionMapBuilder: unable to write " << FileName << "\n";
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionMapBuilder::clear() {
+    fPartialGrids.assign(1, PartialGrid());
+    fPartialGrids.front().Voxels.resize(fGrid.NumberOfVoxels());
+    fReduced = true;
+    fFirstRun = fLastRun = 0;
+    fMergedInputs = 0;
+    fFilled = false;
+}
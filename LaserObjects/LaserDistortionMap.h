@@ -0,0 +1,223 @@
+/**
+ * @file   LaserDistortionMap.h
+ * @brief  Voxel grid accumulator turning reconstructed laser tracks into a 3D displacement map
+ */
+
+#ifndef lasercal_LaserDistortionMap_H
+#define lasercal_LaserDistortionMap_H
+
+#include "LaserObjects/LaserActiveVolume.h"
+#include "LaserObjects/LaserTrack.h"
+
+#include <TVector3.h>
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+class TDirectory;
+
+namespace lasercal
+{
+    /// Regular voxel grid, voxel (i, j, k) covers Origin + [i, i + 1) * Spacing (same coordinates as LaserBeam)
+    struct LaserVoxelGrid {
+        float Origin[3];
+        float Spacing[3];
+        unsigned int Size[3];
+
+        LaserVoxelGrid();
+
+        /// Grid over the box with the given number of voxels per axis
+        LaserVoxelGrid(const ActiveVolumeBox &Box, const unsigned int NumberOfVoxels[3]);
+
+        size_t NumberOfVoxels() const { return size_t(Size[0]) * Size[1] * Size[2]; }
+
+        /// Linear index of voxel (i, j, k), x runs fastest
+        size_t Index(unsigned int i, unsigned int j, unsigned int k) const {
+            return (size_t(k) * Size[1] + j) * Size[0] + i;
+        }
+
+        /// Linear index of the voxel containing the point, -1 for points outside the grid
+        long VoxelIndex(float X, float Y, float Z) const {
+            const float Point[3] = {X, Y, Z};
+            unsigned int Bin[3];
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                float Position = (Point[axis] - Origin[axis]) / Spacing[axis];
+                // Negated comparison also rejects NaN
+                if (!(Position >= 0.f) || Position >= float(Size[axis])) return -1;
+                Bin[axis] = std::min((unsigned int) Position, Size[axis] - 1);
+            }
+            return (long) Index(Bin[0], Bin[1], Bin[2]);
+        }
+
+        /// Center of the voxel with the linear index
+        void VoxelCenter(size_t VoxelIndex, float Center[3]) const;
+    };
+
+    /// Displacement statistics of one voxel. Only sums are kept, so partial grids add up exactly.
+    struct VoxelDisplacement {
+        uint64_t Entries;
+        double Sum[3];
+        double SumSquares[3];
+
+        VoxelDisplacement() : Entries(0), Sum{0., 0., 0.}, SumSquares{0., 0., 0.} {}
+
+        void Add(double dX, double dY, double dZ) {
+            Entries++;
+            Sum[0] += dX;
+            Sum[1] += dY;
+            Sum[2] += dZ;
+            SumSquares[0] += dX * dX;
+            SumSquares[1] += dY * dY;
+            SumSquares[2] += dZ * dZ;
+        }
+
+        void Merge(const VoxelDisplacement &Other);
+
+        double Mean(unsigned int axis) const { return Entries ? Sum[axis] / Entries : 0.; }
+
+        /// Spread of the displacements in the voxel (not the error of the mean)
+        double RMS(unsigned int axis) const;
+    };
+
+    /**
+     * @brief Displacement field: mean displacement from the reconstructed to the true position per voxel
+     *
+     * Only the voxels flagged in Valid have a measured displacement. The others (no entries or fewer than
+     * requested) hold zero, but keep their entries.
+     */
+    struct LaserDisplacementMap {
+        LaserVoxelGrid Grid;
+        std::vector<float> DisplacementX, DisplacementY, DisplacementZ;
+        std::vector<float> RMSX, RMSY, RMSZ;
+        std::vector<uint32_t> Entries;
+        std::vector<uint8_t> Valid;     ///< 1 if the displacement of the voxel is measured
+
+        size_t size() const { return Entries.size(); }
+
+        /**
+         * @brief Writes the field as TH3F histograms (displacement, RMS and entries) into the directory
+         * @param Directory target directory (e.g. a TFileService directory)
+         * @param Prefix prepended to the histogram names
+         */
+        void WriteHistograms(TDirectory *Directory, const std::string &Prefix = "") const;
+
+        /**
+         * @brief Reads a field written by WriteHistograms, RMS, entries and validity are optional
+         *
+         * Without validity histogram the voxels with entries are valid (all voxels if there are no entries either).
+         * @param Directory directory holding the histograms
+         * @param Prefix prepended to the histogram names
+         */
+        static LaserDisplacementMap ReadHistograms(TDirectory *Directory, const std::string &Prefix = "");
+    };
+
+    /**
+     * @brief Accumulates displacements of reconstructed track points towards their true beam line on a voxel grid
+     *
+     * The displacement of a point is the vector from the reconstructed point to the closest point of the true beam
+     * line. It is binned at the reconstructed position, so the map corrects reconstructed coordinates. Every worker
+     * thread fills its own partial grid, they are only summed when the statistics are requested. Each partial grid
+     * holds 56 bytes per voxel.
+     *
+     * The sums can be written per run and merged later (like hadd), so a new run only adds its own accumulator:
+     *   char     Magic[8]      "LASERACC"
+     *   uint32   Version       1
+     *   uint32   HeaderSize    80 (offset of the first voxel)
+     *   float    Origin[3], Spacing[3]
+     *   uint32   Size[3]
+     *   uint32   RecordSize    56
+     *   uint32   FirstRun, LastRun   run range of the merged inputs (0 if unknown)
+     *   uint64   Outside       points outside of the grid
+     *   uint64   Inputs        number of merged accumulators
+     * followed by one VoxelDisplacement record per voxel (uint64 Entries, double Sum[3], double SumSquares[3]).
+     */
+    class LaserDistortionMapBuilder {
+    public:
+        LaserDistortionMapBuilder(const LaserVoxelGrid &Grid, unsigned int NumberOfThreads = 1);
+
+        /**
+         * @brief Adds the displacements of reconstructed points towards a true beam line
+         * @param X, Y, Z reconstructed points
+         * @param NumberOfPoints number of points
+         * @param LinePosition any point of the true beam line (e.g. laser position)
+         * @param LineDirection direction of the true beam line (does not need to be normalized)
+         */
+        void AddPoints(const float *X, const float *Y, const float *Z, size_t NumberOfPoints,
+                       const TVector3 &LinePosition, const TVector3 &LineDirection);
+
+        /// Adds the samples of the track against its laser beam
+        void AddTrack(const LaserTrack &Track);
+
+        /// Spreads the tracks over the worker threads, every thread fills its own partial grid
+        void AddTracks(const std::vector<LaserTrack> &Tracks);
+
+        /// Summed statistics of all partial grids
+        const std::vector<VoxelDisplacement> &GetVoxels();
+
+        /**
+         * @brief Returns the displacement field
+         * @param MinEntries voxels with fewer entries are set to zero displacement and flagged as not valid
+         */
+        LaserDisplacementMap GetMap(unsigned int MinEntries = 1);
+
+        const LaserVoxelGrid &GetGrid() const { return fGrid; }
+
+        /// Number of points outside of the grid
+        size_t GetNumberOfOutside() const;
+
+        /// Sets the run of the accumulated tracks (stored in the accumulator file)
+        void SetRun(unsigned int Run) { fFirstRun = fLastRun = Run; }
+
+        unsigned int GetFirstRun() const { return fFirstRun; }
+
+        unsigned int GetLastRun() const { return fLastRun; }
+
+        /// Adds the sums of another builder with the same grid
+        void Merge(LaserDistortionMapBuilder &Other);
+
+        /**
+         * @brief Adds the sums of an accumulator file, O(voxels)
+         * @throws art::Exception (FileOpenError, FileReadError) if the file is unreadable or has a different grid
+         */
+        void Merge(const std::string &FileName);
+
+        /**
+         * @brief Writes the summed statistics (through a temporary file)
+         * @throws art::Exception (FileOpenError) if the file cannot be created
+         * @throws cet::exception (FileWriteError) if the file cannot be written
+         */
+        void Write(const std::string &FileName);
+
+        void clear();
+
+    private:
+        struct PartialGrid {
+            std::vector<VoxelDisplacement> Voxels;
+            size_t Outside = 0;
+        };
+
+        void Fill(PartialGrid &Partial, const TVector3 &LinePosition, const TVector3 &LineDirection,
+                  const float *X, const float *Y, const float *Z, size_t NumberOfPoints) const;
+
+        void FillTrack(PartialGrid &Partial, const LaserTrack &Track) const;
+
+        void Reduce();
+
+        void MergeRuns(unsigned int FirstRun, unsigned int LastRun);
+
+        LaserVoxelGrid fGrid;
+        unsigned int fNumberOfThreads;
+        std::vector<PartialGrid> fPartialGrids;   ///< one per thread, the first one keeps the reduced statistics
+        bool fReduced = true;
+        unsigned int fFirstRun = 0;
+        unsigned int fLastRun = 0;
+        uint64_t fMergedInputs = 0;   ///< accumulators merged from files
+        bool fFilled = false;         ///< tracks or points added directly
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserDistortionMap_H
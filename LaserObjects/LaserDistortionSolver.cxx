@@ -0,0 +1,175 @@
+#include "LaserObjects/LaserDistortionSolver.h"
+#include "LaserObjects/LaserMapInterpolator.h"
+
+#include "art/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserDistortionSolver::LaserDistortionSolver(const LaserVoxelGrid &Grid, unsigned int NumberOfThreads)
+        : fGrid(Grid), fNumberOfThreads(std::max(NumberOfThreads, 1u)) {
+    const size_t NumberOfVoxels = fGrid.NumberOfVoxels();
+    if (NumberOfVoxels == 0) {
+        throw art::Exception(art::errors::Configuration) << "LaserDistortionSolver: empty grid\n";
+    }
+
+    fMap.Grid = fGrid;
+    for (auto *Values : {&fMap.DisplacementX, &fMap.DisplacementY, &fMap.DisplacementZ,
+                         &fMap.RMSX, &fMap.RMSY, &fMap.RMSZ}) {
+        Values->assign(NumberOfVoxels, 0.f);
+    }
+    fMap.Entries.assign(NumberOfVoxels, 0);
+    fMap.Valid.assign(NumberOfVoxels, 0);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionSolver::CheckGrid(const LaserVoxelGrid &Grid) const {
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        if (Grid.Size[axis] != fGrid.Size[axis] || Grid.Origin[axis] != fGrid.Origin[axis]
+            || Grid.Spacing[axis] != fGrid.Spacing[axis]) {
+            throw art::Exception(art::errors::Configuration) << "LaserDistortionSolver: start map has a different "
+                                                             << "grid\n";
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionSolver::SetStartMap(const LaserDisplacementMap &Map) {
+    CheckGrid(Map.Grid);
+    fMap.DisplacementX = Map.DisplacementX;
+    fMap.DisplacementY = Map.DisplacementY;
+    fMap.DisplacementZ = Map.DisplacementZ;
+    fMap.Valid = Map.Valid;
+    fConverged = false;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserDistortionSolver::SetStartMap(const LaserMapFile &MapFile) {
+    CheckGrid(MapFile.GetGrid());
+    const size_t NumberOfVoxels = fGrid.NumberOfVoxels();
+    const float *X = MapFile.Data(LaserMapFile::kDisplacementX);
+    const float *Y = MapFile.Data(LaserMapFile::kDisplacementY);
+    const float *Z = MapFile.Data(LaserMapFile::kDisplacementZ);
+    fMap.DisplacementX.assign(X, X + NumberOfVoxels);
+    fMap.DisplacementY.assign(Y, Y + NumberOfVoxels);
+    fMap.DisplacementZ.assign(Z, Z + NumberOfVoxels);
+
+    // Voxels without measured displacement have a negative error
+    const float *Error = MapFile.Data(LaserMapFile::kErrorX);
+    for (size_t voxel_no = 0; voxel_no < NumberOfVoxels; voxel_no++) fMap.Valid[voxel_no] = (Error[voxel_no] >= 0.f);
+    fConverged = false;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+float lasercal::LaserDistortionSolver::Iterate(const std::vector<LaserTrack> &Tracks) {
+    const size_t NumberOfVoxels = fGrid.NumberOfVoxels();
+    const LaserMapInterpolator Field(fMap);
+
+    unsigned int NumberOfThreads = (unsigned int) std::max<size_t>(std::min<size_t>(fNumberOfThreads, Tracks.size()), 1);
+    if (fWorkers.size() < NumberOfThreads) fWorkers.resize(NumberOfThreads);
+    for (unsigned int thread_no = 0; thread_no < NumberOfThreads; thread_no++) {
+        fWorkers[thread_no].Residuals.assign(NumberOfVoxels, VoxelDisplacement());
+    }
+
+    // Residuals of a block of tracks under the current field, only the thread's own grid is written
+    size_t TracksPerThread = (Tracks.size() + NumberOfThreads - 1) / NumberOfThreads;
+    auto Work = [this, &Tracks, &Field, TracksPerThread](unsigned int thread_no) {
+        Worker &Own = fWorkers[thread_no];
+        size_t First = thread_no * TracksPerThread;
+        size_t Last = std::min(First + TracksPerThread, Tracks.size());
+
+        for (size_t track_no = First; track_no < Last; track_no++) {
+            const LaserTrack &Track = Tracks[track_no];
+            const LaserSampleView Samples = Track.GetSamples();
+            const size_t NumberOfSamples = Samples.Size;
+
+            Own.CorrectedX.assign(Samples.X, Samples.X + NumberOfSamples);
+            Own.CorrectedY.assign(Samples.Y, Samples.Y + NumberOfSamples);
+            Own.CorrectedZ.assign(Samples.Z, Samples.Z + NumberOfSamples);
+            Field.Correct(Own.CorrectedX.data(), Own.CorrectedY.data(), Own.CorrectedZ.data(), NumberOfSamples);
+
+            const TVector3 Position = Track.GetLaserPosition();
+            const TVector3 Direction = Track.GetLaserDirection().Unit();
+            for (size_t sample_no = 0; sample_no < NumberOfSamples; sample_no++) {
+                long Voxel = fGrid.VoxelIndex(Samples.X[sample_no], Samples.Y[sample_no], Samples.Z[sample_no]);
+                if (Voxel < 0) continue;
+
+                // Remaining displacement from the corrected sample to the beam line
+                double Relative[3] = {Own.CorrectedX[sample_no] - Position.X(), Own.CorrectedY[sample_no] - Position.Y(),
+                                      Own.CorrectedZ[sample_no] - Position.Z()};
+                double Projection = Relative[0] * Direction.X() + Relative[1] * Direction.Y()
+                                    + Relative[2] * Direction.Z();
+                Own.Residuals[Voxel].Add(Projection * Direction.X() - Relative[0],
+                                         Projection * Direction.Y() - Relative[1],
+                                         Projection * Direction.Z() - Relative[2]);
+            }
+        }
+    };
+
+    std::vector<std::thread> Threads;
+    for (unsigned int thread_no = 1; thread_no < NumberOfThreads; thread_no++) {
+        Threads.emplace_back(Work, thread_no);
+    }
+    Work(0);
+    for (auto &Thread : Threads) Thread.join();
+
+    // Reduce into the first grid and move the field
+    std::vector<VoxelDisplacement> &Residuals = fWorkers.front().Residuals;
+    for (unsigned int thread_no = 1; thread_no < NumberOfThreads; thread_no++) {
+        for (size_t voxel_no = 0; voxel_no < NumberOfVoxels; voxel_no++) {
+            Residuals[voxel_no].Merge(fWorkers[thread_no].Residuals[voxel_no]);
+        }
+    }
+
+    float MaxChange = 0.;
+    std::vector<float> *Displacements[3] = {&fMap.DisplacementX, &fMap.DisplacementY, &fMap.DisplacementZ};
+    std::vector<float> *RMS[3] = {&fMap.RMSX, &fMap.RMSY, &fMap.RMSZ};
+    for (size_t voxel_no = 0; voxel_no < NumberOfVoxels; voxel_no++) {
+        const VoxelDisplacement &Voxel = Residuals[voxel_no];
+        fMap.Entries[voxel_no] = (uint32_t) std::min<uint64_t>(Voxel.Entries, UINT32_MAX);
+        for (unsigned int axis = 0; axis < 3; axis++) (*RMS[axis])[voxel_no] = Voxel.RMS(axis);
+
+        if (Voxel.Entries == 0 || Voxel.Entries < fMinEntries) continue;
+        fMap.Valid[voxel_no] = 1;
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            float Change = fRelaxation * Voxel.Mean(axis);
+            (*Displacements[axis])[voxel_no] += Change;
+            MaxChange = std::max(MaxChange, std::fabs(Change));
+        }
+    }
+
+    fIteration++;
+    fLastChange = MaxChange;
+    fConverged = (MaxChange < fTolerance);
+
+    if (!fCheckpointFile.empty()) LaserMapFile::Write(fCheckpointFile, fMap);
+
+    mf::LogInfo("LaserDistortionSolver") << "Iteration " << fIteration << ": largest change " << MaxChange
+                                         << " cm" << (fConverged ? " (converged)" : "");
+    return MaxChange;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+unsigned int lasercal::LaserDistortionSolver::Solve(const std::vector<LaserTrack> &Tracks) {
+    fConverged = false;
+    unsigned int Iterations = 0;
+    while (Iterations < fMaxIterations && !fConverged) {
+        Iterate(Tracks);
+        Iterations++;
+    }
+
+    if (!fConverged) {
+        mf::LogWarning("LaserDistortionSolver") << "No convergence after " << Iterations << " iterations, "
+                                                << "largest change " << fLastChange << " cm";
+    }
+    return Iterations;
+}
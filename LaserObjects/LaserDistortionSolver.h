@@ -0,0 +1,97 @@
+/**
+ * @file   LaserDistortionSolver.h
+ * @brief  Iterative solver for a displacement field measured by many crossing laser tracks
+ */
+
+#ifndef lasercal_LaserDistortionSolver_H
+#define lasercal_LaserDistortionSolver_H
+
+#include "LaserObjects/LaserDistortionMap.h"
+#include "LaserObjects/LaserMapFile.h"
+#include "LaserObjects/LaserTrack.h"
+
+#include <vector>
+#include <string>
+
+namespace lasercal
+{
+    /**
+     * @brief Finds the displacement field which moves all reconstructed samples onto their true beam lines
+     *
+     * A single track only measures the displacement perpendicular to its beam. Every iteration corrects the samples
+     * of all tracks with the current field (trilinear interpolation), assigns the remaining residuals (corrected
+     * sample to the closest point of the beam line) to the voxels of the reconstructed samples and moves the field
+     * by the mean residual of every voxel. Crossing tracks from both laser systems fix the remaining components.
+     *
+     * The tracks are spread over the worker threads in every iteration, each thread fills its own residual grid.
+     * The field is written to the checkpoint file (LaserMapFile) after every iteration, so a stopped solve can be
+     * continued with SetStartMap.
+     */
+    class LaserDistortionSolver {
+    public:
+        LaserDistortionSolver(const LaserVoxelGrid &Grid, unsigned int NumberOfThreads = 1);
+
+        /// Stop when no voxel moves by more than this (cm)
+        void SetTolerance(float Tolerance) { fTolerance = Tolerance; }
+
+        void SetMaxIterations(unsigned int MaxIterations) { fMaxIterations = MaxIterations; }
+
+        /// Fraction of the mean residual added to the field per iteration (1 = full step)
+        void SetRelaxation(float Relaxation) { fRelaxation = Relaxation; }
+
+        /// Voxels with fewer residuals are not updated
+        void SetMinEntries(unsigned int MinEntries) { fMinEntries = MinEntries; }
+
+        /// Map file written after every iteration (no checkpoints if empty)
+        void SetCheckpointFile(const std::string &FileName) { fCheckpointFile = FileName; }
+
+        /// Starts from this field instead of zero (e.g. a checkpoint), the grids have to match
+        void SetStartMap(const LaserDisplacementMap &Map);
+
+        void SetStartMap(const LaserMapFile &MapFile);
+
+        /**
+         * @brief Iterates until the tolerance or the maximal number of iterations is reached
+         * @return number of iterations done
+         */
+        unsigned int Solve(const std::vector<LaserTrack> &Tracks);
+
+        /**
+         * @brief Does a single iteration
+         * @return largest change of the field in this iteration
+         */
+        float Iterate(const std::vector<LaserTrack> &Tracks);
+
+        /// Current field, RMS and entries are the ones of the residuals of the last iteration
+        const LaserDisplacementMap &GetMap() const { return fMap; }
+
+        bool HasConverged() const { return fConverged; }
+
+        float GetLastChange() const { return fLastChange; }
+
+    private:
+        struct Worker {
+            std::vector<VoxelDisplacement> Residuals;
+            std::vector<float> CorrectedX, CorrectedY, CorrectedZ;
+        };
+
+        void CheckGrid(const LaserVoxelGrid &Grid) const;
+
+        LaserVoxelGrid fGrid;
+        unsigned int fNumberOfThreads;
+        float fTolerance = 0.01;
+        unsigned int fMaxIterations = 50;
+        float fRelaxation = 1.;
+        unsigned int fMinEntries = 1;
+        std::string fCheckpointFile;
+
+        LaserDisplacementMap fMap;
+        std::vector<Worker> fWorkers;
+        unsigned int fIteration = 0;
+        float fLastChange = 0.;
+        bool fConverged = false;
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserDistortionSolver_H
@@ -65,13 +65,27 @@ lasercal::LaserHits::LaserHits(const std::vector<recob::Wire> &Wires, const lase
 
 //-------------------------------------------------------------------------------------------------------------------
 
-void lasercal::LaserHits::AddHitsFromWire(const recob::Wire &Wire) {
+std::map<float, recob::Hit> lasercal::LaserHits::AddHitsFromWire(const recob::Wire &Wire) {
+    std::map<float, recob::Hit> HitMap = FindHitsFromWire(Wire);
+    AddHitMap(Wire.Channel(), HitMap);
+
+    return HitMap;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+std::map<float, recob::Hit> lasercal::LaserHits::FindHitsFromWire(const recob::Wire &Wire) {
     // Get channel information
-    raw::ChannelID_t Channel = Wire.Channel();
-    unsigned Plane = fGeometry->ChannelToWire(Channel).front().Plane;
+    unsigned Plane = fGeometry->ChannelToWire(Wire.Channel()).front().Plane;
 
     // Get Single wire hits
-    std::map<float, recob::Hit> HitMap = FindSingleWireHits(Wire, Plane);
+    return FindSingleWireHits(Wire, Plane);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserHits::AddHitMap(raw::ChannelID_t Channel, const std::map<float, recob::Hit> &HitMap) {
+    unsigned Plane = fGeometry->ChannelToWire(Channel).front().Plane;
 
     // Fill map data by pushing back the wire vector
     fHitMapsByPlane.at(Plane).push_back(HitMap);
@@ -210,64 +224,69 @@ std::map<float, recob::Hit> lasercal::LaserHits::UPlaneHitFinder(const recob::Wi
     int PeakTime = -9999;
     int HitIdx = 0;
 
-    // Extract Channel ID and raw signal from Wire object
+    // Extract Channel ID from Wire object
     raw::ChannelID_t Channel = SingleWire.Channel();
-    std::vector<float> Signal = SingleWire.Signal();
-
-
-    // Set below threshold flag to false
-    bool BelowThreshold = false;
 
-
-    // loop over wire
-    for (unsigned int sample = 0; sample < Signal.size(); sample++) {
-        if (Signal.at(sample) <= fParameters.UHitThreshold) {
-            // If we go over the threshold the first time, save the time tick
-            if (!BelowThreshold) {
-                HitStart = sample;
-                BelowThreshold = true;
-                Peak = Signal.at(sample);
-                PeakTime = sample;
-            }
-            if (Signal.at(sample) < Peak) {
-                Peak = Signal.at(sample);
-                PeakTime = sample;
-            }
-        } else if (BelowThreshold && (Signal.at(sample) > fParameters.UHitThreshold || Signal.size() - 1 == sample)) {
-            HitEnd = sample;
-            BelowThreshold = false;
-
-            if ((fabs(Peak) / (float) (HitEnd - HitStart) > fParameters.UAmplitudeToWidthRatio ||
-                 fabs(Peak) > fParameters.HighAmplitudeThreshold)
-                && HitEnd - HitStart > fParameters.UHitWidthThreshold) {
-                // Create hit
-                auto RecoHit = recob::HitCreator(SingleWire,
-                                                 fGeometry->ChannelToWire(Channel).front(),
-                                                 HitStart,
-                                                 HitEnd,
-                                                 fabs(HitStart - HitEnd) / 2,
-                                                 (float) PeakTime,
-                                                 fabs(HitStart - HitEnd) / 2,
-                                                 Peak,
-                                                 sqrt(Peak),
-                                                 0.,
-                                                 0.,
-                                                 1,
-                                                 HitIdx,
-                                                 1.,
-                                                 0).move();
-
-                if (fParameters.UseROI) {
-                    if (fLaserROI.IsHitInRange(RecoHit)) {
+    // Loop over all regions of interest of the wire (a single one if the whole wire was decoded)
+    for (const auto &Range : SingleWire.SignalROI().get_ranges()) {
+        // Raw signal of this region and its first time tick
+        const std::vector<float> &Signal = Range.data();
+        const int Offset = Range.begin_index();
+
+        // Set below threshold flag to false
+        bool BelowThreshold = false;
+
+
+        // loop over wire
+        for (unsigned int sample = 0; sample < Signal.size(); sample++) {
+            if (Signal.at(sample) <= fParameters.UHitThreshold) {
+                // If we go over the threshold the first time, save the time tick
+                if (!BelowThreshold) {
+                    HitStart = Offset + sample;
+                    BelowThreshold = true;
+                    Peak = Signal.at(sample);
+                    PeakTime = Offset + sample;
+                }
+                if (Signal.at(sample) < Peak) {
+                    Peak = Signal.at(sample);
+                    PeakTime = Offset + sample;
+                }
+            } else if (BelowThreshold && (Signal.at(sample) > fParameters.UHitThreshold || Signal.size() - 1 == sample)) {
+                HitEnd = Offset + sample;
+                BelowThreshold = false;
+
+                if ((fabs(Peak) / (float) (HitEnd - HitStart) > fParameters.UAmplitudeToWidthRatio ||
+                     fabs(Peak) > fParameters.HighAmplitudeThreshold)
+                    && HitEnd - HitStart > fParameters.UHitWidthThreshold) {
+                    // Create hit
+                    auto RecoHit = recob::HitCreator(SingleWire,
+                                                     fGeometry->ChannelToWire(Channel).front(),
+                                                     HitStart,
+                                                     HitEnd,
+                                                     fabs(HitStart - HitEnd) / 2,
+                                                     (float) PeakTime,
+                                                     fabs(HitStart - HitEnd) / 2,
+                                                     Peak,
+                                                     sqrt(Peak),
+                                                     0.,
+                                                     0.,
+                                                     1,
+                                                     HitIdx,
+                                                     1.,
+                                                     0).move();
+
+                    if (fParameters.UseROI) {
+                        if (fLaserROI.IsHitInRange(RecoHit)) {
+                            LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
+                        }
+                    } else {
                         LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
                     }
-                } else {
-                    LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
+                    HitIdx++;
                 }
-                HitIdx++;
             }
         }
-    }
+    }// loop over regions of interest
     return LaserHits;
 }
 
@@ -293,87 +312,92 @@ std::map<float, recob::Hit> lasercal::LaserHits::VPlaneHitFinder(const recob::Wi
     float HitTime = -9999;
     int HitIdx = 0;
 
-    // Set all flags to false
-    bool AboveThreshold = false;
-    bool BelowThreshold = false;
-    bool Handover_flag = false;
-
-    // Extract Channel ID and raw signal from Wire object
+    // Extract Channel ID from Wire object
     raw::ChannelID_t Channel = SingleWire.Channel();
-    std::vector<float> Signal = SingleWire.Signal();
-
 
-    // loop over wire
-    for (unsigned int sample = 0; sample < Signal.size(); sample++) {
-        if (!BelowThreshold && Signal.at(sample) >= fParameters.VHitThreshold) {
-            // If we go over the threshold the first time, save the time tick
-            if (!AboveThreshold) {
-                AboveThreshold = true;
-                Handover_flag = false;
-                HitStart = sample;
-                Peak = Signal.at(sample);
-                PeakTime = sample;
-            }
-            if (Signal.at(sample) > Peak) {
-                Peak = Signal.at(sample);
-                PeakTime = sample;
-            }
-        } else if (AboveThreshold && Signal.at(sample) < fParameters.VHitThreshold) {
-            AboveThreshold = false;
-            Handover_flag = true;
-        }
-        if (Handover_flag && !AboveThreshold && Signal.at(sample) <= -fParameters.VHitThreshold) {
-            if (!BelowThreshold) {
-                BelowThreshold = true;
-                Dip = Signal.at(sample);
-                DipTime = sample;
-            }
-            if (Signal.at(sample) < Dip) {
-                Dip = Signal.at(sample);
-                DipTime = sample;
+    // Loop over all regions of interest of the wire (a single one if the whole wire was decoded)
+    for (const auto &Range : SingleWire.SignalROI().get_ranges()) {
+        // Raw signal of this region and its first time tick
+        const std::vector<float> &Signal = Range.data();
+        const int Offset = Range.begin_index();
+
+        // Set all flags to false
+        bool AboveThreshold = false;
+        bool BelowThreshold = false;
+        bool Handover_flag = false;
+
+        // loop over wire
+        for (unsigned int sample = 0; sample < Signal.size(); sample++) {
+            if (!BelowThreshold && Signal.at(sample) >= fParameters.VHitThreshold) {
+                // If we go over the threshold the first time, save the time tick
+                if (!AboveThreshold) {
+                    AboveThreshold = true;
+                    Handover_flag = false;
+                    HitStart = Offset + sample;
+                    Peak = Signal.at(sample);
+                    PeakTime = Offset + sample;
+                }
+                if (Signal.at(sample) > Peak) {
+                    Peak = Signal.at(sample);
+                    PeakTime = Offset + sample;
+                }
+            } else if (AboveThreshold && Signal.at(sample) < fParameters.VHitThreshold) {
+                AboveThreshold = false;
+                Handover_flag = true;
             }
-        } else if (Handover_flag && BelowThreshold &&
-                   (Signal.at(sample) > -fParameters.VHitThreshold || Signal.size() - 1 == sample)) {
-            HitEnd = sample;
-            HitTime = (float) PeakTime + ((float) DipTime - (float) PeakTime) / 2;
-            BelowThreshold = false;
-            Handover_flag = false;
-
-            if (((Peak - Dip) / (float) (HitEnd - HitStart) > fParameters.VAmplitudeToWidthRatio ||
-                 Peak - Dip > fParameters.HighAmplitudeThreshold)
-                && HitEnd - HitStart > fParameters.VHitWidthThreshold
-                && (Peak / (float) (DipTime - PeakTime) > fParameters.VAmplitudeToRMSRatio ||
-                    Peak - Dip > fParameters.HighAmplitudeThreshold)
-                && DipTime - PeakTime > fParameters.VRMSThreshold) {
-                // Create hit
-                auto RecoHit = recob::HitCreator(SingleWire,
-                                                 fGeometry->ChannelToWire(Channel).front(),
-                                                 HitStart,
-                                                 HitEnd,
-                                                 fabs(DipTime - PeakTime) / 2,
-                                                 HitTime,
-                                                 fabs(DipTime - PeakTime) / 2,
-                                                 Peak - Dip,
-                                                 sqrt(Peak - Dip),
-                                                 0.,
-                                                 0.,
-                                                 1,
-                                                 HitIdx,
-                                                 1.,
-                                                 0).move();
-
-                if (fParameters.UseROI) {
-                    if (fLaserROI.IsHitInRange(RecoHit)) {
+            if (Handover_flag && !AboveThreshold && Signal.at(sample) <= -fParameters.VHitThreshold) {
+                if (!BelowThreshold) {
+                    BelowThreshold = true;
+                    Dip = Signal.at(sample);
+                    DipTime = Offset + sample;
+                }
+                if (Signal.at(sample) < Dip) {
+                    Dip = Signal.at(sample);
+                    DipTime = Offset + sample;
+                }
+            } else if (Handover_flag && BelowThreshold &&
+                       (Signal.at(sample) > -fParameters.VHitThreshold || Signal.size() - 1 == sample)) {
+                HitEnd = Offset + sample;
+                HitTime = (float) PeakTime + ((float) DipTime - (float) PeakTime) / 2;
+                BelowThreshold = false;
+                Handover_flag = false;
+
+                if (((Peak - Dip) / (float) (HitEnd - HitStart) > fParameters.VAmplitudeToWidthRatio ||
+                     Peak - Dip > fParameters.HighAmplitudeThreshold)
+                    && HitEnd - HitStart > fParameters.VHitWidthThreshold
+                    && (Peak / (float) (DipTime - PeakTime) > fParameters.VAmplitudeToRMSRatio ||
+                        Peak - Dip > fParameters.HighAmplitudeThreshold)
+                    && DipTime - PeakTime > fParameters.VRMSThreshold) {
+                    // Create hit
+                    auto RecoHit = recob::HitCreator(SingleWire,
+                                                     fGeometry->ChannelToWire(Channel).front(),
+                                                     HitStart,
+                                                     HitEnd,
+                                                     fabs(DipTime - PeakTime) / 2,
+                                                     HitTime,
+                                                     fabs(DipTime - PeakTime) / 2,
+                                                     Peak - Dip,
+                                                     sqrt(Peak - Dip),
+                                                     0.,
+                                                     0.,
+                                                     1,
+                                                     HitIdx,
+                                                     1.,
+                                                     0).move();
+
+                    if (fParameters.UseROI) {
+                        if (fLaserROI.IsHitInRange(RecoHit)) {
+                            LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
+                        }
+                    } else {
                         LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
                     }
-                } else {
-                    LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
-                }
 
-                HitIdx++;
+                    HitIdx++;
+                }
             }
         }
-    }
+    }// loop over regions of interest
     return LaserHits;
 }
 
@@ -398,64 +422,69 @@ std::map<float, recob::Hit> lasercal::LaserHits::YPlaneHitFinder(const recob::Wi
     int PeakTime = -9999;
     int HitIdx = 0;
 
-    // Extract Channel ID and raw signal from Wire object
+    // Extract Channel ID from Wire object
     raw::ChannelID_t Channel = SingleWire.Channel();
-    std::vector<float> Signal = SingleWire.Signal();
-
-
-    // Set Above Threshold flag to false
-    bool AboveThreshold = false;
-
-    // loop over wire
-    for (unsigned int sample = 0; sample < Signal.size(); sample++) {
-        if (Signal.at(sample) >= fParameters.YHitThreshold) {
-            //std::cout << "----------- HERE ------------ c:" << sample << " " << Signal.at(sample) << std::endl;
-            // If we go over the threshold the first time, save the time tick
-            if (!AboveThreshold) {
-                HitStart = sample;
-                AboveThreshold = true;
-                Peak = Signal.at(sample);
-                PeakTime = sample;
-            }
-            if (Signal.at(sample) > Peak) {
-                Peak = Signal.at(sample);
-                PeakTime = sample;
-            }
-        } else if (AboveThreshold && (Signal.at(sample) < fParameters.YHitThreshold || Signal.size() - 1 == sample)) {
-            HitEnd = sample;
-            AboveThreshold = false;
-            if ((Peak / (float) (HitEnd - HitStart) > fParameters.YAmplitudeToWidthRatio ||
-                 Peak > fParameters.HighAmplitudeThreshold)
-                && HitEnd - HitStart > fParameters.YHitWidthThreshold) {
-                // Create hit
-                auto RecoHit = recob::HitCreator(SingleWire,
-                                                 fGeometry->ChannelToWire(Channel).front(),
-                                                 HitStart,
-                                                 HitEnd,
-                                                 fabs(HitStart - HitEnd) / 2,
-                                                 (float) PeakTime,
-                                                 fabs(HitStart - HitEnd) / 2,
-                                                 Peak,
-                                                 sqrt(Peak),
-                                                 0.,
-                                                 0.,
-                                                 1,
-                                                 HitIdx,
-                                                 1.,
-                                                 0).move();
-
-                if (fParameters.UseROI) {
-                    if (fLaserROI.IsHitInRange(RecoHit)) {
+
+    // Loop over all regions of interest of the wire (a single one if the whole wire was decoded)
+    for (const auto &Range : SingleWire.SignalROI().get_ranges()) {
+        // Raw signal of this region and its first time tick
+        const std::vector<float> &Signal = Range.data();
+        const int Offset = Range.begin_index();
+
+        // Set Above Threshold flag to false
+        bool AboveThreshold = false;
+
+        // loop over wire
+        for (unsigned int sample = 0; sample < Signal.size(); sample++) {
+            if (Signal.at(sample) >= fParameters.YHitThreshold) {
+                //std::cout << "----------- HERE ------------ c:" << sample << " " << Signal.at(sample) << std::endl;
+                // If we go over the threshold the first time, save the time tick
+                if (!AboveThreshold) {
+                    HitStart = Offset + sample;
+                    AboveThreshold = true;
+                    Peak = Signal.at(sample);
+                    PeakTime = Offset + sample;
+                }
+                if (Signal.at(sample) > Peak) {
+                    Peak = Signal.at(sample);
+                    PeakTime = Offset + sample;
+                }
+            } else if (AboveThreshold && (Signal.at(sample) < fParameters.YHitThreshold || Signal.size() - 1 == sample)) {
+                HitEnd = Offset + sample;
+                AboveThreshold = false;
+                if ((Peak / (float) (HitEnd - HitStart) > fParameters.YAmplitudeToWidthRatio ||
+                     Peak > fParameters.HighAmplitudeThreshold)
+                    && HitEnd - HitStart > fParameters.YHitWidthThreshold) {
+                    // Create hit
+                    auto RecoHit = recob::HitCreator(SingleWire,
+                                                     fGeometry->ChannelToWire(Channel).front(),
+                                                     HitStart,
+                                                     HitEnd,
+                                                     fabs(HitStart - HitEnd) / 2,
+                                                     (float) PeakTime,
+                                                     fabs(HitStart - HitEnd) / 2,
+                                                     Peak,
+                                                     sqrt(Peak),
+                                                     0.,
+                                                     0.,
+                                                     1,
+                                                     HitIdx,
+                                                     1.,
+                                                     0).move();
+
+                    if (fParameters.UseROI) {
+                        if (fLaserROI.IsHitInRange(RecoHit)) {
+                            LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
+                        }
+                    } else {
                         LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
                     }
-                } else {
-                    LaserHits.emplace(std::make_pair((float) PeakTime, RecoHit));
-                }
 
-                HitIdx++;
+                    HitIdx++;
+                }
             }
         }
-    }
+    }// loop over regions of interest
     return LaserHits;
 }
 
@@ -38,7 +38,14 @@ namespace lasercal
       /// Alternative constructor where the user can supply a predefined ROI.
       LaserHits(const std::vector<recob::Wire>& Wires, const lasercal::LaserRecoParameters& ParameterSet, lasercal::LaserROI& LaserROI);
 
-      void AddHitsFromWire(const recob::Wire& Wire);
+      // Runs the hit finder on a single wire, stores its hits and returns them (key: peak time)
+      std::map<float, recob::Hit> AddHitsFromWire(const recob::Wire& Wire);
+
+      // Runs the hit finder on a single wire and only returns its hits (key: peak time)
+      std::map<float, recob::Hit> FindHitsFromWire(const recob::Wire& Wire);
+
+      // Stores the hits of a single wire, e.g. the ones of FindHitsFromWire
+      void AddHitMap(raw::ChannelID_t Channel, const std::map<float, recob::Hit>& HitMap);
       
       const std::array<size_t,3> NumberOfWiresWithHits();
       
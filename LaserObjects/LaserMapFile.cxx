@@ -0,0 +1,214 @@
+#include "LaserObjects/LaserMapFile.h"
+
+#include "art/Utilities/Exception.h"
+#include "cetlib/exception.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char kMapMagic[8] = {'L', 'A', 'S', 'E', 'R', 'M', 'A', 'P'};
+    const uint32_t kMapVersion = 1;
+
+    struct MapHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t HeaderSize;
+        float Origin[3];
+        float Spacing[3];
+        uint32_t Size[3];
+        uint32_t NumberOfArrays;
+        uint64_t PayloadSize;
+        uint64_t Checksum;
+        uint8_t Reserved[24];
+    };
+
+    static_assert(sizeof(MapHeader) == lasercal::LaserMapFile::kHeaderSize, "Map header layout changed");
+
+    inline bool IsLittleEndian() {
+        const uint16_t Probe = 1;
+        return *reinterpret_cast<const uint8_t *>(&Probe) == 1;
+    }
+}
+
+constexpr size_t lasercal::LaserMapFile::kHeaderSize;
+
+//-------------------------------------------------------------------------------------------------------------------
+
+uint64_t lasercal::LaserMapFile::Checksum(const void *Data, size_t Size) {
+    const uint8_t *Bytes = static_cast<const uint8_t *>(Data);
+    uint64_t Hash = 14695981039346656037ULL;
+    for (size_t byte_no = 0; byte_no < Size; byte_no++) {
+        Hash ^= Bytes[byte_no];
+        Hash *= 1099511628211ULL;
+    }
+    return Hash;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserMapFile::Write(const std::string &FileName, const LaserDisplacementMap &Map) {
+    if (!IsLittleEndian()) {
+        throw art::Exception(art::errors::UnimplementedFeature)
+                << "LaserMapFile: only little endian hosts are supported\n";
+    }
+
+    const size_t NumberOfVoxels = Map.Grid.NumberOfVoxels();
+    if (Map.size() != NumberOfVoxels || Map.DisplacementX.size() != NumberOfVoxels
+        || Map.DisplacementY.size() != NumberOfVoxels || Map.DisplacementZ.size() != NumberOfVoxels
+        || Map.RMSX.size() != NumberOfVoxels || Map.RMSY.size() != NumberOfVoxels
+        || Map.RMSZ.size() != NumberOfVoxels || Map.Valid.size() != NumberOfVoxels) {
+        throw art::Exception(art::errors::LogicError) << "LaserMapFile: map does not match its grid\n";
+    }
+
+    // Payload in file order, the errors are the uncertainties of the means (unknown for a single entry)
+    std::vector<float> Payload(kNumberOfArrays * NumberOfVoxels);
+    const std::vector<float> *Displacements[3] = {&Map.DisplacementX, &Map.DisplacementY, &Map.DisplacementZ};
+    const std::vector<float> *RMS[3] = {&Map.RMSX, &Map.RMSY, &Map.RMSZ};
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        float *Displacement = &Payload[(kDisplacementX + axis) * NumberOfVoxels];
+        float *Error = &Payload[(kErrorX + axis) * NumberOfVoxels];
+        for (size_t voxel_no = 0; voxel_no < NumberOfVoxels; voxel_no++) {
+            Displacement[voxel_no] = (*Displacements[axis])[voxel_no];
+            if (!Map.Valid[voxel_no]) {
+                Error[voxel_no] = -1.f;
+            } else if (Map.Entries[voxel_no] < 2) {
+                Error[voxel_no] = std::numeric_limits<float>::infinity();
+            } else {
+                Error[voxel_no] = (*RMS[axis])[voxel_no] / std::sqrt(float(Map.Entries[voxel_no]));
+            }
+        }
+    }
+
+    MapHeader Header;
+    std::memset(&Header, 0, sizeof(Header));
+    std::memcpy(Header.Magic, kMapMagic, sizeof(kMapMagic));
+    Header.Version = kMapVersion;
+    Header.HeaderSize = kHeaderSize;
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        Header.Origin[axis] = Map.Grid.Origin[axis];
+        Header.Spacing[axis] = Map.Grid.Spacing[axis];
+        Header.Size[axis] = Map.Grid.Size[axis];
+    }
+    Header.NumberOfArrays = kNumberOfArrays;
+    Header.PayloadSize = Payload.size() * sizeof(float);
+    Header.Checksum = Checksum(Payload.data(), Header.PayloadSize);
+
+    // Write to a temporary file first, so that running jobs never map a half written file
+    std::string TempName = FileName + ".tmp" + std::to_string(getpid());
+    std::FILE *File = std::fopen(TempName.c_str(), "wb");
+    if (!File) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserMapFile: unable to create " << TempName << "\n";
+    }
+
+    bool Failed = (std::fwrite(&Header, sizeof(Header), 1, File) != 1);
+    Failed |= (std::fwrite(Payload.data(), 1, Header.PayloadSize, File) != Header.PayloadSize);
+    Failed |= (std::fclose(File) != 0);
+
+    if (Failed || std::rename(TempName.c_str(), FileName.c_str()) != 0) {
+        std::remove(TempName.c_str());
+        throw cet::exception("FileWriteError") << "LaserMapFile: unable to write " << FileName << "\n";
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+bool lasercal::LaserMapFile::IsMapFile(const std::string &FileName) {
+    char Magic[sizeof(kMapMagic)];
+    std::FILE *File = std::fopen(FileName.c_str(), "rb");
+    if (!File) return false;
+    bool Match = (std::fread(Magic, sizeof(Magic), 1, File) == 1)
+                 && std::memcmp(Magic, kMapMagic, sizeof(kMapMagic)) == 0;
+    std::fclose(File);
+    return Match;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserMapFile::LaserMapFile(const std::string &FileName, bool VerifyChecksum) : fFileName(FileName) {
+    if (!IsLittleEndian()) {
+        throw art::Exception(art::errors::UnimplementedFeature)
+                << "LaserMapFile: only little endian hosts are supported\n";
+    }
+
+    int FileDescriptor = open(fFileName.c_str(), O_RDONLY);
+    if (FileDescriptor < 0) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserMapFile: unable to open " << fFileName << "\n";
+    }
+
+    struct stat Status;
+    if (fstat(FileDescriptor, &Status) != 0 || size_t(Status.st_size) < kHeaderSize) {
+        close(FileDescriptor);
+        throw art::Exception(art::errors::FileReadError) << "LaserMapFile: " << fFileName << " is too short\n";
+    }
+    fMappingSize = Status.st_size;
+
+    // Shared read-only mapping: all jobs on the node use the same pages of the page cache
+    fMapping = mmap(nullptr, fMappingSize, PROT_READ, MAP_SHARED, FileDescriptor, 0);
+    close(FileDescriptor);
+    if (fMapping == MAP_FAILED) {
+        fMapping = nullptr;
+        throw art::Exception(art::errors::FileReadError) << "LaserMapFile: unable to map " << fFileName << "\n";
+    }
+
+    MapHeader Header;
+    std::memcpy(&Header, fMapping, sizeof(Header));
+
+    uint64_t NumberOfVoxels = uint64_t(Header.Size[0]) * Header.Size[1] * Header.Size[2];
+    bool Valid = std::memcmp(Header.Magic, kMapMagic, sizeof(kMapMagic)) == 0
+                 && Header.Version == kMapVersion
+                 && Header.HeaderSize == kHeaderSize
+                 && Header.NumberOfArrays == kNumberOfArrays
+                 && NumberOfVoxels > 0
+                 && Header.PayloadSize == kNumberOfArrays * NumberOfVoxels * sizeof(float)
+                 && Header.PayloadSize == fMappingSize - kHeaderSize;
+
+    // The interpolation divides by the spacing, a corrupt grid would give infinite or NaN positions
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        Valid = Valid && std::isfinite(Header.Origin[axis]) && std::isfinite(Header.Spacing[axis])
+                && Header.Spacing[axis] > 0;
+    }
+    if (!Valid) {
+        munmap(fMapping, fMappingSize);
+        fMapping = nullptr;
+        throw art::Exception(art::errors::FileReadError) << "LaserMapFile: " << fFileName
+                                                         << " is not a displacement map (version "
+                                                         << kMapVersion << "), is truncated or has an "
+                                                         << "invalid grid\n";
+    }
+
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        fGrid.Origin[axis] = Header.Origin[axis];
+        fGrid.Spacing[axis] = Header.Spacing[axis];
+        fGrid.Size[axis] = Header.Size[axis];
+    }
+    fChecksum = Header.Checksum;
+    fData = reinterpret_cast<const float *>(static_cast<const char *>(fMapping) + kHeaderSize);
+
+    if (VerifyChecksum && !this->VerifyChecksum()) {
+        munmap(fMapping, fMappingSize);
+        fMapping = nullptr;
+        throw art::Exception(art::errors::FileReadError) << "LaserMapFile: checksum mismatch in " << fFileName
+                                                         << "\n";
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserMapFile::~LaserMapFile() {
+    if (fMapping) munmap(fMapping, fMappingSize);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+bool lasercal::LaserMapFile::VerifyChecksum() const {
+    return Checksum(fData, fMappingSize - kHeaderSize) == fChecksum;
+}
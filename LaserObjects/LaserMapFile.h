@@ -0,0 +1,96 @@
+/**
+ * @file   LaserMapFile.h
+ * @brief  Versioned binary file of a displacement map, read through a read-only memory mapping
+ */
+
+#ifndef lasercal_LaserMapFile_H
+#define lasercal_LaserMapFile_H
+
+#include "LaserObjects/LaserDistortionMap.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace lasercal
+{
+    /**
+     * @brief Displacement map file shared by many jobs through the page cache
+     *
+     * File layout: a 96 byte header followed by six float arrays (x runs fastest, see LaserVoxelGrid::Index).
+     *   char     Magic[8]          "LASERMAP"
+     *   uint32   Version           1
+     *   uint32   HeaderSize        96 (offset of the first array)
+     *   float    Origin[3]         lower corner of the grid
+     *   float    Spacing[3]        voxel size
+     *   uint32   Size[3]           number of voxels per axis
+     *   uint32   NumberOfArrays    6
+     *   uint64   PayloadSize       size of all arrays in bytes
+     *   uint64   Checksum          64 bit FNV-1a of the payload
+     *   uint8    Reserved[24]      0
+     * followed by DisplacementX, DisplacementY, DisplacementZ, ErrorX, ErrorY, ErrorZ. The errors are the
+     * uncertainties of the mean displacements, -1 for voxels without entries.
+     * In python: numpy.memmap(FileName, dtype="<f4", mode="r", offset=96, shape=(6, Size[2], Size[1], Size[0]))
+     *
+     * Opening only checks the header and maps the file, the arrays are used in place. The checksum is only
+     * verified on request, since it has to read the whole payload.
+     */
+    class LaserMapFile {
+    public:
+        static constexpr size_t kHeaderSize = 96;
+
+        enum MapArray {
+            kDisplacementX = 0, kDisplacementY, kDisplacementZ, kErrorX, kErrorY, kErrorZ, kNumberOfArrays
+        };
+
+        /**
+         * @brief Maps the file read-only
+         * @param FileName map file
+         * @param VerifyChecksum compare the checksum of the payload with the header
+         * @throws art::Exception (FileOpenError, FileReadError) if the file cannot be mapped or is inconsistent
+         */
+        explicit LaserMapFile(const std::string &FileName, bool VerifyChecksum = false);
+
+        LaserMapFile(const LaserMapFile &) = delete;
+
+        LaserMapFile &operator=(const LaserMapFile &) = delete;
+
+        ~LaserMapFile();
+
+        /**
+         * @brief Writes the map (through a temporary file, so readers never see a half written map)
+         * @throws art::Exception (FileOpenError) if the file cannot be created
+         * @throws cet::exception (FileWriteError) if the file cannot be written
+         */
+        static void Write(const std::string &FileName, const LaserDisplacementMap &Map);
+
+        /// True if the file starts with the map magic (used to tell map files from ROOT files)
+        static bool IsMapFile(const std::string &FileName);
+
+        /// Checksum of a payload as stored in the header
+        static uint64_t Checksum(const void *Data, size_t Size);
+
+        const LaserVoxelGrid &GetGrid() const { return fGrid; }
+
+        /// Mapped array, NumberOfVoxels values
+        const float *Data(MapArray Array) const { return fData + Array * fGrid.NumberOfVoxels(); }
+
+        uint64_t GetChecksum() const { return fChecksum; }
+
+        /// Recomputes the checksum of the mapped payload
+        bool VerifyChecksum() const;
+
+        const std::string &GetFileName() const { return fFileName; }
+
+    private:
+        std::string fFileName;
+        void *fMapping = nullptr;
+        size_t fMappingSize = 0;
+        const float *fData = nullptr;
+        LaserVoxelGrid fGrid;
+        uint64_t fChecksum = 0;
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserMapFile_H
@@ -0,0 +1,188 @@
+#include "LaserObjects/LaserMapInterpolator.h"
+
+#include "art/Utilities/Exception.h"
+
+#include <algorithm>
+
+constexpr size_t lasercal::LaserMapInterpolator::kBatchSize;
+
+namespace {
+
+    // Trilinear blend of the eight nodes of the cell starting at Corner
+    inline float Trilinear(const float *Values, size_t Corner, const size_t Step[3],
+                           float FractionX, float FractionY, float FractionZ) {
+        const float *Low = Values + Corner;
+        const float *High = Low + Step[2];
+
+        float Low00 = Low[0] + FractionX * (Low[Step[0]] - Low[0]);
+        float Low10 = Low[Step[1]] + FractionX * (Low[Step[1] + Step[0]] - Low[Step[1]]);
+        float High00 = High[0] + FractionX * (High[Step[0]] - High[0]);
+        float High10 = High[Step[1]] + FractionX * (High[Step[1] + Step[0]] - High[Step[1]]);
+
+        float LowPlane = Low00 + FractionY * (Low10 - Low00);
+        float HighPlane = High00 + FractionY * (High10 - High00);
+        return LowPlane + FractionZ * (HighPlane - LowPlane);
+    }
+
+    // Trilinear blend of the measured nodes only, their weights are renormalized
+    inline float MaskedTrilinear(const float *Values, const float *Mask, size_t Corner, const size_t Step[3],
+                                 float FractionX, float FractionY, float FractionZ) {
+        const size_t Offset[8] = {0, Step[0], Step[1], Step[1] + Step[0],
+                                  Step[2], Step[2] + Step[0], Step[2] + Step[1], Step[2] + Step[1] + Step[0]};
+        const float WeightX[2] = {1.f - FractionX, FractionX};
+        const float WeightY[2] = {1.f - FractionY, FractionY};
+        const float WeightZ[2] = {1.f - FractionZ, FractionZ};
+
+        float Sum = 0.f, Norm = 0.f, NodeSum = 0.f, Nodes = 0.f;
+        for (unsigned int node_no = 0; node_no < 8; node_no++) {
+            const size_t Node = Corner + Offset[node_no];
+            const float Weight = WeightX[node_no & 1] * WeightY[(node_no >> 1) & 1] * WeightZ[node_no >> 2]
+                                 * Mask[Node];
+            Sum += Weight * Values[Node];
+            Norm += Weight;
+            NodeSum += Mask[Node] * Values[Node];
+            Nodes += Mask[Node];
+        }
+        if (Norm > 0.f) return Sum / Norm;
+
+        // Point on an unmeasured node (or edge): mean of the measured nodes of the cell, zero if there is none
+        return (Nodes > 0.f) ? NodeSum / Nodes : 0.f;
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserMapInterpolator::LaserMapInterpolator(const LaserDisplacementMap &Map) : fGrid(Map.Grid) {
+    const size_t NumberOfVoxels = fGrid.NumberOfVoxels();
+    if (NumberOfVoxels == 0 || Map.DisplacementX.size() != NumberOfVoxels
+        || Map.DisplacementY.size() != NumberOfVoxels || Map.DisplacementZ.size() != NumberOfVoxels
+        || Map.Valid.size() != NumberOfVoxels) {
+        throw art::Exception(art::errors::Configuration) << "LaserMapInterpolator: displacement map does not match "
+                                                         << "its grid\n";
+    }
+
+    fStorage.reserve(3 * NumberOfVoxels);
+    fStorage.insert(fStorage.end(), Map.DisplacementX.begin(), Map.DisplacementX.end());
+    fStorage.insert(fStorage.end(), Map.DisplacementY.begin(), Map.DisplacementY.end());
+    fStorage.insert(fStorage.end(), Map.DisplacementZ.begin(), Map.DisplacementZ.end());
+    fDisplacementX = fStorage.data();
+    fDisplacementY = fDisplacementX + NumberOfVoxels;
+    fDisplacementZ = fDisplacementY + NumberOfVoxels;
+    fMask.assign(Map.Valid.begin(), Map.Valid.end());
+
+    Initialize();
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserMapInterpolator::LaserMapInterpolator(std::shared_ptr<const LaserMapFile> MapFile)
+        : fGrid(MapFile->GetGrid()), fMapFile(std::move(MapFile)) {
+    fDisplacementX = fMapFile->Data(LaserMapFile::kDisplacementX);
+    fDisplacementY = fMapFile->Data(LaserMapFile::kDisplacementY);
+    fDisplacementZ = fMapFile->Data(LaserMapFile::kDisplacementZ);
+
+    // Voxels without measured displacement have a negative error
+    const float *Error = fMapFile->Data(LaserMapFile::kErrorX);
+    fMask.resize(fGrid.NumberOfVoxels());
+    for (size_t voxel_no = 0; voxel_no < fMask.size(); voxel_no++) fMask[voxel_no] = (Error[voxel_no] >= 0.f);
+
+    Initialize();
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserMapInterpolator::Initialize() {
+    const size_t Stride[3] = {1, fGrid.Size[0], size_t(fGrid.Size[0]) * fGrid.Size[1]};
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        fNodeOrigin[axis] = fGrid.Origin[axis] + 0.5f * fGrid.Spacing[axis];
+        fInverseSpacing[axis] = 1.f / fGrid.Spacing[axis];
+        fMaxNode[axis] = float(fGrid.Size[axis] - 1);
+        fMaxCell[axis] = (fGrid.Size[axis] > 1) ? fGrid.Size[axis] - 2 : 0;
+        fStep[axis] = (fGrid.Size[axis] > 1) ? Stride[axis] : 0;
+    }
+
+    // Without holes the plain trilinear blend is used
+    fAllMeasured = std::find(fMask.begin(), fMask.end(), 0.f) == fMask.end();
+    if (fAllMeasured) {
+        fMask.clear();
+        fMask.shrink_to_fit();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserMapInterpolator::Locate(const float *X, const float *Y, const float *Z, size_t NumberOfPoints,
+                                            size_t *Corner, float *FractionX, float *FractionY,
+                                            float *FractionZ) const {
+    float *Fractions[3] = {FractionX, FractionY, FractionZ};
+
+    // Clamping instead of branches keeps this loop vectorizable
+    for (size_t point_no = 0; point_no < NumberOfPoints; point_no++) {
+        const float Point[3] = {X[point_no], Y[point_no], Z[point_no]};
+        unsigned int Cell[3];
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            float Node = (Point[axis] - fNodeOrigin[axis]) * fInverseSpacing[axis];
+            Node = (Node > 0.f) ? std::min(Node, fMaxNode[axis]) : 0.f;  // NaN goes to the first node
+            Cell[axis] = std::min((unsigned int) Node, fMaxCell[axis]);
+            Fractions[axis][point_no] = Node - Cell[axis];
+        }
+        Corner[point_no] = fGrid.Index(Cell[0], Cell[1], Cell[2]);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserMapInterpolator::GetDisplacement(float X, float Y, float Z, float Displacement[3]) const {
+    size_t Corner;
+    float FractionX, FractionY, FractionZ;
+    Locate(&X, &Y, &Z, 1, &Corner, &FractionX, &FractionY, &FractionZ);
+
+    const float *Values[3] = {fDisplacementX, fDisplacementY, fDisplacementZ};
+    for (unsigned int axis = 0; axis < 3; axis++) {
+        Displacement[axis] = fAllMeasured
+                             ? Trilinear(Values[axis], Corner, fStep, FractionX, FractionY, FractionZ)
+                             : MaskedTrilinear(Values[axis], fMask.data(), Corner, fStep,
+                                               FractionX, FractionY, FractionZ);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserMapInterpolator::Correct(float *X, float *Y, float *Z, size_t NumberOfPoints) const {
+    size_t Corner[kBatchSize];
+    float FractionX[kBatchSize], FractionY[kBatchSize], FractionZ[kBatchSize];
+    float Delta[3][kBatchSize];
+    const float *Values[3] = {fDisplacementX, fDisplacementY, fDisplacementZ};
+
+    for (size_t first = 0; first < NumberOfPoints; first += kBatchSize) {
+        const size_t BatchSize = std::min(kBatchSize, NumberOfPoints - first);
+        float *BatchX = X + first;
+        float *BatchY = Y + first;
+        float *BatchZ = Z + first;
+
+        // All points of the batch are located before anything is moved
+        Locate(BatchX, BatchY, BatchZ, BatchSize, Corner, FractionX, FractionY, FractionZ);
+
+        // One component at a time, so that every gather only touches one map array
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            if (fAllMeasured) {
+                for (size_t point_no = 0; point_no < BatchSize; point_no++) {
+                    Delta[axis][point_no] = Trilinear(Values[axis], Corner[point_no], fStep, FractionX[point_no],
+                                                      FractionY[point_no], FractionZ[point_no]);
+                }
+            } else {
+                for (size_t point_no = 0; point_no < BatchSize; point_no++) {
+                    Delta[axis][point_no] = MaskedTrilinear(Values[axis], fMask.data(), Corner[point_no], fStep,
+                                                            FractionX[point_no], FractionY[point_no],
+                                                            FractionZ[point_no]);
+                }
+            }
+        }
+
+        for (size_t point_no = 0; point_no < BatchSize; point_no++) {
+            BatchX[point_no] += Delta[0][point_no];
+            BatchY[point_no] += Delta[1][point_no];
+            BatchZ[point_no] += Delta[2][point_no];
+        }
+    }
+}
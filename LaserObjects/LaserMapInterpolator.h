@@ -0,0 +1,87 @@
+/**
+ * @file   LaserMapInterpolator.h
+ * @brief  Trilinear lookup of a displacement map for many points at once
+ */
+
+#ifndef lasercal_LaserMapInterpolator_H
+#define lasercal_LaserMapInterpolator_H
+
+#include "LaserObjects/LaserDistortionMap.h"
+#include "LaserObjects/LaserMapFile.h"
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace lasercal
+{
+    /**
+     * @brief Applies a displacement map to points in structure-of-arrays layout
+     *
+     * The map values are taken at the voxel centers and interpolated trilinearly in between. Points outside of the
+     * centers (also outside of the grid) get the value of the closest border, so every point is corrected.
+     *
+     * Voxels without measured displacement (not valid in the map, negative error in the file) are left out of the
+     * blend and the weights of the measured nodes are renormalized. A point whose measured nodes all have zero
+     * weight gets the mean of the measured nodes of its cell, a cell without any measured node gives no correction.
+     */
+    class LaserMapInterpolator {
+    public:
+        /// Points handled per batch, the index and weight arrays of one batch stay in the L1 cache
+        static constexpr size_t kBatchSize = 256;
+
+        /**
+         * @brief Keeps a copy of the displacements and measurement flags of the map
+         * @throws art::Exception (Configuration) if the arrays do not match the grid
+         */
+        explicit LaserMapInterpolator(const LaserDisplacementMap &Map);
+
+        /**
+         * @brief Uses the displacements of the mapped file in place (the file stays mapped as long as it is used)
+         *
+         * Only the measurement flags are copied (one float per voxel, none if all voxels are measured).
+         */
+        explicit LaserMapInterpolator(std::shared_ptr<const LaserMapFile> MapFile);
+
+        LaserMapInterpolator(const LaserMapInterpolator &) = delete;
+
+        LaserMapInterpolator &operator=(const LaserMapInterpolator &) = delete;
+
+        /**
+         * @brief Interpolated displacement at a single point
+         * @param Displacement output displacement (true minus reconstructed position)
+         */
+        void GetDisplacement(float X, float Y, float Z, float Displacement[3]) const;
+
+        /**
+         * @brief Adds the interpolated displacement to all points in place
+         * @param X, Y, Z point coordinates, corrected in place
+         * @param NumberOfPoints number of points
+         */
+        void Correct(float *X, float *Y, float *Z, size_t NumberOfPoints) const;
+
+        const LaserVoxelGrid &GetGrid() const { return fGrid; }
+
+    private:
+        void Initialize();
+
+        /// Cell corner indices and weights of a batch of points
+        void Locate(const float *X, const float *Y, const float *Z, size_t NumberOfPoints, size_t *Corner,
+                    float *FractionX, float *FractionY, float *FractionZ) const;
+
+        LaserVoxelGrid fGrid;
+        float fNodeOrigin[3];     ///< center of the first voxel
+        float fInverseSpacing[3];
+        float fMaxNode[3];        ///< last node index as float (clamp limit)
+        unsigned int fMaxCell[3]; ///< last cell index, the upper corner is one step further
+        size_t fStep[3];          ///< index step to the next node, zero along axes with a single voxel
+        std::vector<float> fStorage;                      ///< displacements of a map given in memory
+        std::shared_ptr<const LaserMapFile> fMapFile;     ///< or the file they are mapped from
+        const float *fDisplacementX, *fDisplacementY, *fDisplacementZ;
+        std::vector<float> fMask;                         ///< 1 for voxels with measured displacement, else 0
+        bool fAllMeasured;                                ///< no holes, the mask is not used
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserMapInterpolator_H
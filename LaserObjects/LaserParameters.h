@@ -44,6 +44,23 @@ namespace lasercal {
         // Hit box size (LaserROI)
         float HitBoxSize;
 
+        // Activate/deactivate the track following hit finder (LaserTrackFollower/LaserReco)
+        bool UseTrackFollower;
+
+        // Number of wires at the entry point which are scanned with the wide seed window
+        unsigned int FollowerSeedWires;
+
+        // Half width of the tick window around the predicted hit time (seed wires / following / maximum after widening)
+        float FollowerSeedTickWindow;
+        float FollowerTickWindow;
+        float FollowerMaxTickWindow;
+
+        // Number of last hits used for the linear time prediction
+        unsigned int FollowerFitPoints;
+
+        // Number of consecutive wires without a hit before the track is abandoned
+        unsigned int FollowerMaxMisses;
+
         // Input tag for raw digits (LaserReco)
         art::InputTag RawDigitTag;
 
@@ -55,6 +72,13 @@ namespace lasercal {
             return art::InputTag(LaserDataMergerModuleLabel, LaserBeamInstanceLabel);
         }
 
+        // Read the laser beams from the run-level LaserBeamTable of the merger instead of the events
+        bool LaserBeamFromRun;
+
+        art::InputTag GetLaserBeamTableTag() {
+            return art::InputTag(LaserDataMergerModuleLabel, "LaserBeamTable");
+        }
+
     }; // struct
 
 
@@ -107,6 +107,54 @@ lasercal::LaserROI::LaserROI(const float& BoxSize, const lasercal::LaserBeam& La
 
 //----------------------------------------------------------------------------------------------------------------
 
+void lasercal::LaserROI::SetCenterLine(unsigned int Plane, const std::map<unsigned int, float>& CenterTicks, float TickHalfWidth, unsigned int WirePadding)
+{
+    fRanges.at(Plane).clear();
+    
+    if(CenterTicks.empty()) return;
+    
+    // Loop over all center line points and interpolate linearly to the next one
+    for(auto Iter = CenterTicks.begin(); Iter != CenterTicks.end(); Iter++)
+    {
+	auto Next = std::next(Iter);
+	
+	if(Next == CenterTicks.end())
+	{
+	    fRanges.at(Plane).insert( std::make_pair(Iter->first, std::make_pair(Iter->second-TickHalfWidth,Iter->second+TickHalfWidth)) );
+	    break;
+	}
+	
+	float TickSlope = (Next->second - Iter->second) / ((float)Next->first - (float)Iter->first);
+	
+	for(unsigned int wire_no = Iter->first; wire_no < Next->first; wire_no++)
+	{
+	    float CenterTick = Iter->second + ((float)wire_no - (float)Iter->first)*TickSlope;
+	    fRanges.at(Plane).insert( std::make_pair(wire_no, std::make_pair(CenterTick-TickHalfWidth,CenterTick+TickHalfWidth)) );
+	}
+    }
+    
+    // Pad the first and last wire
+    auto FirstRange = *fRanges.at(Plane).begin();
+    auto LastRange = *fRanges.at(Plane).rbegin();
+    
+    for(unsigned int pad = 1; pad <= WirePadding; pad++)
+    {
+	if(FirstRange.first >= pad) fRanges.at(Plane).insert( std::make_pair(FirstRange.first - pad, FirstRange.second) );
+	if(LastRange.first + pad < fGeometry->Nwires(Plane)) fRanges.at(Plane).insert( std::make_pair(LastRange.first + pad, LastRange.second) );
+    }
+    
+    // Update entry point and exit point in wire coordinate
+    if(fEntryWire.size() < fRanges.size())
+    {
+	fEntryWire.resize(fRanges.size(),0);
+	fExitWire.resize(fRanges.size(),0);
+    }
+    fEntryWire.at(Plane) = fRanges.at(Plane).begin()->first;
+    fExitWire.at(Plane) = fRanges.at(Plane).rbegin()->first;
+}
+
+//----------------------------------------------------------------------------------------------------------------
+
 void lasercal::LaserROI::setRanges(int BoxTickCenter, int BoxTickWidth, unsigned int Plane, std::pair<unsigned int, unsigned int> Wires){
 
     std::pair<float,float> TickLimitsOfWire = std::make_pair(float(BoxTickCenter-BoxTickWidth/2), float(BoxTickCenter+BoxTickWidth/2));
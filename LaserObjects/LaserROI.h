@@ -15,6 +15,7 @@
 
 #include <iostream>
 #include <utility>
+#include <iterator>
 #include <map>
 #include <vector>
 #include <array>
@@ -53,6 +54,15 @@ namespace lasercal
       /// Sets Range range to check directely.
       std::vector< std::map< unsigned int, std::pair<float, float> > > GetRanges();
 
+      /**
+      * @brief Replaces the ranges of a plane by a box around a per-wire center line
+      * @param Plane plane number
+      * @param CenterTicks center time tick of the track for every wire (wires in between are interpolated)
+      * @param TickHalfWidth half width of the box in time ticks
+      * @param WirePadding number of wires the box is extended beyond the first and last wire
+      */
+      void SetCenterLine(unsigned int Plane, const std::map<unsigned int, float>& CenterTicks, float TickHalfWidth, unsigned int WirePadding = 0);
+
       unsigned int GetEntryWire(const unsigned int& PlaneNo) const;
       unsigned int GetExitWire(const unsigned int& PlaneNo) const;
       
@@ -0,0 +1,262 @@
+#include "LaserObjects/LaserRunDataStore.h"
+
+#include "art/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+constexpr uint32_t lasercal::LaserRunData::kNoLaser;
+
+namespace {
+    // Binary time map cache layout: header followed by the map values as they are in memory
+    const char kTimeMapMagic[8] = {'L', 'A', 'S', 'E', 'R', 'M', 'A', 'P'};
+    const uint32_t kTimeMapVersion = 1;
+
+    struct TimeMapHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t EntrySize;
+        uint64_t Count;
+        uint64_t SourceSize;
+        int64_t SourceTime;
+    };
+
+    bool ReadTimeMapCache(const std::string &CacheFile, const struct stat &Source, std::vector<uint32_t> &TimeMap) {
+        struct stat CacheStatus;
+        if (stat(CacheFile.c_str(), &CacheStatus) != 0) return false;
+
+        std::ifstream Cache(CacheFile, std::ios::in | std::ios::binary);
+        TimeMapHeader Header;
+        if (!Cache || !Cache.read(reinterpret_cast<char *>(&Header), sizeof(Header))) return false;
+
+        // Only use the cache if it belongs to exactly this version of the ROOT file and has all of its entries
+        if (std::memcmp(Header.Magic, kTimeMapMagic, sizeof(kTimeMapMagic)) != 0
+            || Header.Version != kTimeMapVersion
+            || Header.EntrySize != sizeof(uint32_t)
+            || Header.SourceSize != (uint64_t) Source.st_size
+            || Header.SourceTime != (int64_t) Source.st_mtime
+            || (uint64_t) CacheStatus.st_size != sizeof(Header) + Header.Count * sizeof(uint32_t)) {
+            return false;
+        }
+
+        TimeMap.resize(Header.Count);
+        if (!Cache.read(reinterpret_cast<char *>(TimeMap.data()), Header.Count * sizeof(uint32_t))) {
+            TimeMap.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void WriteTimeMapCache(const std::string &CacheFile, const struct stat &Source,
+                           const std::vector<uint32_t> &TimeMap) {
+        TimeMapHeader Header;
+        std::memcpy(Header.Magic, kTimeMapMagic, sizeof(kTimeMapMagic));
+        Header.Version = kTimeMapVersion;
+        Header.EntrySize = sizeof(uint32_t);
+        Header.Count = TimeMap.size();
+        Header.SourceSize = Source.st_size;
+        Header.SourceTime = Source.st_mtime;
+
+        // Write to a temporary file first, so that concurrent jobs never see a half written cache
+        std::string TempFile = CacheFile + ".tmp" + std::to_string(getpid());
+        {
+            std::ofstream Cache(TempFile, std::ios::out | std::ios::binary | std::ios::trunc);
+            Cache.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+            Cache.write(reinterpret_cast<const char *>(TimeMap.data()), TimeMap.size() * sizeof(uint32_t));
+            if (!Cache) {
+                std::remove(TempFile.c_str());
+                mf::LogWarning("LaserRunDataStore") << "Unable to write time map cache " << CacheFile;
+                return;
+            }
+        }
+        if (std::rename(TempFile.c_str(), CacheFile.c_str()) != 0) {
+            std::remove(TempFile.c_str());
+            mf::LogWarning("LaserRunDataStore") << "Unable to write time map cache " << CacheFile;
+        }
+    }
+}
+
+size_t lasercal::LaserRunData::MemoryFootprint() const {
+    return sizeof(LaserRunData) + TimeMap.capacity() * sizeof(uint32_t)
+           + LaserData.capacity() * sizeof(lasercal::LaserDataRecord);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserRunDataStore::LaserRunDataStore(size_t Capacity, bool UseDataCache)
+        : fCapacity(Capacity), fUseDataCache(UseDataCache) {
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+const lasercal::LaserRunData &lasercal::LaserRunDataStore::Load(unsigned int Run, bool ReadTimeMap) {
+    // Already in memory: move it to the front
+    for (auto RunIter = fRuns.begin(); RunIter != fRuns.end(); RunIter++) {
+        if (RunIter->Run == Run) {
+            fRuns.splice(fRuns.begin(), fRuns, RunIter);
+            return fRuns.front();
+        }
+    }
+
+    // Make room first, the new run always stays in memory until it is released
+    Evict(fCapacity);
+
+    // Take the prefetched data (waits if the background thread is not done yet), read it here otherwise
+    auto Prefetched = fPrefetches.find(Run);
+    bool FromPrefetch = (Prefetched != fPrefetches.end());
+    if (FromPrefetch) {
+        std::future<LaserRunData> Future = std::move(Prefetched->second);
+        fPrefetches.erase(Prefetched);
+        fRuns.push_front(Future.get());
+    } else {
+        fRuns.push_front(ReadRun(Run, ReadTimeMap, fUseDataCache));
+    }
+    const LaserRunData &Data = fRuns.front();
+
+    mf::LogInfo("LaserRunDataStore") << "Loaded run " << Run << (FromPrefetch ? " (prefetched): " : ": ")
+                                     << Data.LaserData.size() << " laser data lines, "
+                                     << Data.TimeMap.size() << " time map entries, "
+                                     << fRuns.size() << " runs in memory";
+    return Data;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserRunDataStore::Prefetch(unsigned int Run, bool ReadTimeMap) {
+    if (fPrefetches.count(Run)) return;
+    for (const auto &Data : fRuns) {
+        if (Data.Run == Run) return;
+    }
+
+    // Exceptions (e.g. missing files) are kept in the future and thrown by Load in the main thread
+    bool UseDataCache = fUseDataCache;
+    fPrefetches[Run] = std::async(std::launch::async, [Run, ReadTimeMap, UseDataCache]() {
+        return LaserRunDataStore::ReadRun(Run, ReadTimeMap, UseDataCache);
+    });
+    mf::LogDebug("LaserRunDataStore") << "Prefetching run " << Run;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+bool lasercal::LaserRunDataStore::IsReady(unsigned int Run) const {
+    for (const auto &Data : fRuns) {
+        if (Data.Run == Run) return true;
+    }
+    auto Prefetched = fPrefetches.find(Run);
+    return Prefetched != fPrefetches.end()
+           && Prefetched->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserRunData lasercal::LaserRunDataStore::ReadRun(unsigned int Run, bool ReadTimeMap, bool UseDataCache) {
+    LaserRunData Data;
+    Data.Run = Run;
+
+    if (ReadTimeMap) {
+        std::string TimemapFile = "TimeMap-" + std::to_string(Run) + ".root";
+        LaserRunDataStore::ReadTimeMap(TimemapFile, Data.TimeMap, UseDataCache);
+    }
+
+    std::string LaserFile = "Run-" + std::to_string(Run) + ".txt";
+    lasercal::LaserDataFile DataFile(LaserFile, UseDataCache);
+    Data.LaserData = DataFile.TakeRecords();
+
+    return Data;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserRunDataStore::Release(unsigned int Run) {
+    if (fCapacity > 0) {
+        Evict(fCapacity);
+        return;
+    }
+    fRuns.remove_if([Run](const LaserRunData &Data) { return Data.Run == Run; });
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+size_t lasercal::LaserRunDataStore::MemoryFootprint() const {
+    size_t Footprint = 0;
+    for (const auto &Data : fRuns) Footprint += Data.MemoryFootprint();
+    return Footprint;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserRunDataStore::Evict(size_t MaxRuns) {
+    while (fRuns.size() > MaxRuns) {
+        mf::LogDebug("LaserRunDataStore") << "Evicting run " << fRuns.back().Run;
+        fRuns.pop_back();
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+std::string lasercal::LaserRunDataStore::TimeMapCacheName(const std::string &FileName) {
+    return FileName + ".cache";
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserRunDataStore::ReadTimeMap(const std::string &FileName, std::vector<uint32_t> &TimeMap,
+                                              bool UseCache) {
+    struct stat Source;
+    if (stat(FileName.c_str(), &Source) != 0) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserRunDataStore: unable to open time map "
+                                                         << FileName << "\n";
+    }
+
+    // The whole map in one read from the binary cache
+    if (UseCache && ReadTimeMapCache(TimeMapCacheName(FileName), Source, TimeMap)) return;
+
+    std::unique_ptr<TFile> InputFile(TFile::Open(FileName.c_str(), "READ"));
+    if (!InputFile || InputFile->IsZombie()) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserRunDataStore: unable to open time map "
+                                                         << FileName << "\n";
+    }
+
+    TTree *tree = (TTree *) InputFile->Get("tree");
+    if (!tree) {
+        throw art::Exception(art::errors::FileReadError) << "LaserRunDataStore: no tree in time map "
+                                                         << FileName << "\n";
+    }
+
+    TBranch *branch = tree->GetBranch("map");
+    if (!branch) {
+        throw art::Exception(art::errors::FileReadError) << "LaserRunDataStore: no map branch in time map "
+                                                         << FileName << "\n";
+    }
+
+    // The entry number is the event index, so the map is a dense vector. ROOT of this release has no bulk read of
+    // a branch, the entries are read one by one (only the map branch, through the tree cache).
+    Long64_t nentries = tree->GetEntries();
+    TimeMap.assign(nentries, LaserRunData::kNoLaser);
+
+    tree->SetBranchStatus("*", 0);
+    tree->SetBranchStatus("map", 1);
+    tree->SetCacheSize(10 * 1024 * 1024);
+    tree->AddBranchToCache(branch, true);
+
+    UInt_t map_root;
+    branch->SetAddress(&map_root);
+    for (Long64_t idx = 0; idx < nentries; idx++) {
+        branch->GetEntry(idx);
+        TimeMap[idx] = map_root;
+    }
+    branch->ResetAddress();
+
+    if (UseCache) WriteTimeMapCache(TimeMapCacheName(FileName), Source, TimeMap);
+}
@@ -0,0 +1,114 @@
+/**
+ * @file   LaserRunDataStore.h
+ * @brief  Per-run store of the laser data (time map and laser data file) with bounded memory
+ */
+
+#ifndef lasercal_LaserRunDataStore_H
+#define lasercal_LaserRunDataStore_H
+
+#include "LaserObjects/LaserDataFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <map>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace lasercal
+{
+    /// Laser data of a single run
+    struct LaserRunData {
+        /// Time map entry of events without laser data (same value as written by python/Merger.py)
+        static constexpr uint32_t kNoLaser = std::numeric_limits<uint32_t>::max();
+
+        unsigned int Run = 0;
+
+        std::vector<uint32_t> TimeMap;                 ///< Index is the event, value the line in the laser data
+        std::vector<lasercal::LaserDataRecord> LaserData; ///< Typed lines of the laser data file
+
+        /// True if the time map has a laser data line for this event
+        bool HasLaser(size_t Event) const {
+            return Event < TimeMap.size() && TimeMap[Event] != kNoLaser && TimeMap[Event] < LaserData.size();
+        }
+
+        /// Approximate heap memory used by this run in bytes
+        size_t MemoryFootprint() const;
+    };
+
+    /**
+     * @brief Loads the laser data per run and keeps at most Capacity runs in memory
+     *
+     * The runs are kept in least recently used order. Load() moves a run to the front (or reads it from disk) and
+     * drops the least recently used runs beyond the capacity. With capacity 0 a run is dropped as soon as it is
+     * released at the end of the run, so a job over many runs only ever holds the current one.
+     * References returned by Load() stay valid until the run is released or evicted.
+     *
+     * Prefetch() reads a run on a background thread while the current run is processed. The next Load() of this
+     * run then only waits for (or takes) the finished data. A prefetched run is not counted in the capacity until
+     * it is loaded, so at most Capacity + 2 runs are in memory (kept, current and prefetched).
+     */
+    class LaserRunDataStore {
+    public:
+        /**
+         * @brief Constructor
+         * @param Capacity number of runs kept after their end of run (0: drop at end of run)
+         * @param UseDataCache use the binary caches of the laser data files (see LaserDataFile) and time maps
+         */
+        explicit LaserRunDataStore(size_t Capacity = 0, bool UseDataCache = true);
+
+        /**
+         * @brief Returns the data of a run, reads TimeMap-<run>.root (if ReadTimeMap) and Run-<run>.txt if needed
+         */
+        const LaserRunData &Load(unsigned int Run, bool ReadTimeMap);
+
+        /**
+         * @brief Marks the end of a run, the run is dropped right away with capacity 0
+         */
+        void Release(unsigned int Run);
+
+        /**
+         * @brief Starts reading a run on a background thread (no effect if it is in memory or already requested)
+         */
+        void Prefetch(unsigned int Run, bool ReadTimeMap);
+
+        /// True if the run is in memory or its prefetch is finished
+        bool IsReady(unsigned int Run) const;
+
+        /// Number of runs in memory
+        size_t size() const { return fRuns.size(); }
+
+        /// Approximate heap memory used by all runs in bytes
+        size_t MemoryFootprint() const;
+
+        /// Reads the time map (if ReadTimeMap) and the laser data file of a run
+        static LaserRunData ReadRun(unsigned int Run, bool ReadTimeMap, bool UseDataCache);
+
+        /**
+         * @brief Reads the time map of a run (tree "tree", branch "map", generated in python)
+         *
+         * With UseCache the map is read in one block from a binary cache next to the ROOT file
+         * (<file>.cache), as long as size and modification time of the ROOT file did not change. Otherwise the
+         * branch is read entry by entry and the cache is written for the next job.
+         */
+        static void ReadTimeMap(const std::string &FileName, std::vector<uint32_t> &TimeMap, bool UseCache = true);
+
+        /// Name of the binary cache belonging to a time map file
+        static std::string TimeMapCacheName(const std::string &FileName);
+
+    private:
+        void Evict(size_t MaxRuns);
+
+        size_t fCapacity;
+        bool fUseDataCache;
+
+        std::list<LaserRunData> fRuns;                  ///< Most recently used run first
+
+        std::map<unsigned int, std::future<LaserRunData> > fPrefetches; ///< Runs being read in the background
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserRunDataStore_H
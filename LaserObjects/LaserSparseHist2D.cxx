@@ -0,0 +1,86 @@
+#include "LaserObjects/LaserSparseHist2D.h"
+
+#include "art/Utilities/Exception.h"
+#include "cetlib/exception.h"
+
+#include "TDirectory.h"
+
+lasercal::LaserSparseHist2D::LaserSparseHist2D(const std::string &Name, const std::string &Title,
+                                               int NumberOfBinsX, double XLow, double XHigh,
+                                               int NumberOfBinsY, double YLow, double YHigh)
+        : fName(Name), fTitle(Title),
+          fNumberOfBinsX(NumberOfBinsX), fNumberOfBinsY(NumberOfBinsY),
+          fXLow(XLow), fXHigh(XHigh), fYLow(YLow), fYHigh(YHigh) {
+    if (NumberOfBinsX <= 0 || NumberOfBinsY <= 0 || !(XLow < XHigh) || !(YLow < YHigh)) {
+        throw art::Exception(art::errors::Configuration) << "LaserSparseHist2D: invalid binning of " << Name << "\n";
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+int lasercal::LaserSparseHist2D::FindBin(double Value, int NumberOfBins, double Low, double High) const {
+    // Same as TAxis::FindFixBin (NaN ends up in the overflow)
+    if (Value < Low) return 0;
+    if (!(Value < High)) return NumberOfBins + 1;
+    return 1 + int(NumberOfBins * (Value - Low) / (High - Low));
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserSparseHist2D::Fill(double X, double Y, float Weight) {
+    int BinX = FindBin(X, fNumberOfBinsX, fXLow, fXHigh);
+    int BinY = FindBin(Y, fNumberOfBinsY, fYLow, fYHigh);
+    fBins[BinX + (fNumberOfBinsX + 2) * BinY] += Weight;
+    fEntries++;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+float lasercal::LaserSparseHist2D::GetBinContent(int BinX, int BinY) const {
+    auto Bin = fBins.find(BinX + (fNumberOfBinsX + 2) * BinY);
+    return Bin == fBins.end() ? 0. : Bin->second;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+size_t lasercal::LaserSparseHist2D::MemoryFootprint() const {
+    // Node (key, value, next pointer) plus one bucket pointer per entry
+    return fBins.size() * (sizeof(std::pair<const int, float>) + sizeof(void *))
+           + fBins.bucket_count() * sizeof(void *);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserSparseHist2D::CopyTo(TH2 &Hist) const {
+    if (Hist.GetNbinsX() != fNumberOfBinsX || Hist.GetNbinsY() != fNumberOfBinsY) {
+        throw art::Exception(art::errors::LogicError) << "LaserSparseHist2D: binning of " << Hist.GetName()
+                                                      << " does not match " << fName << "\n";
+    }
+
+    double Entries = Hist.GetEntries() + fEntries;
+    for (const auto &Bin : fBins) {
+        Hist.AddBinContent(Bin.first, Bin.second);
+    }
+    // AddBinContent does not update the statistics, let ROOT recompute them from the bin contents
+    Hist.ResetStats();
+    Hist.SetEntries(Entries);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserSparseHist2D::WriteTo(TH2 *Hist) const {
+    TDirectory *Directory = Hist->GetDirectory();
+    if (!Directory) {
+        throw art::Exception(art::errors::LogicError) << "LaserSparseHist2D: " << Hist->GetName()
+                                                      << " is not in any directory\n";
+    }
+    CopyTo(*Hist);
+
+    // Deleting the histogram also removes it from the directory, the written key stays
+    int Bytes = Directory->WriteTObject(Hist);
+    delete Hist;
+    if (Bytes <= 0) {
+        throw cet::exception("FileWriteError") << "LaserSparseHist2D: unable to write " << fName << " to "
+                                               << Directory->GetPath() << "\n";
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file   LaserSparseHist2D.h
+ * @brief  Sparse 2D histogram accumulator, converted to a ROOT histogram only when it is written
+ */
+
+#ifndef lasercal_LaserSparseHist2D_H
+#define lasercal_LaserSparseHist2D_H
+
+#include "TH2.h"
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+namespace lasercal
+{
+    /**
+     * @brief 2D histogram with the binning of a TH2D, but only the filled bins are kept in memory (float counts)
+     *
+     * Hit shape studies book fine 2D histograms (millions of bins) of which only a small part is ever filled.
+     * This accumulator creates the bins on demand and only makes the full ROOT histogram at the end (see CopyTo),
+     * so a job holds at most one dense histogram at a time. Binning, under- and overflow follow TH2 exactly.
+     * Weights are summed, but no sum of squared weights is kept (errors are sqrt(content) as in a plain TH2D).
+     */
+    class LaserSparseHist2D {
+    public:
+        LaserSparseHist2D(const std::string &Name, const std::string &Title,
+                          int NumberOfBinsX, double XLow, double XHigh,
+                          int NumberOfBinsY, double YLow, double YHigh);
+
+        void Fill(double X, double Y, float Weight = 1.);
+
+        const std::string &GetName() const { return fName; }
+
+        const std::string &GetTitle() const { return fTitle; }
+
+        /// Number of Fill calls (as TH1::GetEntries)
+        size_t GetEntries() const { return fEntries; }
+
+        /// Content of a bin in TH2 numbering (0 = underflow, NumberOfBins + 1 = overflow)
+        float GetBinContent(int BinX, int BinY) const;
+
+        size_t NumberOfFilledBins() const { return fBins.size(); }
+
+        /// Approximate heap size of the filled bins
+        size_t MemoryFootprint() const;
+
+        int GetNbinsX() const { return fNumberOfBinsX; }
+        int GetNbinsY() const { return fNumberOfBinsY; }
+        double GetXmin() const { return fXLow; }
+        double GetXmax() const { return fXHigh; }
+        double GetYmin() const { return fYLow; }
+        double GetYmax() const { return fYHigh; }
+
+        /// Adds the contents to a histogram with the same binning (e.g. booked with the getters above)
+        void CopyTo(TH2 &Hist) const;
+
+        /**
+         * @brief Copies the contents into a histogram, writes it into its own directory and deletes it
+         * @param Hist histogram with the same binning, owned by a directory (e.g. booked with TFileService::make)
+         * @throws art::Exception (LogicError) if the histogram has no directory
+         * @throws cet::exception (FileWriteError) if the histogram could not be written
+         *
+         * TFileService::make restores gDirectory, so the histogram is written explicitly into its directory and not
+         * into the current one. Deleting it right away keeps only one dense histogram in memory at a time.
+         */
+        void WriteTo(TH2 *Hist) const;
+
+    private:
+        int FindBin(double Value, int NumberOfBins, double Low, double High) const;
+
+        std::string fName;
+        std::string fTitle;
+        int fNumberOfBinsX, fNumberOfBinsY;
+        double fXLow, fXHigh, fYLow, fYHigh;
+
+        size_t fEntries = 0;
+
+        // Key is the TH2 global bin number
+        std::unordered_map<int, float> fBins;
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserSparseHist2D_H
@@ -0,0 +1,190 @@
+#include "LaserObjects/LaserSpotterIndex.h"
+
+#include "art/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+#include <dirent.h>
+#include <unistd.h>
+
+namespace {
+    // File layout: header followed by the sorted decisions as they are in memory
+    const char kIndexMagic[8] = {'S', 'P', 'O', 'T', 'I', 'D', 'X', '1'};
+    const uint32_t kIndexVersion = 1;
+
+    struct IndexHeader {
+        char Magic[8];
+        uint32_t Version;
+        uint32_t RecordSize;
+        uint64_t Count;
+    };
+
+    inline bool EventLess(const lasercal::SpotterDecision &Left, const lasercal::SpotterDecision &Right) {
+        return Left.SubRun < Right.SubRun || (Left.SubRun == Right.SubRun && Left.Event < Right.Event);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+std::string lasercal::LaserSpotterIndex::FileName(const std::string &Directory, unsigned int Run,
+                                                  unsigned int SubRun) {
+    std::string Name = "SpotterIndex-" + std::to_string(Run) + "-" + std::to_string(SubRun) + ".dat";
+    if (Directory.empty()) return Name;
+    return Directory.back() == '/' ? Directory + Name : Directory + "/" + Name;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserSpotterIndex::Add(uint32_t Run, uint32_t SubRun, uint32_t Event, bool Pass,
+                                      unsigned int Multiplicity) {
+    SpotterDecision Decision;
+    Decision.Run = Run;
+    Decision.SubRun = SubRun;
+    Decision.Event = Event;
+    Decision.Pass = Pass;
+    Decision.Multiplicity = (uint16_t) std::min<unsigned int>(Multiplicity, std::numeric_limits<uint16_t>::max());
+
+    // Events mostly come in order, so the index usually stays sorted without any work
+    if (!fDecisions.empty() && !EventLess(fDecisions.back(), Decision)) fSorted = false;
+    fDecisions.push_back(Decision);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserSpotterIndex::Sort() {
+    if (fSorted) return;
+
+    // Stable, so that the last decision of an event processed twice is the one that is kept
+    std::stable_sort(fDecisions.begin(), fDecisions.end(), EventLess);
+    auto Last = std::unique(fDecisions.rbegin(), fDecisions.rend(),
+                            [](const SpotterDecision &Left, const SpotterDecision &Right) {
+                                return !EventLess(Left, Right) && !EventLess(Right, Left);
+                            });
+    fDecisions.erase(fDecisions.begin(), Last.base());
+    fSorted = true;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserSpotterIndex::Merge(const LaserSpotterIndex &Other) {
+    // Sort keeps the last decision of an event, so the other decisions go in front
+    fDecisions.insert(fDecisions.begin(), Other.fDecisions.begin(), Other.fDecisions.end());
+    fSorted = false;
+    Sort();
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+const lasercal::SpotterDecision *lasercal::LaserSpotterIndex::Find(uint32_t SubRun, uint32_t Event) const {
+    SpotterDecision Key;
+    Key.SubRun = SubRun;
+    Key.Event = Event;
+
+    auto Found = std::lower_bound(fDecisions.begin(), fDecisions.end(), Key, EventLess);
+    if (Found == fDecisions.end() || Found->SubRun != SubRun || Found->Event != Event) return nullptr;
+    return &*Found;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+size_t lasercal::LaserSpotterIndex::NumberOfPassed() const {
+    return std::count_if(fDecisions.begin(), fDecisions.end(),
+                         [](const SpotterDecision &Decision) { return Decision.Pass != 0; });
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserSpotterIndex::Write(const std::string &FileName) {
+    // Keep the decisions of events processed by an earlier job
+    if (std::ifstream(FileName)) Merge(Read(FileName));
+    Sort();
+
+    IndexHeader Header;
+    std::memcpy(Header.Magic, kIndexMagic, sizeof(kIndexMagic));
+    Header.Version = kIndexVersion;
+    Header.RecordSize = sizeof(SpotterDecision);
+    Header.Count = fDecisions.size();
+
+    std::string TempFile = FileName + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream Index(TempFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        Index.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+        Index.write(reinterpret_cast<const char *>(fDecisions.data()), fDecisions.size() * sizeof(SpotterDecision));
+        if (!Index) {
+            std::remove(TempFile.c_str());
+            throw art::Exception(art::errors::FileOpenError) << "LaserSpotterIndex: unable to write "
+                                                             << FileName << "\n";
+        }
+    }
+    if (std::rename(TempFile.c_str(), FileName.c_str()) != 0) {
+        std::remove(TempFile.c_str());
+        throw art::Exception(art::errors::FileOpenError) << "LaserSpotterIndex: unable to write "
+                                                         << FileName << "\n";
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserSpotterIndex lasercal::LaserSpotterIndex::Read(const std::string &FileName) {
+    std::ifstream Index(FileName, std::ios::in | std::ios::binary);
+    if (!Index) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserSpotterIndex: unable to open " << FileName << "\n";
+    }
+
+    IndexHeader Header;
+    if (!Index.read(reinterpret_cast<char *>(&Header), sizeof(Header))
+        || std::memcmp(Header.Magic, kIndexMagic, sizeof(kIndexMagic)) != 0
+        || Header.Version != kIndexVersion
+        || Header.RecordSize != sizeof(SpotterDecision)) {
+        throw art::Exception(art::errors::FileReadError) << "LaserSpotterIndex: " << FileName
+                                                         << " is not a spotter index (or of another version)\n";
+    }
+
+    LaserSpotterIndex SpotterIndex;
+    SpotterIndex.fDecisions.resize(Header.Count);
+    if (!Index.read(reinterpret_cast<char *>(SpotterIndex.fDecisions.data()),
+                    Header.Count * sizeof(SpotterDecision))) {
+        throw art::Exception(art::errors::FileReadError) << "LaserSpotterIndex: " << FileName << " is truncated\n";
+    }
+    mf::LogDebug("LaserSpotterIndex") << "Read " << SpotterIndex.size() << " decisions from " << FileName;
+    return SpotterIndex;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+lasercal::LaserSpotterIndex lasercal::LaserSpotterIndex::ReadRun(const std::string &Directory, unsigned int Run) {
+    std::string Path = Directory.empty() ? "." : Directory;
+    DIR *Listing = opendir(Path.c_str());
+    if (!Listing) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserSpotterIndex: unable to list " << Path << "\n";
+    }
+
+    // SpotterIndex-<run>-<subrun>.dat, the temporary files of running jobs have another ending
+    const std::string Prefix = "SpotterIndex-" + std::to_string(Run) + "-";
+    const std::string Suffix = ".dat";
+    std::vector<std::string> Files;
+    while (dirent *Entry = readdir(Listing)) {
+        std::string Name = Entry->d_name;
+        if (Name.size() > Prefix.size() + Suffix.size() && Name.compare(0, Prefix.size(), Prefix) == 0
+            && Name.compare(Name.size() - Suffix.size(), Suffix.size(), Suffix) == 0) {
+            Files.push_back(Name);
+        }
+    }
+    closedir(Listing);
+
+    if (Files.empty()) {
+        throw art::Exception(art::errors::FileOpenError) << "LaserSpotterIndex: no index file of run " << Run
+                                                         << " in " << Path << "\n";
+    }
+
+    LaserSpotterIndex SpotterIndex;
+    for (const auto &Name : Files) SpotterIndex.Merge(Read(Path + "/" + Name));
+    mf::LogDebug("LaserSpotterIndex") << "Read " << SpotterIndex.size() << " decisions of run " << Run << " from "
+                                      << Files.size() << " files";
+    return SpotterIndex;
+}
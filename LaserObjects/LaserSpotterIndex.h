@@ -0,0 +1,89 @@
+/**
+ * @file   LaserSpotterIndex.h
+ * @brief  Per-run sidecar file with the LaserSpotter decision of every event
+ */
+
+#ifndef lasercal_LaserSpotterIndex_H
+#define lasercal_LaserSpotterIndex_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+namespace lasercal
+{
+    /// Spotter decision of one event
+    struct SpotterDecision {
+        uint32_t Run;
+        uint32_t SubRun;
+        uint32_t Event;
+        uint16_t Pass;              ///< 1 if the spotter passed the event
+        uint16_t Multiplicity;      ///< Wires with hits (or counted wires in ChargeSum mode) in the box
+    };
+
+    static_assert(std::is_trivial<SpotterDecision>::value && sizeof(SpotterDecision) == 16,
+                  "SpotterDecision is written to the index file as is");
+
+    /**
+     * @brief Decisions of the LaserSpotter for one run (SpotterIndex-<run>-<subrun>.dat)
+     *
+     * The spotter fills the index while it runs and writes one file per subrun at the end of each subrun, so jobs
+     * over different files of a run do not overwrite each other. Writing into an existing file keeps its decisions
+     * of the events that are not in the index. Later passes over the same run (e.g. with the SpotterIndexFilter as
+     * first module of the path) read all files of the run and look the events up there instead of decoding the raw
+     * digits again. The decisions are kept sorted by (subrun, event), so a lookup is a binary search.
+     */
+    class LaserSpotterIndex {
+    public:
+        LaserSpotterIndex() = default;
+
+        /// Name of the index file of a subrun in the given directory (current directory if empty)
+        static std::string FileName(const std::string &Directory, unsigned int Run, unsigned int SubRun);
+
+        /**
+         * @brief Reads an index file
+         * @throws art::Exception (FileOpenError / FileReadError) if the file is missing or malformed
+         */
+        static LaserSpotterIndex Read(const std::string &FileName);
+
+        /**
+         * @brief Reads and merges all index files of a run in the given directory
+         * @throws art::Exception (FileOpenError / FileReadError) if there is no index file or one is malformed
+         */
+        static LaserSpotterIndex ReadRun(const std::string &Directory, unsigned int Run);
+
+        /**
+         * @brief Writes the index, merged with the decisions already in the file
+         *
+         * Goes through a temporary file, so readers never see a half written index.
+         */
+        void Write(const std::string &FileName);
+
+        /// Adds the decisions of another index, the decisions of this index win for events in both
+        void Merge(const LaserSpotterIndex &Other);
+
+        /// Adds (or replaces) the decision of an event
+        void Add(uint32_t Run, uint32_t SubRun, uint32_t Event, bool Pass, unsigned int Multiplicity);
+
+        /// Returns the decision of an event or nullptr if the event is not in the index
+        const SpotterDecision *Find(uint32_t SubRun, uint32_t Event) const;
+
+        const std::vector<SpotterDecision> &GetDecisions() const { return fDecisions; }
+
+        size_t size() const { return fDecisions.size(); }
+
+        size_t NumberOfPassed() const;
+
+        void clear() { fDecisions.clear(); fSorted = true; }
+
+    private:
+        void Sort();
+
+        std::vector<SpotterDecision> fDecisions;
+        bool fSorted = true;
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserSpotterIndex_H
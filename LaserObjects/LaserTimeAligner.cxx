@@ -0,0 +1,149 @@
+#include "LaserObjects/LaserTimeAligner.h"
+
+#include "art/Utilities/Exception.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+lasercal::LaserTimeAligner::LaserTimeAligner(const std::vector<lasercal::LaserDataRecord> &LaserData,
+                                             double MaxTimeDelta, double OffsetSmoothing, unsigned int FirstEvent)
+        : fMaxTimeDelta(MaxTimeDelta), fOffsetSmoothing(OffsetSmoothing), fFirstEvent(FirstEvent) {
+    // Sort the triggers by time, the laser server writes them in order but this is not guaranteed
+    std::vector<size_t> Order(LaserData.size());
+    std::iota(Order.begin(), Order.end(), 0);
+
+    auto Time = [&LaserData](size_t Index) {
+        return (double) LaserData[Index].TriggerTimeSec + 1e-6 * (double) LaserData[Index].TriggerTimeUsec;
+    };
+    std::stable_sort(Order.begin(), Order.end(), [&Time](size_t a, size_t b) { return Time(a) < Time(b); });
+
+    fLaserTimes.reserve(Order.size());
+    fLaserIndices.reserve(Order.size());
+    fTriggerCounts.reserve(Order.size());
+    for (auto Index : Order) {
+        fLaserTimes.push_back(Time(Index));
+        fLaserIndices.push_back(Index);
+        fTriggerCounts.push_back(LaserData[Index].TriggerCount);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+size_t lasercal::LaserTimeAligner::FindClosest(double LaserTime) {
+    // Events are in time order: the pointer only moves forward
+    size_t Size = fLaserTimes.size();
+    while (fPointer + 1 < Size && fLaserTimes[fPointer + 1] <= LaserTime) fPointer++;
+
+    // The trigger after the pointer can be closer
+    if (fPointer + 1 < Size
+        && std::abs(fLaserTimes[fPointer + 1] - LaserTime) < std::abs(fLaserTimes[fPointer] - LaserTime)) {
+        return fPointer + 1;
+    }
+    return fPointer;
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+int lasercal::LaserTimeAligner::Match(unsigned int EventNumber, unsigned long TimeSec, unsigned long TimeNsec) {
+    double DaqTime = (double) TimeSec + 1e-9 * (double) TimeNsec;
+
+    // The first event of the run defines the clock offset (it belongs to the first laser trigger)
+    if (!fHasOffset) {
+        if (EventNumber != fFirstEvent) {
+            throw art::Exception(art::errors::Configuration)
+                    << "LaserTimeAligner: the event stream starts at event " << EventNumber << ", the clock offset "
+                    << "needs event " << fFirstEvent << " (process the files of a run completely and in order)\n";
+        }
+        fHasOffset = true;
+        fLastEventTime = DaqTime;
+        if (!fLaserTimes.empty()) {
+            fOffset = DaqTime - fLaserTimes.front();
+            mf::LogInfo("LaserTimeAligner") << "Initial clock offset DAQ - laser: " << fOffset << " s";
+        }
+    }
+
+    if (DaqTime < fLastEventTime) {
+        throw art::Exception(art::errors::Configuration)
+                << "LaserTimeAligner: event " << EventNumber << " is earlier than the previous event (DAQ time "
+                << TimeSec << "." << TimeNsec << "), the events have to come in time order\n";
+    }
+    fLastEventTime = DaqTime;
+
+    if (fLaserTimes.empty()) {
+        fMisses++;
+        return -1;
+    }
+
+    size_t Previous = fLastMatch;
+    size_t Closest = FindClosest(DaqTime - fOffset);
+    double Residual = DaqTime - fOffset - fLaserTimes[Closest];
+
+    if (std::abs(Residual) >= fMaxTimeDelta) {
+        fMisses++;
+        mf::LogWarning("LaserTimeAligner") << "No laser trigger for event " << EventNumber << " at DAQ time "
+                                           << TimeSec << "." << TimeNsec << " (closest " << Residual << " s away)";
+        return -1;
+    }
+
+    // Every laser trigger belongs to one event at most
+    if (fHasMatch && Closest == Previous) {
+        fDuplicates++;
+        mf::LogWarning("LaserTimeAligner") << "Laser line " << fLaserIndices[Closest] << " is already matched, "
+                                           << "event " << EventNumber << " gets no laser trigger";
+        return -1;
+    }
+
+    // Laser triggers between two consecutive matches had no DAQ event
+    if (fHasMatch && Closest > Previous + 1) {
+        fSkippedTriggers += Closest - Previous - 1;
+        mf::LogDebug("LaserTimeAligner") << "Skipped " << Closest - Previous - 1 << " laser triggers before line "
+                                         << fLaserIndices[Closest];
+    }
+
+    // Trigger counter of the encoder should increase by one per shot
+    if (fHasMatch && fTriggerCounts[Closest] - fLastTriggerCount != (int) (Closest - Previous)) {
+        fCounterJumps++;
+        mf::LogWarning("LaserTimeAligner") << "Trigger counter jump from " << fLastTriggerCount << " to "
+                                           << fTriggerCounts[Closest] << " at laser line " << fLaserIndices[Closest];
+    }
+
+    // Track the drift of the two clocks
+    fOffset += fOffsetSmoothing * Residual;
+
+    fPointer = Closest;
+    fLastMatch = Closest;
+    fHasMatch = true;
+    fLastDaqTime = DaqTime;
+    fLastTriggerCount = fTriggerCounts[Closest];
+
+    fMatches++;
+    fResidualSum += Residual;
+    fResidualSumSquared += Residual * Residual;
+
+    return (int) fLaserIndices[Closest];
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+double lasercal::LaserTimeAligner::GetResidualMean() const {
+    return fMatches ? fResidualSum / fMatches : 0.;
+}
+
+double lasercal::LaserTimeAligner::GetResidualRMS() const {
+    if (!fMatches) return 0.;
+    double Mean = GetResidualMean();
+    return std::sqrt(std::max(fResidualSumSquared / fMatches - Mean * Mean, 0.));
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserTimeAligner::PrintSummary() const {
+    mf::LogInfo("LaserTimeAligner") << "Time alignment: " << fMatches << " matched, " << fMisses << " unmatched, "
+                                    << fSkippedTriggers << " laser triggers without event, "
+                                    << fDuplicates << " duplicate matches rejected, "
+                                    << fCounterJumps << " trigger counter jumps\n"
+                                    << "  clock offset DAQ - laser: " << fOffset << " s, residuals: "
+                                    << GetResidualMean() << " +- " << GetResidualRMS() << " s";
+}
@@ -0,0 +1,110 @@
+/**
+ * @file   LaserTimeAligner.h
+ * @brief  Online matching of DAQ event times to laser trigger times
+ */
+
+#ifndef lasercal_LaserTimeAligner_H
+#define lasercal_LaserTimeAligner_H
+
+#include "LaserObjects/LaserDataFile.h"
+
+#include <cstddef>
+#include <vector>
+
+/*
+ *  Replaces the TimeMapProducer -> python/Merger.py -> ReadTimeMap chain by a single pass. Every DAQ event time is
+ *  matched to the laser trigger times (sorted in time) with a two pointer merge:
+ *
+ *   1. The clock offset between DAQ and laser server is taken from the first event of the run and the first laser
+ *      trigger (same assumption as in Merger.py, which also refuses streams not starting at the first event) and
+ *      then follows the residuals of the matched events, so slow drifts of the two clocks are tracked.
+ *   2. The events have to come in time order (files of the run in order), otherwise an exception is thrown. The
+ *      laser pointer only moves forward, laser triggers without DAQ event are skipped and counted.
+ *   3. A match is accepted if the time difference is smaller than MaxTimeDelta. Every laser trigger is matched to
+ *      one event at most, a second event closest to the same trigger is rejected and counted as duplicate. Jumps of
+ *      the trigger counter of the laser encoder between two consecutive matches are counted as well.
+ */
+
+namespace lasercal
+{
+    class LaserTimeAligner {
+    public:
+        /**
+         * @brief Constructor
+         * @param LaserData lines of the laser data file (in file order)
+         * @param MaxTimeDelta maximum time difference for a match in seconds
+         * @param OffsetSmoothing weight of a new residual in the clock offset tracking (0 = fixed offset)
+         * @param FirstEvent number of the first event of the run, it anchors the clock offset
+         */
+        LaserTimeAligner(const std::vector<lasercal::LaserDataRecord> &LaserData, double MaxTimeDelta = 0.1,
+                         double OffsetSmoothing = 0.1, unsigned int FirstEvent = 0);
+
+        /**
+         * @brief Matches a DAQ event time to a laser trigger
+         * @param EventNumber event number, the first call has to be for the first event of the run
+         * @param TimeSec DAQ event time in seconds (art::Timestamp::timeHigh)
+         * @param TimeNsec fraction of the DAQ event time in nanoseconds (art::Timestamp::timeLow)
+         * @return index of the laser data line, -1 if there is no laser trigger close enough or it is already matched
+         * @throws art::Exception (Configuration) if the stream does not start at the first event or is not in time order
+         */
+        int Match(unsigned int EventNumber, unsigned long TimeSec, unsigned long TimeNsec);
+
+        /// Current clock offset DAQ - laser in seconds
+        double GetOffset() const { return fOffset; }
+
+        unsigned int GetNumberOfMatches() const { return fMatches; }
+
+        unsigned int GetNumberOfMisses() const { return fMisses; }
+
+        /// Number of events rejected because their closest laser trigger was already matched
+        unsigned int GetNumberOfDuplicates() const { return fDuplicates; }
+
+        /// Number of laser triggers without DAQ event
+        unsigned int GetNumberOfSkippedTriggers() const { return fSkippedTriggers; }
+
+        /// Number of discontinuities of the trigger counter between consecutive matches
+        unsigned int GetNumberOfCounterJumps() const { return fCounterJumps; }
+
+        /// Mean and RMS of the time residuals of the matches in seconds
+        double GetResidualMean() const;
+
+        double GetResidualRMS() const;
+
+        /// Writes a summary to the message logger
+        void PrintSummary() const;
+
+    private:
+        // Returns the index of the laser trigger closest to the time (in laser clock)
+        size_t FindClosest(double LaserTime);
+
+        std::vector<double> fLaserTimes;        ///< Laser trigger times (seconds), sorted
+        std::vector<size_t> fLaserIndices;      ///< Line in the laser data file for each sorted time
+        std::vector<int> fTriggerCounts;        ///< Trigger counter for each sorted time
+
+        double fMaxTimeDelta;
+        double fOffsetSmoothing;
+        unsigned int fFirstEvent;
+
+        bool fHasOffset = false;
+        double fOffset = 0.;
+
+        size_t fPointer = 0;                    ///< Current position of the merge in the sorted times
+        size_t fLastMatch = 0;                  ///< Position of the last match in the sorted times
+        bool fHasMatch = false;
+        double fLastEventTime = 0.;             ///< DAQ time of the last event (matched or not)
+        double fLastDaqTime = 0.;               ///< DAQ time of the last match
+        int fLastTriggerCount = 0;
+
+        unsigned int fMatches = 0;
+        unsigned int fMisses = 0;
+        unsigned int fSkippedTriggers = 0;
+        unsigned int fCounterJumps = 0;
+        unsigned int fDuplicates = 0;
+
+        double fResidualSum = 0.;
+        double fResidualSumSquared = 0.;
+    };
+
+} // namespace lasercal
+
+#endif // lasercal_LaserTimeAligner_H
@@ -1,12 +1,14 @@
 #include "LaserTrack.h"
 
+#include "art/Utilities/Exception.h"
+
 namespace lasercal
 {
   LaserTrack::LaserTrack(){}
   
-  LaserTrack::LaserTrack(TVector3& LaserPosition, TVector3& LaserDirection) /*: fLaserPosition(LaserPosition), fDirection(LaserDirection)*/
+  LaserTrack::LaserTrack(TVector3& LaserPosition, TVector3& LaserDirection) : LaserBeam(LaserPosition, LaserDirection)
   {
-    // Fill entry and exit point using geometry
+    // Entry and exit point are filled by LaserBeam using the geometry
   }
   
   void LaserTrack::SetPosition(TVector3& LaserPosition)
@@ -18,4 +20,201 @@ namespace lasercal
   {
     fDirection = LaserDirection;
   }
-}
\ No newline at end of file
+  
+  void LaserTrack::CorrectTrack(unsigned int MethodNumber)
+  {
+    const unsigned long NumberOfSamples = fReconstructedX.size();
+    fCorrectionX.resize(NumberOfSamples);
+    fCorrectionY.resize(NumberOfSamples);
+    fCorrectionZ.resize(NumberOfSamples);
+    
+    switch(MethodNumber)
+    {
+      case 0:
+      {
+        // Project every sample onto the true beam line, the correction points from the sample to this projection
+        TVector3 Direction = fDirection.Unit();
+        const double Position[3] = {fLaserPosition.X(), fLaserPosition.Y(), fLaserPosition.Z()};
+        const double Unit[3] = {Direction.X(), Direction.Y(), Direction.Z()};
+        for(unsigned long sample_no = 0; sample_no < NumberOfSamples; sample_no++)
+        {
+          double Relative[3] = {fReconstructedX[sample_no] - Position[0], fReconstructedY[sample_no] - Position[1],
+                                fReconstructedZ[sample_no] - Position[2]};
+          double Projection = Relative[0] * Unit[0] + Relative[1] * Unit[1] + Relative[2] * Unit[2];
+          fCorrectionX[sample_no] = Projection * Unit[0] - Relative[0];
+          fCorrectionY[sample_no] = Projection * Unit[1] - Relative[1];
+          fCorrectionZ[sample_no] = Projection * Unit[2] - Relative[2];
+        }
+        break;
+      }
+      default:
+        throw art::Exception(art::errors::Configuration) << "LaserTrack: unknown correction method "
+                                                         << MethodNumber << "\n";
+    }
+  }
+  
+  void LaserTrack::AddToCorrection(TVector3& Correction, unsigned long SampleNumber)
+  {
+    fCorrectionX.at(SampleNumber) += Correction.X();
+    fCorrectionY[SampleNumber] += Correction.Y();
+    fCorrectionZ[SampleNumber] += Correction.Z();
+  }
+  
+  std::array<float,2> LaserTrack::GetAngles() const
+  {
+    // Inverse of LaserBeam::SetDirection: the mirror frame is rotated against the uboone frame
+    TVector3 MirrorDirection(fDirection.Z(), fDirection.X(), fDirection.Y());
+    return {{(float) MirrorDirection.Phi(), (float) MirrorDirection.Theta()}};
+  }
+  
+  unsigned long LaserTrack::GetNumberOfSamples() const
+  {
+    return fReconstructedX.size();
+  }
+  
+  TVector3 LaserTrack::GetDirection() const
+  {
+    return fDirection;
+  }
+  
+  TVector3 LaserTrack::GetSamplePosition(const unsigned int& SampleNumber) const
+  {
+    return TVector3(fReconstructedX.at(SampleNumber), fReconstructedY[SampleNumber], fReconstructedZ[SampleNumber]);
+  }
+  
+  TVector3 LaserTrack::GetCorrection(const unsigned int& SampleNumber) const
+  {
+    return TVector3(fCorrectionX.at(SampleNumber), fCorrectionY[SampleNumber], fCorrectionZ[SampleNumber]);
+  }
+  
+  void LaserTrack::AppendSample(TVector3& Sample)
+  {
+    AppendSample(Sample.X(), Sample.Y(), Sample.Z(), 0., 0., 0.);
+  }
+  
+  void LaserTrack::AppendSample(float x, float y, float z)
+  {
+    AppendSample(x, y, z, 0., 0., 0.);
+  }
+  
+  void LaserTrack::AppendSample(TVector3& Sample, TVector3& Correction)
+  {
+    AppendSample(Sample.X(), Sample.Y(), Sample.Z(), Correction.X(), Correction.Y(), Correction.Z());
+  }
+  
+  void LaserTrack::AppendSample(float x, float y, float z, float dx, float dy, float dz)
+  {
+    fReconstructedX.push_back(x);
+    fReconstructedY.push_back(y);
+    fReconstructedZ.push_back(z);
+    fCorrectionX.push_back(dx);
+    fCorrectionY.push_back(dy);
+    fCorrectionZ.push_back(dz);
+  }
+  
+  void LaserTrack::AppendSamples(const float* X, const float* Y, const float* Z, unsigned long NumberOfSamples,
+                                 const float* dX, const float* dY, const float* dZ)
+  {
+    fReconstructedX.insert(fReconstructedX.end(), X, X + NumberOfSamples);
+    fReconstructedY.insert(fReconstructedY.end(), Y, Y + NumberOfSamples);
+    fReconstructedZ.insert(fReconstructedZ.end(), Z, Z + NumberOfSamples);
+    
+    if(dX && dY && dZ)
+    {
+      fCorrectionX.insert(fCorrectionX.end(), dX, dX + NumberOfSamples);
+      fCorrectionY.insert(fCorrectionY.end(), dY, dY + NumberOfSamples);
+      fCorrectionZ.insert(fCorrectionZ.end(), dZ, dZ + NumberOfSamples);
+    }
+    else
+    {
+      fCorrectionX.resize(fReconstructedX.size(), 0.f);
+      fCorrectionY.resize(fReconstructedY.size(), 0.f);
+      fCorrectionZ.resize(fReconstructedZ.size(), 0.f);
+    }
+  }
+  
+  void LaserTrack::Reserve(unsigned long NumberOfSamples)
+  {
+    for(auto* Values : {&fReconstructedX, &fReconstructedY, &fReconstructedZ,
+                        &fCorrectionX, &fCorrectionY, &fCorrectionZ})
+    {
+      Values->reserve(NumberOfSamples);
+    }
+  }
+  
+  void LaserTrack::ClearSamples()
+  {
+    for(auto* Values : {&fReconstructedX, &fReconstructedY, &fReconstructedZ,
+                        &fCorrectionX, &fCorrectionY, &fCorrectionZ})
+    {
+      Values->clear();
+    }
+  }
+  
+  LaserSampleView LaserTrack::GetSamples() const
+  {
+    return {fReconstructedX.data(), fReconstructedY.data(), fReconstructedZ.data(), fReconstructedX.size()};
+  }
+  
+  LaserSampleView LaserTrack::GetCorrections() const
+  {
+    return {fCorrectionX.data(), fCorrectionY.data(), fCorrectionZ.data(), fCorrectionX.size()};
+  }
+  
+  void LaserTrack::Resample(float Spacing)
+  {
+    if(!(Spacing > 0.f))
+    {
+      throw art::Exception(art::errors::Configuration) << "LaserTrack: resampling spacing has to be positive\n";
+    }
+    
+    const unsigned long NumberOfSamples = fReconstructedX.size();
+    if(NumberOfSamples < 2) return;
+    
+    // Segment lengths along the old sample path
+    std::vector<float> Length(NumberOfSamples - 1);
+    double TotalLength = 0.;
+    for(unsigned long sample_no = 0; sample_no + 1 < NumberOfSamples; sample_no++)
+    {
+      float dX = fReconstructedX[sample_no + 1] - fReconstructedX[sample_no];
+      float dY = fReconstructedY[sample_no + 1] - fReconstructedY[sample_no];
+      float dZ = fReconstructedZ[sample_no + 1] - fReconstructedZ[sample_no];
+      Length[sample_no] = std::sqrt(dX * dX + dY * dY + dZ * dZ);
+      TotalLength += Length[sample_no];
+    }
+    if(TotalLength == 0.) return;
+    
+    const std::vector<float>* Old[6] = {&fReconstructedX, &fReconstructedY, &fReconstructedZ,
+                                        &fCorrectionX, &fCorrectionY, &fCorrectionZ};
+    std::vector<float> New[6];
+    const unsigned long NewNumberOfSamples = (unsigned long) (TotalLength / Spacing) + 1;
+    for(auto& Values : New) Values.reserve(NewNumberOfSamples);
+    
+    // Walk along the segments, the new sample n sits at arc length n * Spacing
+    unsigned long new_no = 0;
+    double SegmentStart = 0.;
+    for(unsigned long segment_no = 0; segment_no + 1 < NumberOfSamples && new_no < NewNumberOfSamples; segment_no++)
+    {
+      const double SegmentEnd = SegmentStart + Length[segment_no];
+      while(new_no < NewNumberOfSamples && new_no * (double) Spacing <= SegmentEnd)
+      {
+        float Fraction = 0.f;
+        if(Length[segment_no] > 0.f) Fraction = (new_no * (double) Spacing - SegmentStart) / Length[segment_no];
+        for(unsigned int array_no = 0; array_no < 6; array_no++)
+        {
+          const std::vector<float>& Values = *Old[array_no];
+          New[array_no].push_back(Values[segment_no] + Fraction * (Values[segment_no + 1] - Values[segment_no]));
+        }
+        new_no++;
+      }
+      SegmentStart = SegmentEnd;
+    }
+    
+    fReconstructedX.swap(New[0]);
+    fReconstructedY.swap(New[1]);
+    fReconstructedZ.swap(New[2]);
+    fCorrectionX.swap(New[3]);
+    fCorrectionY.swap(New[4]);
+    fCorrectionZ.swap(New[5]);
+  }
+}
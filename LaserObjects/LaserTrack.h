@@ -15,6 +15,7 @@
 #include <utility>
 #include <string>
 #include <iomanip>
+#include <cstddef>
 
 /// Root library
 #include <TH3.h>
@@ -29,16 +30,26 @@
 
 namespace lasercal
 {
+  /// Read-only view of sample coordinates in structure-of-arrays layout, valid until the track is modified
+  struct LaserSampleView
+  {
+    const float* X;
+    const float* Y;
+    const float* Z;
+    unsigned long Size;
+  };
+
   /**
    * @brief Provides a base class for laser analysis purpose
    * 
-   * 
+   * The samples and their corrections are stored as contiguous float arrays per coordinate, so they can be
+   * handed to the map and interpolation code without copies (GetSamples, GetCorrections).
    */
   class LaserTrack : public lasercal::LaserBeam // (could also inherit from recob::track)
   {
     protected:
-      std::vector<TVector3> fReconstructed;
-      std::vector<TVector3> fCorrection;
+      std::vector<float> fReconstructedX, fReconstructedY, fReconstructedZ;
+      std::vector<float> fCorrectionX, fCorrectionY, fCorrectionZ;
   
 
     public:
@@ -79,18 +90,47 @@ namespace lasercal
      */
       void SetDirection(TVector3& LaserDirection);
       
+     /**
+     * @brief Fills the correction of every sample
+     * @param MethodNumber 0: displacement from the reconstructed sample to the closest point of the true beam line
+     */
       void CorrectTrack(unsigned int MethodNumber);
       void AddToCorrection(TVector3&, unsigned long);
   
-      std::array<float,2> GetAngles();
+      std::array<float,2> GetAngles() const;
       unsigned long GetNumberOfSamples() const;
-      TVector3 GetDirection();
+      TVector3 GetDirection() const;
       TVector3 GetSamplePosition(const unsigned int&) const;
       TVector3 GetCorrection(const unsigned int&) const;
       void AppendSample(TVector3&);
       void AppendSample(float,float,float);
       void AppendSample(TVector3&,TVector3&);
       void AppendSample(float,float,float,float,float,float);
+
+     /**
+     * @brief Appends many samples at once
+     * @param X, Y, Z sample coordinates
+     * @param NumberOfSamples number of samples
+     * @param dX, dY, dZ corrections of the samples, zero if not given
+     */
+      void AppendSamples(const float* X, const float* Y, const float* Z, unsigned long NumberOfSamples,
+                         const float* dX = nullptr, const float* dY = nullptr, const float* dZ = nullptr);
+
+      /// Reserves space for the given total number of samples
+      void Reserve(unsigned long NumberOfSamples);
+      void ClearSamples();
+
+      LaserSampleView GetSamples() const;
+      LaserSampleView GetCorrections() const;
+
+     /**
+     * @brief Replaces the samples by samples with uniform spacing along the sample path
+     * @param Spacing arc length between two samples (cm)
+     *
+     * The new samples (and their corrections) are interpolated linearly between the old ones, starting at the
+     * first sample. The last new sample lies less than Spacing before the old last sample.
+     */
+      void Resample(float Spacing);
 //       LaserTrack(std::array<float,2>&, TVector3&, TPCVolumeHandler&);
 //       LaserTrack(const unsigned int,std::array<float,2>&, TVector3&, TPCVolumeHandler&);
 //       void DistortTrack(std::string, TPCVolumeHandler&);  
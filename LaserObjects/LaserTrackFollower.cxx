@@ -0,0 +1,176 @@
+#include "LaserObjects/LaserTrackFollower.h"
+
+
+lasercal::LaserTrackFollower::LaserTrackFollower(const lasercal::LaserRecoParameters &ParameterSet,
+                                                 const lasercal::LaserBeam &LaserBeam)
+        : fParameters(ParameterSet), fLaserBeam(LaserBeam), fHits(ParameterSet), fDecodedWires(0) {
+    fGeometry = &*(art::ServiceHandle<geo::Geometry>());
+    fDetProperties = lar::providerFrom<detinfo::DetectorPropertiesService>();
+
+    // The tick windows already are the region of interest, no need for the box check in the hit finder
+    fParameters.UseROI = false;
+    fHits = lasercal::LaserHits(fParameters);
+} // Constructor
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserTrackFollower::Follow(const std::vector<raw::RawDigit> &RawDigits, bool SubtractPedestal) {
+    fDecodedWires = 0;
+
+    if (RawDigits.empty()) return;
+
+    // Channel to raw digit lookup, so that only the wires along the track have to be touched
+    auto DigitIndex = lasercal::GetDigitIndex(RawDigits);
+
+    // Loop over all planes
+    for (unsigned int plane_no = 0; plane_no < fGeometry->Nplanes(); plane_no++) {
+        FollowPlane(plane_no, RawDigits, DigitIndex, SubtractPedestal);
+    }
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+void lasercal::LaserTrackFollower::FollowPlane(unsigned int Plane, const std::vector<raw::RawDigit> &RawDigits,
+                                               const std::vector<int> &DigitIndex, bool SubtractPedestal) {
+    // Get Service providers
+    const lariov::DetPedestalProvider &PedestalRetrievalAlg = art::ServiceHandle<lariov::DetPedestalService>()->GetPedestalProvider();
+    const lariov::ChannelStatusProvider &ChannelFilter = art::ServiceHandle<lariov::ChannelStatusService>()->GetProvider();
+
+    TVector3 EntryPoint = fLaserBeam.GetEntryPoint();
+    TVector3 ExitPoint = fLaserBeam.GetExitPoint();
+
+    double Entry[] = {EntryPoint[0], EntryPoint[1], EntryPoint[2]};
+    double Exit[] = {ExitPoint[0], ExitPoint[1], ExitPoint[2]};
+
+    // Entry and exit of the straight beam line in wire and tick coordinates
+    auto TargetPlaneID = geo::PlaneID(0, 0, Plane);
+    unsigned int EntryWire = fGeometry->NearestWireID(Entry, TargetPlaneID).Wire;
+    unsigned int ExitWire = fGeometry->NearestWireID(Exit, TargetPlaneID).Wire;
+    float EntryTick = fDetProperties->ConvertXToTicks(EntryPoint[0], Plane, 0, 0);
+    float ExitTick = fDetProperties->ConvertXToTicks(ExitPoint[0], Plane, 0, 0);
+
+    fBeamEntry = std::make_pair(EntryWire, EntryTick);
+    if (ExitWire != EntryWire) {
+        fBeamTickSlope = (ExitTick - EntryTick) / ((float) ExitWire - (float) EntryWire);
+    } else {
+        fBeamTickSlope = 0.;
+    }
+    fTrackPoints.clear();
+
+    // Walk from the entry wire towards the exit wire
+    int Step = (ExitWire >= EntryWire) ? 1 : -1;
+    unsigned int AcceptedWires = 0;
+    unsigned int Misses = 0;
+
+    std::vector<short> RawADC;
+
+    for (int wire_no = EntryWire; wire_no != (int) ExitWire + Step; wire_no += Step) {
+        raw::ChannelID_t Channel = fGeometry->PlaneWireToChannel(Plane, wire_no, 0, 0);
+
+        // Skip wires without data or dead and noisy channels, they do not count as a miss
+        if (Channel >= DigitIndex.size() || DigitIndex.at(Channel) < 0) {
+            continue;
+        }
+        if (ChannelFilter.Status(Channel) < fParameters.MinAllowedChanStatus || !ChannelFilter.IsPresent(Channel)) {
+            continue;
+        }
+
+        // Uncompress this wire only once, widening the window reuses the decoded samples
+        const raw::RawDigit &RawDigit = RawDigits.at(DigitIndex.at(Channel));
+        RawADC.resize(RawDigit.Samples());
+        raw::Uncompress(RawDigit.ADCs(), RawADC, RawDigit.Compression());
+        fDecodedWires++;
+
+        float Pedestal = SubtractPedestal ? PedestalRetrievalAlg.PedMean(Channel) : 0.;
+        float PredictedTick = PredictTick(wire_no);
+
+        // Wide windows until the track is seeded, narrow windows afterwards
+        float HalfWindow = fParameters.FollowerTickWindow;
+        if (AcceptedWires < fParameters.FollowerSeedWires) {
+            HalfWindow = fParameters.FollowerSeedTickWindow;
+        }
+
+        bool Found = false;
+        while (!Found) {
+            auto Wire = lasercal::GetWindowWire(RawDigit, RawADC,
+                                                (int) (PredictedTick - HalfWindow),
+                                                (int) (PredictedTick + HalfWindow) + 1,
+                                                Pedestal);
+            // Only the accepted window is stored, the narrower ones before it were empty
+            auto HitMap = fHits.FindHitsFromWire(Wire);
+
+            if (HitMap.size()) {
+                fHits.AddHitMap(Wire.Channel(), HitMap);
+
+                // The hit closest to the prediction becomes the new track point
+                float ClosestTick = HitMap.begin()->second.PeakTime();
+                for (const auto &Hit : HitMap) {
+                    if (std::abs(Hit.second.PeakTime() - PredictedTick) < std::abs(ClosestTick - PredictedTick)) {
+                        ClosestTick = Hit.second.PeakTime();
+                    }
+                }
+
+                fTrackPoints.push_back(std::make_pair((unsigned int) wire_no, ClosestTick));
+                if (fTrackPoints.size() > fParameters.FollowerFitPoints) {
+                    fTrackPoints.pop_front();
+                }
+                Found = true;
+            } else if (HalfWindow < fParameters.FollowerMaxTickWindow) {
+                // Prediction missed, widen the window and scan the same wire again
+                HalfWindow = std::min(std::max(2 * HalfWindow, 1.f), fParameters.FollowerMaxTickWindow);
+            } else {
+                break;
+            }
+        }
+
+        if (Found) {
+            AcceptedWires++;
+            Misses = 0;
+        } else if (++Misses > fParameters.FollowerMaxMisses) {
+            // Lost the track on this plane
+            break;
+        }
+    } // loop over wires
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+float lasercal::LaserTrackFollower::PredictTick(unsigned int Wire) const {
+    // Without any hit use the straight beam line
+    if (fTrackPoints.empty()) {
+        return fBeamEntry.second + fBeamTickSlope * ((float) Wire - (float) fBeamEntry.first);
+    }
+
+    // With a single hit use the beam slope through this hit
+    const auto &LastPoint = fTrackPoints.back();
+    if (fTrackPoints.size() == 1) {
+        return LastPoint.second + fBeamTickSlope * ((float) Wire - (float) LastPoint.first);
+    }
+
+    // Linear least squares fit through the last hits (wires relative to the last hit for numerical stability)
+    double SumW = 0., SumT = 0., SumWW = 0., SumWT = 0.;
+    for (const auto &Point : fTrackPoints) {
+        double RelWire = (double) Point.first - (double) LastPoint.first;
+        SumW += RelWire;
+        SumT += Point.second;
+        SumWW += RelWire * RelWire;
+        SumWT += RelWire * Point.second;
+    }
+    double N = fTrackPoints.size();
+    double Denominator = N * SumWW - SumW * SumW;
+
+    if (Denominator == 0.) {
+        return LastPoint.second;
+    }
+
+    double Slope = (N * SumWT - SumW * SumT) / Denominator;
+    double Intercept = (SumT - Slope * SumW) / N;
+
+    return Intercept + Slope * ((double) Wire - (double) LastPoint.first);
+}
+
+//-------------------------------------------------------------------------------------------------------------------
+
+std::unique_ptr<std::vector<recob::Hit> > lasercal::LaserTrackFollower::GetPlaneHits(size_t PlaneIndex) {
+    return fHits.GetPlaneHits(PlaneIndex);
+}
@@ -0,0 +1,88 @@
+#ifndef lasercal_LaserTrackFollower_H
+#define lasercal_LaserTrackFollower_H
+
+#include "larcore/SimpleTypesAndConstants/RawTypes.h"
+#include "larcore/SimpleTypesAndConstants/geo_types.h"
+#include "lardata/RawData/RawDigit.h"
+#include "lardata/RecoBase/Hit.h"
+#include "lardata/RecoBase/Wire.h"
+#include "larcore/Geometry/Geometry.h"
+#include "larcore/Geometry/GeometryCore.h"
+
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+
+#include "LaserObjects/LaserHits.h"
+#include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserUtils.h"
+#include "LaserObjects/LaserParameters.h"
+
+#include <cmath>
+#include <utility>
+#include <deque>
+#include <vector>
+#include <memory>
+
+/*
+ *  Track following hit finder. Instead of decoding and scanning every wire inside the straight ROI box around the
+ *  laser beam, it starts at the entry wire of every plane and walks wire by wire towards the exit wire:
+ *
+ *   1. The first FollowerSeedWires wires are scanned in a wide window (FollowerSeedTickWindow) around the time
+ *      tick expected from the straight beam line.
+ *   2. Afterwards the time tick on the next wire is predicted by a linear fit through the last FollowerFitPoints
+ *      hits and only a narrow window (FollowerTickWindow) around the prediction is decoded and scanned.
+ *   3. If there is no hit in the window, the window is doubled until FollowerMaxTickWindow is reached. After
+ *      FollowerMaxMisses consecutive wires without a hit the plane is abandoned.
+ *
+ *  Only the raw digits of the wires along the track are uncompressed, so the work scales with the track length
+ *  times a few ticks instead of the ROI box area.
+ */
+
+namespace lasercal
+{
+  class LaserTrackFollower
+  {
+    public:
+      // Constructor with the hit finder parameters and the laser beam which is used for the seed
+      LaserTrackFollower(const lasercal::LaserRecoParameters& ParameterSet, const lasercal::LaserBeam& LaserBeam);
+
+      // Follows the laser track on all planes and fills the hits
+      void Follow(const std::vector<raw::RawDigit>& RawDigits, bool SubtractPedestal = true);
+
+      // Get all hits of a certain plane
+      std::unique_ptr< std::vector<recob::Hit> > GetPlaneHits(size_t PlaneIndex);
+
+      // Number of wires which were uncompressed and scanned (for diagnostics)
+      unsigned int GetNumberOfDecodedWires() const { return fDecodedWires; }
+
+    private:
+
+      // Follows the track on a single plane
+      void FollowPlane(unsigned int Plane, const std::vector<raw::RawDigit>& RawDigits,
+                       const std::vector<int>& DigitIndex, bool SubtractPedestal);
+
+      // Predicts the time tick of the track on a wire from the last hits (or the beam line if there are none)
+      float PredictTick(unsigned int Wire) const;
+
+      lasercal::LaserRecoParameters fParameters;
+      lasercal::LaserBeam fLaserBeam;
+      lasercal::LaserHits fHits;
+
+      const geo::GeometryCore* fGeometry;
+      detinfo::DetectorProperties const* fDetProperties;
+
+      // Straight beam line in wire/tick coordinates of the current plane
+      float fBeamTickSlope;
+      std::pair<unsigned int, float> fBeamEntry;
+
+      // Last accepted (wire, tick) pairs of the current plane
+      std::deque< std::pair<unsigned int, float> > fTrackPoints;
+
+      unsigned int fDecodedWires;
+
+  }; // class LaserTrackFollower
+
+} // namespace lasercal
+
+#endif // lasercal_LaserTrackFollower_H
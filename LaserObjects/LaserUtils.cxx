@@ -4,6 +4,9 @@
 #include "LaserUtils.h"
 #include "LaserParameters.h"
 
+#include <cmath>
+#include <cstdlib>
+
 std::vector<recob::Wire> lasercal::GetWires(art::ValidHandle<std::vector<raw::RawDigit>> &DigitVecHandle,
                                             lasercal::LaserRecoParameters &fParameterSet,
                                             bool SubstractPedestal) {
@@ -134,4 +137,69 @@ std::vector<std::vector<std::vector<float>>> lasercal::ReadHitDefs(std::string F
         }
     }
     return RawDigitValues;
-}
\ No newline at end of file
+}
+
+std::vector<int> lasercal::GetDigitIndex(const std::vector<raw::RawDigit> &RawDigits) {
+    std::vector<int> DigitIndex;
+
+    // Loop over all raw digits and note their position under the channel number
+    for (unsigned int digit_no = 0; digit_no < RawDigits.size(); digit_no++) {
+        raw::ChannelID_t Channel = RawDigits.at(digit_no).Channel();
+
+        if (Channel >= DigitIndex.size()) {
+            DigitIndex.resize(Channel + 1, -1);
+        }
+        DigitIndex.at(Channel) = digit_no;
+    }
+    return DigitIndex;
+}
+
+recob::Wire lasercal::GetWindowWire(const raw::RawDigit &RawDigit, const std::vector<short> &RawADC,
+                                    int StartTick, int EndTick, float Pedestal) {
+    recob::Wire::RegionsOfInterest_t RegionOfInterest;
+
+    // Keep the window inside the recorded time ticks
+    StartTick = std::max(StartTick, 0);
+    EndTick = std::min(EndTick, (int) RawADC.size());
+
+    if (StartTick < EndTick) {
+        // Copy the window (short) into the signal vector (float) and subtract the pedestal
+        std::vector<float> RawROI(RawADC.begin() + StartTick, RawADC.begin() + EndTick);
+        for (auto &RawSample : RawROI) {
+            RawSample -= Pedestal;
+        }
+        RegionOfInterest.add_range(StartTick, RawROI.begin(), RawROI.end());
+    }
+
+    // The region of interest has to span the full wire length, even if only a window is filled
+    RegionOfInterest.resize(RawADC.size());
+
+    return recob::WireCreator(std::move(RegionOfInterest), RawDigit).move();
+}
+
+lasercal::WindowCharge lasercal::GetWindowCharge(const std::vector<short> &RawADC, int StartTick, int EndTick,
+                                                 float Pedestal, float Threshold) {
+    lasercal::WindowCharge Sums;
+
+    // Keep the window inside the recorded time ticks
+    StartTick = std::max(StartTick, 0);
+    EndTick = std::min(EndTick, (int) RawADC.size());
+
+    // Integer arithmetic without branches, so that the compiler can vectorize the loop
+    const short *ADC = RawADC.data();
+    const int IntPedestal = (int) std::lround(Pedestal);
+    const int IntThreshold = (int) Threshold;
+
+    int Charge = 0;
+    int TimeOverThreshold = 0;
+    for (int tick = StartTick; tick < EndTick; tick++) {
+        int Signal = std::abs((int) ADC[tick] - IntPedestal);
+        int Above = Signal > IntThreshold;
+        Charge += Above * Signal;
+        TimeOverThreshold += Above;
+    }
+
+    Sums.Charge = Charge;
+    Sums.TimeOverThreshold = TimeOverThreshold;
+    return Sums;
+}
@@ -29,6 +29,7 @@
 
 #include <boost/tokenizer.hpp>
 #include <fstream>
+#include <algorithm>
 
 #include "art/Utilities/Exception.h"
 
@@ -51,4 +52,22 @@ namespace lasercal
                                       bool SubstractPedestal=true);
 
     std::vector<std::vector<std::vector<float> > > ReadHitDefs(std::string Filename, bool DEBUG = false);
+
+    // Maps every channel number to its index in the raw digit vector (-1 if the channel has no raw digit)
+    std::vector<int> GetDigitIndex(const std::vector<raw::RawDigit> &RawDigits);
+
+    // Creates a wire which only holds the time tick window [StartTick, EndTick) of an uncompressed raw digit
+    recob::Wire GetWindowWire(const raw::RawDigit &RawDigit, const std::vector<short> &RawADC,
+                              int StartTick, int EndTick, float Pedestal = 0.);
+
+    // Integrated charge and time over threshold of a tick window (absolute pedestal subtracted signal, so
+    // bipolar induction signals count as well)
+    struct WindowCharge {
+        float Charge = 0.;
+        unsigned int TimeOverThreshold = 0;
+    };
+
+    // Sums the samples above threshold in the time tick window [StartTick, EndTick) of an uncompressed raw digit
+    WindowCharge GetWindowCharge(const std::vector<short> &RawADC, int StartTick, int EndTick,
+                                 float Pedestal, float Threshold);
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 //
 
 #include "LaserBeam.h"
+#include "LaserBeamRecord.h"
+#include "LaserBeamTable.h"
 #include "art/Persistency/Common/Wrapper.h"
 //
 // Only include objects that we would like to be able to put into the event.
@@ -17,5 +19,10 @@ namespace {
         lasercal::Time tm;
         lasercal::LaserBeam la;
         art::Wrapper<lasercal::LaserBeam> laser;
+        lasercal::LaserBeamRecord rec;
+        std::vector<lasercal::LaserBeamRecord> recs;
+        art::Wrapper<std::vector<lasercal::LaserBeamRecord> > wrecs;
+        lasercal::LaserBeamTable tab;
+        art::Wrapper<lasercal::LaserBeamTable> wtab;
     };
 }
@@ -21,6 +21,7 @@
 // #include "art/Framework/Core/EDAnalyzer.h"
 #include "art/Framework/Core/EDProducer.h"
 #include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Run.h"
 #include "art/Framework/Principal/Handle.h"
 #include "art/Framework/Services/Registry/ServiceHandle.h"
 #include "art/Framework/Services/Optional/TFileService.h"
@@ -65,7 +66,10 @@
 // Laser Module Classes
 #include "LaserObjects/LaserHits.h"
 #include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserBeamTable.h"
 #include "LaserObjects/LaserParameters.h"
+#include "LaserObjects/LaserTrackFollower.h"
+#include "LaserObjects/LaserUtils.h"
 
 namespace {
 
@@ -83,6 +87,8 @@ namespace LaserReco {
 
         virtual void beginJob() override;
 
+        virtual void beginRun(art::Run &run) override;
+
         virtual void endJob() override;
 
         virtual void reconfigure(fhicl::ParameterSet const &parameterSet) override;
@@ -95,6 +101,13 @@ namespace LaserReco {
 
         void CutRegionOfInterest();
 
+        // Stores the hits of this event as center line for the next shot at the same mirror position
+        void UpdateCenterLines(const lasercal::LaserBeam &LaserBeam,
+                               const std::vector<const std::vector<recob::Hit> *> &PlaneHits);
+
+        // Decodes only the wires and tick windows of the center line ROI and runs the hit finder on them
+        std::unique_ptr<lasercal::LaserHits> CenterLineHits(const std::vector<raw::RawDigit> &RawDigits);
+
     private:
 
         // The parameters we'll read from the .fcl file.
@@ -113,6 +126,20 @@ namespace LaserReco {
 
         bool fPedestalStubtract;
 
+        // Center line ROI built from the hits of the previous shot at the same mirror position
+        bool fUseCenterLineROI;
+        float fCenterLineTickWindow;
+        unsigned int fCenterLineWirePadding;
+        int fCenterLineDecodePadding;
+        float fCenterLineMaxAngle;
+
+        unsigned int fCenterLineLaserID = 0;
+        TVector3 fCenterLineDirection;
+        std::vector<std::map<unsigned int, float> > fCenterLines;
+
+        // Laser beams of the current run (only filled if read from the run-level table)
+        lasercal::LaserBeamTable fLaserBeamTable;
+
     }; // class LaserReco
 
     DEFINE_ART_MODULE(LaserReco)
@@ -161,6 +188,14 @@ namespace LaserReco {
     }
 
 
+    void LaserReco::beginRun(art::Run &run) {
+        // Fetch all laser beams of this run at once
+        if (fParameterSet.LaserBeamFromRun) {
+            fLaserBeamTable = *run.getValidHandle<lasercal::LaserBeamTable>(fParameterSet.GetLaserBeamTableTag());
+        }
+    }
+
+
     void LaserReco::endJob() {
 
     }
@@ -172,17 +207,34 @@ namespace LaserReco {
 
         fPedestalStubtract = parameterSet.get<bool> ("PedestalSubtract", true);
 
+        // Center line ROI from the previous shot at the same mirror position
+        fUseCenterLineROI = parameterSet.get<bool>("CenterLineROI", false);
+        fCenterLineTickWindow = parameterSet.get<float>("CenterLineTickWindow", 30.);
+        fCenterLineWirePadding = parameterSet.get<unsigned int>("CenterLineWirePadding", 10);
+        fCenterLineDecodePadding = parameterSet.get<int>("CenterLineDecodePadding", 20);
+        fCenterLineMaxAngle = parameterSet.get<float>("CenterLineMaxAngle", 1e-4);
+
         // Switches
         fParameterSet.WireMapGenerator = parameterSet.get<bool>("GenerateWireMap");
         fParameterSet.UseROI = parameterSet.get<bool>("GenerateWireMap");
         fParameterSet.HitBoxSize = parameterSet.get<float>("HitBoxSize");
 
+        // Track following hit finder (only decodes the wires along the laser track)
+        fParameterSet.UseTrackFollower = parameterSet.get<bool>("TrackFollowing", false);
+        fParameterSet.FollowerSeedWires = parameterSet.get<unsigned int>("FollowerSeedWires", 5);
+        fParameterSet.FollowerSeedTickWindow = parameterSet.get<float>("FollowerSeedTickWindow", 100.);
+        fParameterSet.FollowerTickWindow = parameterSet.get<float>("FollowerTickWindow", 15.);
+        fParameterSet.FollowerMaxTickWindow = parameterSet.get<float>("FollowerMaxTickWindow", 120.);
+        fParameterSet.FollowerFitPoints = parameterSet.get<unsigned int>("FollowerFitPoints", 10);
+        fParameterSet.FollowerMaxMisses = parameterSet.get<unsigned int>("FollowerMaxMisses", 20);
+
         // Tag for reading raw digit data
         fParameterSet.RawDigitTag = parameterSet.get<art::InputTag>("LaserRecoModuleLabel");
 
         // Label for Laser beam data
         fParameterSet.LaserDataMergerModuleLabel = parameterSet.get<std::string>("LaserDataMergerModuleLabel");
         fParameterSet.LaserBeamInstanceLabel = parameterSet.get<std::string>("LaserBeamInstanceLabel");
+        fParameterSet.LaserBeamFromRun = parameterSet.get<bool>("LaserBeamFromRun", false);
 
         // Wire status tag
         fParameterSet.MinAllowedChanStatus = parameterSet.get<int>("MinAllowedChannelStatus");
@@ -215,8 +267,13 @@ namespace LaserReco {
         art::ValidHandle<std::vector<raw::RawDigit> > DigitVecHandle = event.getValidHandle<std::vector<raw::RawDigit>>(
                 fParameterSet.RawDigitTag);
 
-        art::ValidHandle<lasercal::LaserBeam> LaserBeamHandle = event.getValidHandle<lasercal::LaserBeam>(
-                fParameterSet.GetLaserBeamTag());
+        // Laser beam of this event, either from the run-level table or from the event itself
+        lasercal::LaserBeam LaserBeam;
+        if (fParameterSet.LaserBeamFromRun) {
+            LaserBeam = fLaserBeamTable.GetBeam(event.id().event());
+        } else {
+            LaserBeam = *event.getValidHandle<lasercal::LaserBeam>(fParameterSet.GetLaserBeamTag());
+        }
 
 //     LaserBeamHandle->GetEntryPoint().Print();
 //     LaserBeamHandle->GetExitPoint().Print();
@@ -232,6 +289,37 @@ namespace LaserReco {
         std::unique_ptr<std::vector<recob::Hit> > VHitVec(new std::vector<recob::Hit>);
         std::unique_ptr<std::vector<recob::Hit> > YHitVec(new std::vector<recob::Hit>);
 
+        // Follow the track wire by wire instead of decoding the whole event
+        if (fParameterSet.UseTrackFollower) {
+            lasercal::LaserTrackFollower Follower(fParameterSet, LaserBeam);
+            Follower.Follow(*DigitVecHandle, fPedestalStubtract);
+
+            mf::LogDebug("LaserReco") << "Track follower decoded " << Follower.GetNumberOfDecodedWires()
+                                      << " of " << DigitVecHandle->size() << " wires";
+
+            event.put(Follower.GetPlaneHits(0), "UPlaneLaserHits");
+            event.put(Follower.GetPlaneHits(1), "VPlaneLaserHits");
+            event.put(Follower.GetPlaneHits(2), "YPlaneLaserHits");
+            return;
+        }
+
+        // Use the track of the previous shot at this mirror position as center line of a tight ROI, only the
+        // wires and ticks inside this ROI are decoded
+        if (fUseCenterLineROI && !fCenterLines.empty()
+            && LaserBeam.GetLaserID() == fCenterLineLaserID
+            && LaserBeam.GetLaserDirection().Angle(fCenterLineDirection) < fCenterLineMaxAngle) {
+            auto Hits = CenterLineHits(*DigitVecHandle);
+            UHitVec = Hits->GetPlaneHits(0);
+            VHitVec = Hits->GetPlaneHits(1);
+            YHitVec = Hits->GetPlaneHits(2);
+            UpdateCenterLines(LaserBeam, {UHitVec.get(), VHitVec.get(), YHitVec.get()});
+
+            event.put(std::move(UHitVec), "UPlaneLaserHits");
+            event.put(std::move(VHitVec), "VPlaneLaserHits");
+            event.put(std::move(YHitVec), "YPlaneLaserHits");
+            return;
+        }
+
         // Preparing WireID vector
         std::vector<geo::WireID> WireIDs;
 
@@ -339,15 +427,19 @@ namespace LaserReco {
         } // end loop over raw digit entries
 
         // Create Laser Hits out of Wires
-        lasercal::LaserHits AllLaserHits(WireVec, fParameterSet, *LaserBeamHandle);
+        std::unique_ptr<lasercal::LaserHits> AllLaserHits(new lasercal::LaserHits(WireVec, fParameterSet, LaserBeam));
 
         // Filter for time matches of at least two planes
-//     AllLaserHits.TimeMatchFilter();
+//     AllLaserHits->TimeMatchFilter();
 
         // Fill plane specific hit vectors
-        UHitVec = AllLaserHits.GetPlaneHits(0);
-        VHitVec = AllLaserHits.GetPlaneHits(1);
-        YHitVec = AllLaserHits.GetPlaneHits(2);
+        UHitVec = AllLaserHits->GetPlaneHits(0);
+        VHitVec = AllLaserHits->GetPlaneHits(1);
+        YHitVec = AllLaserHits->GetPlaneHits(2);
+
+        if (fUseCenterLineROI) {
+            UpdateCenterLines(LaserBeam, {UHitVec.get(), VHitVec.get(), YHitVec.get()});
+        }
 
 //     std::cout << fDetProperties->ConvertXToTicks(100,2,0,0) << std::endl;
 
@@ -361,6 +453,90 @@ namespace LaserReco {
         event.put(std::move(YHitVec), "YPlaneLaserHits");
     } // LaserReco::analyze()
 
+    std::unique_ptr<lasercal::LaserHits> LaserReco::CenterLineHits(const std::vector<raw::RawDigit> &RawDigits) {
+        const lariov::DetPedestalProvider &PedestalRetrievalAlg = art::ServiceHandle<lariov::DetPedestalService>()->GetPedestalProvider();
+        const lariov::ChannelStatusProvider &ChannelFilter = art::ServiceHandle<lariov::ChannelStatusService>()->GetProvider();
+
+        lasercal::LaserROI CenterLineROI;
+        for (unsigned int plane_no = 0; plane_no < fCenterLines.size(); plane_no++) {
+            CenterLineROI.SetCenterLine(plane_no, fCenterLines.at(plane_no), fCenterLineTickWindow,
+                                        fCenterLineWirePadding);
+        }
+
+        // The ROI still decides which hits count, the decoded window only limits the scanned ticks
+        lasercal::LaserRecoParameters CenterLineParameters = fParameterSet;
+        CenterLineParameters.UseROI = true;
+        std::vector<recob::Wire> NoWires;
+        std::unique_ptr<lasercal::LaserHits> Hits(new lasercal::LaserHits(NoWires, CenterLineParameters, CenterLineROI));
+
+        std::vector<int> DigitIndex = lasercal::GetDigitIndex(RawDigits);
+        std::vector<short> RawADC;
+        unsigned int DecodedWires = 0;
+
+        auto Ranges = CenterLineROI.GetRanges();
+        for (unsigned int plane_no = 0; plane_no < Ranges.size(); plane_no++) {
+            for (const auto &WireRange : Ranges.at(plane_no)) {
+                raw::ChannelID_t Channel = fGeometry->PlaneWireToChannel(plane_no, WireRange.first, 0, 0);
+
+                // Skip wires without data and dead or noisy channels
+                if (Channel >= DigitIndex.size() || DigitIndex.at(Channel) < 0) continue;
+                if (ChannelFilter.Status(Channel) < fParameterSet.MinAllowedChanStatus
+                    || !ChannelFilter.IsPresent(Channel)) {
+                    continue;
+                }
+
+                const raw::RawDigit &RawDigit = RawDigits.at(DigitIndex.at(Channel));
+                RawADC.resize(RawDigit.Samples());
+                raw::Uncompress(RawDigit.ADCs(), RawADC, RawDigit.Compression());
+                DecodedWires++;
+
+                // Hits can reach over the box border, so a few more ticks are decoded on both sides
+                float Pedestal = fPedestalStubtract ? PedestalRetrievalAlg.PedMean(Channel) : 0.;
+                int StartTick = (int) std::floor(WireRange.second.first) - fCenterLineDecodePadding;
+                int EndTick = (int) std::ceil(WireRange.second.second) + fCenterLineDecodePadding + 1;
+                Hits->AddHitsFromWire(lasercal::GetWindowWire(RawDigit, RawADC, StartTick, EndTick, Pedestal));
+            }
+        }
+
+        mf::LogDebug("LaserReco") << "Center line ROI decoded " << DecodedWires << " of " << RawDigits.size()
+                                  << " wires";
+        return Hits;
+    }
+
+    void LaserReco::UpdateCenterLines(const lasercal::LaserBeam &LaserBeam,
+                                      const std::vector<const std::vector<recob::Hit> *> &PlaneHits) {
+        fCenterLineLaserID = LaserBeam.GetLaserID();
+        fCenterLineDirection = LaserBeam.GetLaserDirection();
+
+        fCenterLines.clear();
+        fCenterLines.resize(PlaneHits.size());
+
+        // Loop over planes
+        for (unsigned int plane_no = 0; plane_no < PlaneHits.size(); plane_no++) {
+            // Largest hit on every wire
+            std::map<unsigned int, float> PeakAmplitudes;
+
+            for (const auto &Hit : *PlaneHits.at(plane_no)) {
+                unsigned int WireNo = Hit.WireID().Wire;
+                float Amplitude = std::abs(Hit.PeakAmplitude());
+
+                auto Peak = PeakAmplitudes.find(WireNo);
+                if (Peak == PeakAmplitudes.end() || Peak->second < Amplitude) {
+                    PeakAmplitudes[WireNo] = Amplitude;
+                    fCenterLines.at(plane_no)[WireNo] = Hit.PeakTime();
+                }
+            }
+        }
+
+        // Without hits on all planes there is no usable center line
+        for (const auto &CenterLine : fCenterLines) {
+            if (CenterLine.empty()) {
+                fCenterLines.clear();
+                break;
+            }
+        }
+    }
+
     // Gives out a vector of WireIDs which cross a certain input wire
     std::vector<std::pair<geo::WireID, geo::WireID> > LaserReco::CrossingWireRanges(geo::WireID WireID) {
         // Initialize the return pair vector
@@ -6,34 +6,77 @@
 #include "art/Framework/Core/ModuleMacros.h"
 #include "art/Framework/Core/EDFilter.h"
 #include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Run.h"
+#include "art/Framework/Principal/SubRun.h"
 
 #include "lardata/RawData/RawDigit.h"
+#include "lardata/RawData/raw.h"
 #include "lardata/RecoBase/Hit.h"
 #include "lardata/RecoBase/Wire.h"
 
 #include "larevt/CalibrationDBI/Interface/DetPedestalService.h"
 #include "larevt/CalibrationDBI/Interface/DetPedestalProvider.h"
 #include "larevt/CalibrationDBI/Interface/ChannelStatusService.h"
+#include "larevt/CalibrationDBI/Interface/ChannelStatusProvider.h"
+
+#include "larcore/Geometry/Geometry.h"
+#include "larcore/Geometry/GeometryCore.h"
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include "art/Framework/Services/Optional/TFileService.h"
+
+#include "TTree.h"
 
 // Laser Module Classes
 #include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserBeamTable.h"
 #include "LaserObjects/LaserHits.h"
 #include "LaserObjects/LaserUtils.h"
 #include "LaserObjects/LaserParameters.h"
 #include "LaserObjects/LaserROI.h"
+#include "LaserObjects/LaserSpotterIndex.h"
 
 
 #include <vector>
+#include <string>
+#include <map>
 
 /*
  *  This filter module acts on merged laser data (laser data merged into swizzled raw files). It looks for tracks in
- *  a predefined area on the collection plane (presumably just in front of the entry point of the laser) using the laser
+ *  a list of predefined boxes (presumably just in front of the entry point of the laser) using the laser
  *  track finder.
  *
- *  Input parameters from fhicl file (two entries expected for the two laser systems):
- *   EntryTicks  - Center Time Tick of the window where we are going to look for the laser
+ *  Boxes - List of boxes, all evaluated on the same raw digits (every channel is decoded at most once per event):
+ *   Plane        - Plane number (0 = U, 1 = V, 2 = Y)
+ *   Wires        - First and last wire of the box
+ *   CenterTick   - Center Time Tick of the window where we are going to look for the laser
+ *   TickWidth    - Total Width of the tick window
+ *   MinHits      - Minimal number of wires with hits in this box (default: MinHits)
+ *   MinTotalCharge - Minimal charge sum in this box in ChargeSum mode (default: MinTotalCharge)
+ *   LaserID      - Only evaluate the box for this laser system (default 0: for all events)
+ *  BoxLogic - "AND" (all boxes of the event have to pass, default) or "OR" (one box is enough). The boxes are
+ *             evaluated in the given order and the evaluation stops as soon as the decision is made.
+ *
+ *  Without Boxes the legacy parameters give one collection plane box per laser system (first entry for LCS 1):
+ *   CenterTicks - Center Time Tick of the window where we are going to look for the laser
  *   TickWidths  - Total Width of the tick window
- *   WireWidths  - Number of wires to extend the search into the TPC from the border
+ *   WireBoxes   - First and last wire of the box
+ *
+ *  With DecodeBoxOnly (default) only the channels of the wire box are uncompressed, and only a window around the
+ *  box ticks (padded by WindowPadding) is handed to the hit finder. The wires are scanned in order and the scan
+ *  stops as soon as MinHits wires with hits are found, so rejected and accepted events both cost only a small part
+ *  of a full decode.
+ *
+ *  DecisionMode "ChargeSum" skips the hit finding: for each box wire the pedestal subtracted ADC above
+ *  ChargeThreshold is summed over the box ticks together with the number of ticks above threshold. A wire counts if
+ *  it has at least MinTimeOverThreshold ticks and MinWireCharge ADC, and the event passes with MinHits counted wires
+ *  and MinTotalCharge ADC summed over them. With WriteSummary the decision and the sums are written to a tree.
+ *
+ *  With WriteIndex the decision and multiplicity of every event are written at the end of each subrun to
+ *  IndexDirectory/SpotterIndex-<run>-<subrun>.dat (merged with the file if it exists). Later passes can put the
+ *  SpotterIndexFilter in front of their path, which rejects the events from the index without reading any of their
+ *  products.
  *
  *  Internal functionallity (just for code planning):
  *   1. Get all wires
@@ -59,17 +102,72 @@ namespace LaserSpotter {
 
         void beginJob();
 
+        bool beginRun(art::Run &run);
+
+        bool endSubRun(art::SubRun &subrun);
+
         void endJob();
 
         void reconfigure(fhicl::ParameterSet const &p);
 
     private:
         lasercal::LaserRecoParameters fParameterSet; ///< ficl parameter structure
-        std::vector<int> fCenterTicks, fTickWidths;
-        std::vector< std::pair < unsigned int, unsigned int> >fWireBoxes;
+        /// One search box of the spotter
+        struct SpotterBox {
+            unsigned int Plane;
+            std::pair<unsigned int, unsigned int> Wires;
+            int CenterTick;
+            int TickWidth;
+            unsigned int MinHits;
+            float MinTotalCharge;
+            unsigned int LaserID;       ///< 0: evaluated for all events
+        };
+
+        /// Result of one box: wires with hits (or counted wires in ChargeSum mode) and the charge sums
+        struct BoxResult {
+            bool Pass = false;
+            unsigned int Wires = 0;
+            float Charge = 0.;
+            unsigned int TimeOverThreshold = 0;
+        };
+
+        std::vector<SpotterBox> fBoxes;
+        bool fRequireAllBoxes;      ///< AND (true) or OR (false) of the box decisions
+        bool fNeedLaserID;          ///< At least one box is only evaluated for one laser system
 
         unsigned int fMinHits;
         bool fPedestalStubtract;
+
+        bool fDecodeBoxOnly;        ///< Decode only the box channels and stop at MinHits
+        int fWindowPadding;         ///< Ticks decoded before and after the box window (hits at the box border)
+
+        bool fChargeSum;            ///< Decide on charge and time over threshold sums instead of hits
+        float fChargeThreshold;     ///< ADC above pedestal counted as signal
+        unsigned int fMinTimeOverThreshold; ///< Minimal ticks above threshold for a wire to count
+        float fMinWireCharge;       ///< Minimal summed ADC for a wire to count
+        float fMinTotalCharge;      ///< Minimal summed ADC of all counted wires
+
+        bool fWriteSummary;
+        TTree *fSummaryTree = nullptr;
+        unsigned int fSummaryRun, fSummaryEvent, fSummaryPass, fSummaryWires, fSummaryTimeOverThreshold;
+        float fSummaryCharge;
+
+        // Evaluates one box, decoding only the box channels that are not yet in the ADC cache
+        BoxResult EvaluateBox(const SpotterBox &Box, const std::vector<raw::RawDigit> &RawDigits,
+                              const std::vector<int> &DigitIndex,
+                              std::map<raw::ChannelID_t, std::vector<short> > &ADCCache);
+
+        // Evaluates one box on fully decoded wires (DecodeBoxOnly: false)
+        BoxResult EvaluateBox(const SpotterBox &Box, const std::vector<recob::Wire> &Wires);
+
+        // Adds the decision to the spotter index (if enabled) and returns it
+        bool Decide(const art::Event &evt, bool Pass, unsigned int Multiplicity);
+
+        lasercal::LaserBeamTable fLaserBeamTable; ///< Laser beams of the current run (if read from the run)
+
+        bool fWriteIndex;                       ///< Write the decisions of each run to a spotter index
+        std::string fIndexDirectory;
+        lasercal::LaserSpotterIndex fSpotterIndex;
     protected:
     };
 
@@ -92,10 +190,73 @@ namespace LaserSpotter {
         fPedestalStubtract = pset.get<bool> ("PedestalSubtract", true);
 
         // --------------------------------------------- Spotter Parameters ---------------------------------------------- //
-        fCenterTicks =  pset_box.get<std::vector<int> >("CenterTicks");
-        fTickWidths =   pset_box.get<std::vector<int> >("TickWidths");
-        fWireBoxes  =   pset_box.get<std::vector<std::pair<unsigned int, unsigned int>>>("WireBoxes");
         fMinHits =      pset_box.get<int> ("MinHits");
+        fDecodeBoxOnly = pset_box.get<bool> ("DecodeBoxOnly", true);
+        fWindowPadding = pset_box.get<int> ("WindowPadding", 50);
+
+        std::string DecisionMode = pset_box.get<std::string> ("DecisionMode", "Hits");
+        if (DecisionMode != "Hits" && DecisionMode != "ChargeSum") {
+            throw art::Exception(art::errors::Configuration) << "LaserSpotter: unknown DecisionMode \""
+                                                             << DecisionMode << "\" (Hits or ChargeSum)\n";
+        }
+        fChargeSum = (DecisionMode == "ChargeSum");
+        fChargeThreshold = pset_box.get<float> ("ChargeThreshold", 10.);
+        fMinTimeOverThreshold = pset_box.get<unsigned int> ("MinTimeOverThreshold", 3);
+        fMinWireCharge = pset_box.get<float> ("MinWireCharge", 0.);
+        fMinTotalCharge = pset_box.get<float> ("MinTotalCharge", 0.);
+        fWriteSummary = pset_box.get<bool> ("WriteSummary", false);
+
+        std::string BoxLogic = pset_box.get<std::string> ("BoxLogic", "AND");
+        if (BoxLogic != "AND" && BoxLogic != "OR") {
+            throw art::Exception(art::errors::Configuration) << "LaserSpotter: unknown BoxLogic \""
+                                                             << BoxLogic << "\" (AND or OR)\n";
+        }
+        fRequireAllBoxes = (BoxLogic == "AND");
+
+        fBoxes.clear();
+        if (pset_box.has_key("Boxes")) {
+            for (const auto &pset_single_box : pset_box.get<std::vector<fhicl::ParameterSet> >("Boxes")) {
+                SpotterBox Box;
+                Box.Plane = pset_single_box.get<unsigned int>("Plane");
+                Box.Wires = pset_single_box.get<std::pair<unsigned int, unsigned int> >("Wires");
+                Box.CenterTick = pset_single_box.get<int>("CenterTick");
+                Box.TickWidth = pset_single_box.get<int>("TickWidth");
+                Box.MinHits = pset_single_box.get<unsigned int>("MinHits", fMinHits);
+                Box.MinTotalCharge = pset_single_box.get<float>("MinTotalCharge", fMinTotalCharge);
+                Box.LaserID = pset_single_box.get<unsigned int>("LaserID", 0);
+                fBoxes.push_back(Box);
+            }
+        } else {
+            // Legacy definition: one collection plane box per laser system
+            auto CenterTicks = pset_box.get<std::vector<int> >("CenterTicks");
+            auto TickWidths = pset_box.get<std::vector<int> >("TickWidths");
+            auto WireBoxes = pset_box.get<std::vector<std::pair<unsigned int, unsigned int>>>("WireBoxes");
+            if (TickWidths.size() != CenterTicks.size() || WireBoxes.size() != CenterTicks.size()) {
+                throw art::Exception(art::errors::Configuration)
+                        << "LaserSpotter: CenterTicks, TickWidths and WireBoxes need one entry per laser system\n";
+            }
+            for (unsigned int laser_no = 0; laser_no < CenterTicks.size(); laser_no++) {
+                SpotterBox Box;
+                Box.Plane = 2;
+                Box.Wires = WireBoxes.at(laser_no);
+                Box.CenterTick = CenterTicks.at(laser_no);
+                Box.TickWidth = TickWidths.at(laser_no);
+                Box.MinHits = fMinHits;
+                Box.MinTotalCharge = fMinTotalCharge;
+                Box.LaserID = laser_no + 1;
+                fBoxes.push_back(Box);
+            }
+        }
+
+        fNeedLaserID = false;
+        for (const auto &Box : fBoxes) {
+            if (Box.Plane > 2 || Box.Wires.first > Box.Wires.second || Box.TickWidth <= 0) {
+                throw art::Exception(art::errors::Configuration) << "LaserSpotter: invalid box on plane " << Box.Plane
+                                                                 << ", wires [" << Box.Wires.first << ", "
+                                                                 << Box.Wires.second << "]\n";
+            }
+            if (Box.LaserID != 0) fNeedLaserID = true;
+        }
 
 
         // --------------------------------------------- File Handling Parameters --------------------------------------- //
@@ -104,6 +265,9 @@ namespace LaserSpotter {
         // Label for Laser beam data
         fParameterSet.LaserDataMergerModuleLabel =  pset_io.get<std::string>("LaserDataMergerModuleLabel");
         fParameterSet.LaserBeamInstanceLabel =      pset_io.get<std::string>("LaserBeamInstanceLabel");
+        fParameterSet.LaserBeamFromRun =            pset_io.get<bool>("LaserBeamFromRun", false);
+        fWriteIndex =                               pset_io.get<bool>("WriteIndex", false);
+        fIndexDirectory =                           pset_io.get<std::string>("IndexDirectory", "");
 
         // --------------------------------------------- Hit Finder Parameters ------------------------------------------ //
         fParameterSet.WireMapGenerator =    pset_hitfinder.get<bool>("GenerateWireMap");
@@ -136,64 +300,205 @@ namespace LaserSpotter {
     }
 
     void LaserSpotter::beginJob() {
+        if (fWriteSummary) {
+            art::ServiceHandle<art::TFileService> tfs;
+            fSummaryTree = tfs->make<TTree>("SpotterSummary", "SpotterSummary");
+            fSummaryTree->Branch("run", &fSummaryRun);
+            fSummaryTree->Branch("event", &fSummaryEvent);
+            fSummaryTree->Branch("pass", &fSummaryPass);
+            fSummaryTree->Branch("wires", &fSummaryWires);
+            fSummaryTree->Branch("charge", &fSummaryCharge);
+            fSummaryTree->Branch("tot", &fSummaryTimeOverThreshold);
+        }
+    }
+
+    bool LaserSpotter::beginRun(art::Run &run) {
+        if (fParameterSet.LaserBeamFromRun) {
+            fLaserBeamTable = *run.getValidHandle<lasercal::LaserBeamTable>(fParameterSet.GetLaserBeamTableTag());
+        }
+        fSpotterIndex.clear();
+        return true;
+    }
+
+    bool LaserSpotter::endSubRun(art::SubRun &subrun) {
+        if (fWriteIndex) {
+            std::string IndexFile = lasercal::LaserSpotterIndex::FileName(fIndexDirectory, subrun.run(),
+                                                                          subrun.subRun());
+            size_t Passed = fSpotterIndex.NumberOfPassed(), Events = fSpotterIndex.size();
+            fSpotterIndex.Write(IndexFile);
+            mf::LogInfo("LaserSpotter") << "Wrote " << IndexFile << ": " << Passed << " of " << Events
+                                        << " events passed";
+            fSpotterIndex.clear();
+        }
+        return true;
     }
 
     void LaserSpotter::endJob() {
     }
 
+    bool LaserSpotter::Decide(const art::Event &evt, bool Pass, unsigned int Multiplicity) {
+        if (fWriteIndex) {
+            fSpotterIndex.Add(evt.run(), evt.subRun(), evt.id().event(), Pass, Multiplicity);
+        }
+        return Pass;
+    }
+
     bool LaserSpotter::filter(art::Event &evt) {
 
 
         // Get the necessary products
         art::ValidHandle <std::vector<raw::RawDigit>> DigitVecHandle = evt.getValidHandle<std::vector<raw::RawDigit>>(fParameterSet.RawDigitTag);
-        art::ValidHandle <lasercal::LaserBeam> LaserBeamHandle = evt.getValidHandle<lasercal::LaserBeam>(fParameterSet.GetLaserBeamTag());
 
         //TODO: Implement adjustements of box due to drift field
 
-        // load appropriate windows according to laser
-        int CenterTick = -9999;
-        int TickWidth = -9999;
-
         fParameterSet.UseROI = true;
-        std::pair<unsigned int, unsigned int> WireRange;
 
-        auto laserid = LaserBeamHandle->GetLaserID();
-        int Plane = 2;
-        if (0 < laserid < 2) {
-            CenterTick = fCenterTicks.at(laserid - 1);
-            TickWidth = fTickWidths.at(laserid - 1);
-            WireRange.first = fWireBoxes.at(laserid-1).first;
-            WireRange.second = fWireBoxes.at(laserid-1).second;
+        // The laser system only matters if some boxes belong to one of them
+        unsigned int laserid = 0;
+        if (fNeedLaserID) {
+            if (fParameterSet.LaserBeamFromRun) {
+                // Events without laser data in the table only get the boxes of both systems
+                if (fLaserBeamTable.HasBeam(evt.id().event())) {
+                    laserid = fLaserBeamTable.GetRecord(evt.id().event()).LaserID;
+                } else {
+                    mf::LogWarning("LaserSpotter") << "No laser beam in the table for event " << evt.id()
+                                                   << ", using laser ID 0";
+                }
+            } else {
+                laserid = evt.getValidHandle<lasercal::LaserBeam>(fParameterSet.GetLaserBeamTag())->GetLaserID();
+            }
+        }
+
+        // Boxes to check in this event
+        std::vector<const SpotterBox *> Boxes;
+        for (const auto &Box : fBoxes) {
+            if (Box.LaserID == 0 || Box.LaserID == laserid) Boxes.push_back(&Box);
+        }
+        if (Boxes.empty()) {
+            mf::LogWarning("LaserSpotter") << "Laser ID " << laserid << " of event " << evt.id()
+                                           << " not recognized, no box to check";
+            return Decide(evt, false, 0);
+        }
 
-            //std::cout << "Box Definitions for LCS" << laserid << std::endl;;
-            //std::cout << "Wires range: [" << WireRange.first << ", " << WireRange.second << "]" << std::endl;
-            //std::cout << "Tick range:  [" << CenterTick - TickWidth/2 << ", " << CenterTick + TickWidth/2 << "]" << std::endl;
+        // Full decode only once for all boxes (if requested)
+        std::vector<recob::Wire> Wires;
+        if (!fDecodeBoxOnly && !fChargeSum) {
+            Wires = lasercal::GetWires(DigitVecHandle, fParameterSet, fPedestalStubtract);
+        }
 
-        } else {
-            // TODO: Emmit proper error message within the art framework
-            std::cout << "laser ID not recoginized" << std::endl;
-            exit(-1);
+        // Channel to raw digit lookup and the decoded channels, shared by all boxes
+        std::vector<int> DigitIndex;
+        std::map<raw::ChannelID_t, std::vector<short> > ADCCache;
+        if (fDecodeBoxOnly || fChargeSum) DigitIndex = lasercal::GetDigitIndex(*DigitVecHandle);
+
+        BoxResult Total;
+        bool Pass = fRequireAllBoxes;
+        for (const SpotterBox *Box : Boxes) {
+            BoxResult Result = (fDecodeBoxOnly || fChargeSum) ?
+                               EvaluateBox(*Box, *DigitVecHandle, DigitIndex, ADCCache) : EvaluateBox(*Box, Wires);
+
+            mf::LogDebug("LaserSpotter") << "Box on plane " << Box->Plane << ", wires [" << Box->Wires.first << ", "
+                                         << Box->Wires.second << "]: " << Result.Wires << " wires, "
+                                         << Result.Charge << " ADC" << (Result.Pass ? " (pass)" : "");
+
+            Total.Wires += Result.Wires;
+            Total.Charge += Result.Charge;
+            Total.TimeOverThreshold += Result.TimeOverThreshold;
+
+            // Stop at the first box that decides the event, unless summary or index need the wires of all boxes
+            if (fRequireAllBoxes && !Result.Pass) {
+                Pass = false;
+                if (!fSummaryTree && !fWriteIndex) break;
+            }
+            if (!fRequireAllBoxes && Result.Pass) {
+                Pass = true;
+                if (!fSummaryTree && !fWriteIndex) break;
+            }
         }
 
-        auto wires = lasercal::GetWires(DigitVecHandle, fParameterSet, fPedestalStubtract);
+        if (fSummaryTree) {
+            fSummaryRun = evt.run();
+            fSummaryEvent = evt.id().event();
+            fSummaryPass = Pass;
+            fSummaryWires = Total.Wires;
+            fSummaryCharge = Total.Charge;
+            fSummaryTimeOverThreshold = Total.TimeOverThreshold;
+            fSummaryTree->Fill();
+        }
+        return Decide(evt, Pass, Total.Wires);
+    }
 
-        auto laser_roi = lasercal::LaserROI();
-        laser_roi.setRanges(CenterTick, TickWidth, Plane, WireRange);
+    LaserSpotter::BoxResult LaserSpotter::EvaluateBox(const SpotterBox &Box,
+                                                      const std::vector<raw::RawDigit> &RawDigits,
+                                                      const std::vector<int> &DigitIndex,
+                                                      std::map<raw::ChannelID_t, std::vector<short> > &ADCCache) {
+        const geo::GeometryCore *Geometry = &*(art::ServiceHandle<geo::Geometry>());
+        const lariov::DetPedestalProvider &PedestalRetrievalAlg = art::ServiceHandle<lariov::DetPedestalService>()->GetPedestalProvider();
+        const lariov::ChannelStatusProvider &ChannelFilter = art::ServiceHandle<lariov::ChannelStatusService>()->GetProvider();
+
+        BoxResult Result;
+
+        // The ROI still decides which hits count, the window only limits the decoded ticks
+        auto LaserROI = lasercal::LaserROI();
+        LaserROI.setRanges(Box.CenterTick, Box.TickWidth, Box.Plane, Box.Wires);
+        std::vector<recob::Wire> NoWires;
+        lasercal::LaserHits Hits(NoWires, fParameterSet, LaserROI);
+
+        // Hits can reach over the box border, the charge sum only looks at the box ticks
+        int Padding = fChargeSum ? 0 : fWindowPadding;
+        int StartTick = Box.CenterTick - Box.TickWidth / 2 - Padding;
+        int EndTick = Box.CenterTick + Box.TickWidth / 2 + Padding + 1;
+
+        for (unsigned int wire_no = Box.Wires.first; wire_no <= Box.Wires.second; wire_no++) {
+            raw::ChannelID_t Channel = Geometry->PlaneWireToChannel(Box.Plane, wire_no, 0, 0);
+
+            // Skip wires without data and dead or noisy channels
+            if (Channel >= DigitIndex.size() || DigitIndex.at(Channel) < 0) continue;
+            if (ChannelFilter.Status(Channel) < fParameterSet.MinAllowedChanStatus || !ChannelFilter.IsPresent(Channel)) {
+                continue;
+            }
+
+            // Decode every channel only once, also if boxes overlap
+            const raw::RawDigit &RawDigit = RawDigits.at(DigitIndex.at(Channel));
+            auto Cached = ADCCache.find(Channel);
+            if (Cached == ADCCache.end()) {
+                Cached = ADCCache.emplace(Channel, std::vector<short>(RawDigit.Samples())).first;
+                raw::Uncompress(RawDigit.ADCs(), Cached->second, RawDigit.Compression());
+            }
+            const std::vector<short> &RawADC = Cached->second;
+
+            float Pedestal = fPedestalStubtract ? PedestalRetrievalAlg.PedMean(Channel) : 0.;
+
+            if (fChargeSum) {
+                auto Sums = lasercal::GetWindowCharge(RawADC, StartTick, EndTick, Pedestal, fChargeThreshold);
+                if (Sums.TimeOverThreshold < fMinTimeOverThreshold || Sums.Charge < fMinWireCharge) continue;
+                Result.Wires++;
+                Result.Charge += Sums.Charge;
+                Result.TimeOverThreshold += Sums.TimeOverThreshold;
+            } else {
+                auto Wire = lasercal::GetWindowWire(RawDigit, RawADC, StartTick, EndTick, Pedestal);
+                if (Hits.AddHitsFromWire(Wire).empty()) continue;
+                Result.Wires++;
+            }
+
+            // Decision is made, no need to look at the remaining wires (unless summary or index count all of them)
+            Result.Pass = Result.Wires >= Box.MinHits && (!fChargeSum || Result.Charge >= Box.MinTotalCharge);
+            if (Result.Pass && !fSummaryTree && !fWriteIndex) break;
+        }
+        Result.Pass = Result.Wires >= Box.MinHits && (!fChargeSum || Result.Charge >= Box.MinTotalCharge);
+        return Result;
+    }
 
-        auto hits = lasercal::LaserHits(wires, fParameterSet, laser_roi);
+    LaserSpotter::BoxResult LaserSpotter::EvaluateBox(const SpotterBox &Box, const std::vector<recob::Wire> &Wires) {
+        BoxResult Result;
 
-        auto YHits = hits.GetPlaneHits(Plane);
-        std::cout << "Number of wires: "<< wires.size() << std::endl;
-        std::cout << "Number of hits:  "<< hits.NumberOfWiresWithHits().at(Plane) << std::endl;
+        auto LaserROI = lasercal::LaserROI();
+        LaserROI.setRanges(Box.CenterTick, Box.TickWidth, Box.Plane, Box.Wires);
 
-        if (hits.NumberOfWiresWithHits().at(Plane) >= fMinHits) {
-            std::cout << "True" << std::endl;
-            return true;
-        }
-        else {
-            std::cout << "False" << std::endl;
-            return false;
-        }
+        auto Hits = lasercal::LaserHits(Wires, fParameterSet, LaserROI);
+        Result.Wires = Hits.NumberOfWiresWithHits().at(Box.Plane);
+        Result.Pass = Result.Wires >= Box.MinHits;
+        return Result;
     }
 
     DEFINE_ART_MODULE(LaserSpotter)
@@ -0,0 +1,105 @@
+#ifndef SpotterIndexFilter_Module
+#define SpotterIndexFilter_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDFilter.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Principal/Run.h"
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+// Laser Module Classes
+#include "LaserObjects/LaserSpotterIndex.h"
+
+#include <string>
+
+/*
+ *  This filter replays the decisions of an earlier LaserSpotter pass from its index files (all
+ *  SpotterIndex-<run>-<subrun>.dat files of the run, written with WriteIndex: true). It does not get any product
+ *  from the event, so as first module of a path it rejects the events without laser before RootInput reads any of
+ *  their data products. Repeated passes over the same runs (e.g. for threshold tuning) only decode the events with
+ *  laser.
+ *
+ *  RootInput itself has no event list selection, so the events are still visited (event auxiliary only).
+ *
+ *  Input parameters from fhicl file:
+ *   IndexDirectory   - Directory of the index files (current directory if empty)
+ *   MinMultiplicity  - Additionally require this many wires with hits from the earlier pass
+ *   PassUnknown      - Pass events that are not in the index (otherwise they are rejected)
+ */
+
+namespace LaserSpotter {
+
+    class SpotterIndexFilter : public art::EDFilter {
+
+    public:
+        explicit SpotterIndexFilter(fhicl::ParameterSet const &);
+
+        virtual ~SpotterIndexFilter();
+
+        bool filter(art::Event &evt);
+
+        bool beginRun(art::Run &run);
+
+        void endJob();
+
+        void reconfigure(fhicl::ParameterSet const &p);
+
+    private:
+        std::string fIndexDirectory;
+        unsigned int fMinMultiplicity;
+        bool fPassUnknown;
+
+        lasercal::LaserSpotterIndex fSpotterIndex;
+
+        unsigned long fPassed = 0, fRejected = 0, fUnknown = 0;
+    };
+
+    SpotterIndexFilter::SpotterIndexFilter(fhicl::ParameterSet const &pset) {
+        this->reconfigure(pset);
+    }
+
+    SpotterIndexFilter::~SpotterIndexFilter() {
+    }
+
+    void SpotterIndexFilter::reconfigure(fhicl::ParameterSet const &pset) {
+        fIndexDirectory = pset.get<std::string>("IndexDirectory", "");
+        fMinMultiplicity = pset.get<unsigned int>("MinMultiplicity", 0);
+        fPassUnknown = pset.get<bool>("PassUnknown", false);
+    }
+
+    bool SpotterIndexFilter::beginRun(art::Run &run) {
+        fSpotterIndex = lasercal::LaserSpotterIndex::ReadRun(fIndexDirectory, run.run());
+        mf::LogInfo("SpotterIndexFilter") << "Read spotter index of run " << run.run() << ": "
+                                          << fSpotterIndex.NumberOfPassed() << " of " << fSpotterIndex.size()
+                                          << " events passed the spotter";
+        return true;
+    }
+
+    bool SpotterIndexFilter::filter(art::Event &evt) {
+        const lasercal::SpotterDecision *Decision = fSpotterIndex.Find(evt.subRun(), evt.id().event());
+
+        bool Pass;
+        if (!Decision) {
+            mf::LogWarning("SpotterIndexFilter") << "Event " << evt.id() << " is not in the spotter index";
+            fUnknown++;
+            Pass = fPassUnknown;
+        } else {
+            Pass = Decision->Pass && Decision->Multiplicity >= fMinMultiplicity;
+        }
+
+        Pass ? fPassed++ : fRejected++;
+        return Pass;
+    }
+
+    void SpotterIndexFilter::endJob() {
+        mf::LogInfo("SpotterIndexFilter") << "Passed " << fPassed << " events, rejected " << fRejected
+                                          << " (" << fUnknown << " not in the index)";
+    }
+
+    DEFINE_ART_MODULE(SpotterIndexFilter)
+}
+
+#endif //SpotterIndexFilter_Module
@@ -92,6 +92,9 @@
 #include <memory>
 #include <iterator>
 #include <fstream>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
 
 // Laser Module Classes
 // #include "LaserObjects/LaserBeam.h"
@@ -106,8 +109,107 @@ namespace {
   // everything that gets included in the .cc file from now on).
   // In this way, you don't pollute the environment of other modules.
   
-  // We will define this function at the end, but we at least declare it here
-  // so that the module can freely use it.
+  /**
+   * @brief Uniform grid over the start and end points of the MC tracks of one event
+   * 
+   * Every MC track is stored in the cells of its start and its end point. A reconstructed track is compared
+   * only to the MC tracks in the cells around its own end points, instead of to all MC tracks of the event.
+   */
+  class MCTrackIndex
+  {
+  public:
+    explicit MCTrackIndex(float CellSize) : fCellSize(CellSize) {}
+    
+    void Fill(const std::vector<sim::MCTrack>& MCTracks)
+    {
+      fCells.clear();
+      fStart.clear();
+      fEnd.clear();
+      for(unsigned int mc_no = 0; mc_no < MCTracks.size(); mc_no++)
+      {
+	const auto& MCTrack = MCTracks.at(mc_no);
+	fStart.emplace_back(MCTrack.Start().X(),MCTrack.Start().Y(),MCTrack.Start().Z());
+	fEnd.emplace_back(MCTrack.End().X(),MCTrack.End().Y(),MCTrack.End().Z());
+	
+	fCells[CellKey(fStart.back())].push_back(mc_no);
+	if(CellKey(fEnd.back()) != CellKey(fStart.back())) fCells[CellKey(fEnd.back())].push_back(mc_no);
+      }
+    }
+    
+    /**
+     * @brief Finds the MC track with the closest end points (either orientation)
+     * @param Distance mean distance of the two end points (cm)
+     * @return index of the MC track, -1 if there is no MC track at all
+     * 
+     * If there is no MC track in the cells around the end points, all MC tracks are checked.
+     */
+    int FindNearest(const TVector3& Start, const TVector3& End, float& Distance) const
+    {
+      std::vector<unsigned int> Candidates;
+      CollectCandidates(Start, Candidates);
+      CollectCandidates(End, Candidates);
+      std::sort(Candidates.begin(), Candidates.end());
+      Candidates.erase(std::unique(Candidates.begin(), Candidates.end()), Candidates.end());
+      
+      if(Candidates.empty())
+      {
+	for(unsigned int mc_no = 0; mc_no < fStart.size(); mc_no++) Candidates.push_back(mc_no);
+      }
+      
+      int Nearest = -1;
+      Distance = std::numeric_limits<float>::max();
+      for(auto mc_no : Candidates)
+      {
+	float Same = (Start - fStart.at(mc_no)).Mag() + (End - fEnd.at(mc_no)).Mag();
+	float Flipped = (Start - fEnd.at(mc_no)).Mag() + (End - fStart.at(mc_no)).Mag();
+	float CandidateDistance = 0.5 * std::min(Same, Flipped);
+	if(CandidateDistance < Distance)
+	{
+	  Distance = CandidateDistance;
+	  Nearest = mc_no;
+	}
+      }
+      return Nearest;
+    }
+    
+  private:
+    int64_t CellKey(int CellX, int CellY, int CellZ) const
+    {
+      // 21 bits per coordinate are plenty for the detector in cells of a few cm
+      const int64_t Offset = 1 << 20;
+      return ((CellX + Offset) << 42) | ((CellY + Offset) << 21) | (CellZ + Offset);
+    }
+    
+    int64_t CellKey(const TVector3& Point) const
+    {
+      return CellKey((int) std::floor(Point.X()/fCellSize), (int) std::floor(Point.Y()/fCellSize),
+		     (int) std::floor(Point.Z()/fCellSize));
+    }
+    
+    // Adds the MC tracks of the cell of the point and of its neighbours
+    void CollectCandidates(const TVector3& Point, std::vector<unsigned int>& Candidates) const
+    {
+      int CellX = (int) std::floor(Point.X()/fCellSize);
+      int CellY = (int) std::floor(Point.Y()/fCellSize);
+      int CellZ = (int) std::floor(Point.Z()/fCellSize);
+      for(int dx = -1; dx <= 1; dx++)
+      {
+	for(int dy = -1; dy <= 1; dy++)
+	{
+	  for(int dz = -1; dz <= 1; dz++)
+	  {
+	    auto Cell = fCells.find(CellKey(CellX + dx, CellY + dy, CellZ + dz));
+	    if(Cell != fCells.end()) Candidates.insert(Candidates.end(), Cell->second.begin(), Cell->second.end());
+	  }
+	}
+      }
+    }
+    
+    float fCellSize;
+    std::vector<TVector3> fStart;
+    std::vector<TVector3> fEnd;
+    std::unordered_map<int64_t, std::vector<unsigned int> > fCells;
+  };
   
 } // local namespace
 
@@ -227,7 +329,18 @@ namespace SECAna {
     std::vector<art::InputTag> fTrackTag; ///< Track tags
     art::InputTag fMCTrackTag;
     //std::array<float,3> fUVYThresholds;	  ///< U,V,Y-plane threshold in ADC counts for the laser hit finder
-    ofstream OFile;
+    float fMatchCellSize;         ///< Cell size of the MC track index (cm)
+    bool fWriteTree;              ///< Also write the results as a TTree to the TFileService
+    
+    // The text file stays open for the whole job and is written through a large buffer
+    std::ofstream OFile;
+    std::vector<char> fFileBuffer;
+    
+    // Columnar results (one entry per reconstructed track)
+    TTree* fTrackTree = nullptr;
+    unsigned int fRun, fSubRun, fEvent;
+    int fTrackID, fMCTrackID;
+    float fLength, fMCLength, fLengthDiff, fMatchDistance;
     
   }; // class SECAna
   
@@ -252,13 +365,36 @@ namespace SECAna {
   //-----------------------------------------------------------------------
   void SECAna::beginJob()
   {
+    // The buffer has to be set before the file is opened
+    fFileBuffer.resize(1 << 20);
+    OFile.rdbuf()->pubsetbuf(fFileBuffer.data(), fFileBuffer.size());
     OFile.open(fFileName);
-    OFile.close();
+    if(!OFile)
+    {
+      throw art::Exception(art::errors::FileOpenError) << "SECAna: unable to open " << fFileName << "\n";
+    }
+    
     // Initialize the Art TFile service
+    if(fWriteTree)
+    {
+      art::ServiceHandle<art::TFileService> tfs;
+      fTrackTree = tfs->make<TTree>("SECAna", "SECAna");
+      fTrackTree->Branch("run", &fRun);
+      fTrackTree->Branch("subrun", &fSubRun);
+      fTrackTree->Branch("event", &fEvent);
+      fTrackTree->Branch("track_id", &fTrackID);
+      fTrackTree->Branch("length", &fLength);
+      fTrackTree->Branch("mc_track_id", &fMCTrackID);
+      fTrackTree->Branch("mc_length", &fMCLength);
+      fTrackTree->Branch("length_diff", &fLengthDiff);
+      fTrackTree->Branch("match_distance", &fMatchDistance);
+    }
   }
   
   void  SECAna::endJob()
   {
+    OFile.close();
+    
 //     TFile* OFile = new TFile("HitHist.root", "RECREATE");
 //     CollectionHits->Write();
     
@@ -302,6 +438,8 @@ namespace SECAna {
     fTrackModuleLabel = parameterSet.get< std::vector<std::string> >("TrackModuleLabel");
     fTrackInstanceLabel = parameterSet.get< std::vector<std::string> >("TrackInstanceLabel");
     fMCTrackTag = parameterSet.get< art::InputTag >("MCTrackTag"); 
+    fMatchCellSize = parameterSet.get< float >("MatchCellSize", 20.);
+    fWriteTree = parameterSet.get< bool >("WriteTree", false);
     
     
     for(unsigned int label_index = 0; label_index < fTrackModuleLabel.size(); label_index++)
@@ -320,18 +458,13 @@ namespace SECAna {
   //-----------------------------------------------------------------------
   void SECAna::analyze(const art::Event& event) 
   {
-    OFile.open(fFileName, std::ios_base::app);
-    
     std::vector<art::ValidHandle< std::vector<recob::Track> >> TrackVecHandles;// = event.getValidHandle< std::vector<sim::MCTrack> >(fMCTrackTag);
    
     art::ValidHandle< std::vector<sim::MCTrack> > MCTrackVecHandles = event.getValidHandle< std::vector<sim::MCTrack> >(fMCTrackTag);
-    float MCLength;
     
-    for(const auto& MCTrack : *MCTrackVecHandles)
-    {
-      MCLength = pow(MCTrack.Start().X()-MCTrack.End().X(),2) + pow(MCTrack.Start().Y()-MCTrack.End().Y(),2)+pow(MCTrack.Start().Z()-MCTrack.End().Z(),2);
-//       OFile << event.id() << " " << MCTrack.TrackID() << " "  << sqrt(length) << "\n" ;
-    }
+    // Every reconstructed track is compared to its nearest MC track (not just to the last one of the event)
+    MCTrackIndex MCIndex(fMatchCellSize);
+    MCIndex.Fill(*MCTrackVecHandles);
     
    for(const auto& InputTag : fTrackTag)
    {
@@ -344,13 +477,34 @@ namespace SECAna {
    {
      for(const auto& Track : *TrackVecHandle)
      {
+       float MatchDistance;
+       int MCIndexNo = MCIndex.FindNearest(Track.Vertex(), Track.End(), MatchDistance);
+       if(MCIndexNo < 0) continue;
+       
+       const auto& MCTrack = MCTrackVecHandles->at(MCIndexNo);
+       float MCLength = std::sqrt(std::pow(MCTrack.Start().X()-MCTrack.End().X(),2) 
+				 + std::pow(MCTrack.Start().Y()-MCTrack.End().Y(),2)
+				 + std::pow(MCTrack.Start().Z()-MCTrack.End().Z(),2));
+       
        float LengthDiff = 1 - fabs((Track.Length() - MCLength)/MCLength);
        if(Track.Length()>50) OFile << event.id() << " " << Track.ID() << " "  << LengthDiff << "\n" ;
+       
+       if(fTrackTree)
+       {
+	 fRun = event.run();
+	 fSubRun = event.subRun();
+	 fEvent = event.id().event();
+	 fTrackID = Track.ID();
+	 fLength = Track.Length();
+	 fMCTrackID = MCTrack.TrackID();
+	 fMCLength = MCLength;
+	 fLengthDiff = LengthDiff;
+	 fMatchDistance = MatchDistance;
+	 fTrackTree->Fill();
+       }
      }
    }
    
-   OFile.close();
-   
   } // SECAna::analyze()
   
 //   TGraph* SECAna::FillGraph(const std::vector<float>& WireNumber, const std::vector<float>& PeakTime)
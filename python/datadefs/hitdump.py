@@ -0,0 +1,46 @@
+import os
+import struct
+
+import numpy as np
+
+# Layout written by lasercal::LaserColumnFile (LaserObjects/LaserColumnFile.h)
+HEADER_SIZE = 32
+MAGIC = b"LASERCOL"
+
+COLUMNS = ["run", "subrun", "event", "channel", "plane", "wire",
+           "peak_time", "peak_amplitude", "start_tick", "end_tick"]
+
+
+def read_column(filename):
+    """ Memory maps one column file written by the HitDump module """
+    with open(filename, "rb") as f:
+        magic, version, dtype, count, _ = struct.unpack("<8sI4sQQ", f.read(HEADER_SIZE))
+
+    if magic != MAGIC or version != 1:
+        raise ValueError(filename + " is not a laser column file (version 1)")
+
+    dtype = dtype.rstrip(b"\0").decode("ascii")
+    if count == 0:
+        return np.zeros(0, dtype=dtype)
+    return np.memmap(filename, dtype=dtype, mode="r", offset=HEADER_SIZE, shape=(count,))
+
+
+def read_hits(prefix="hits", columns=None):
+    """ Returns a dict of column name -> (memory mapped) array for the files <prefix>.<column>.col """
+    if columns is None:
+        columns = [col for col in COLUMNS if os.path.exists(prefix + "." + col + ".col")]
+
+    hits = dict((col, read_column(prefix + "." + col + ".col")) for col in columns)
+
+    lengths = set(len(values) for values in hits.values())
+    if len(lengths) > 1:
+        raise ValueError("columns of " + prefix + " have different lengths")
+    return hits
+
+
+def event_hits(hits, event, plane=None):
+    """ Selection mask of the hits of one event (and plane) """
+    mask = hits["event"] == event
+    if plane is not None:
+        mask &= hits["plane"] == plane
+    return mask
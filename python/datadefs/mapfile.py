@@ -0,0 +1,99 @@
+import os
+import struct
+
+import numpy as np
+
+# Layout written by lasercal::LaserMapFile (LaserObjects/LaserMapFile.h)
+HEADER_SIZE = 96
+MAGIC = b"LASERMAP"
+
+ARRAYS = ["dx", "dy", "dz", "err_x", "err_y", "err_z"]
+
+
+def read_map(filename):
+    """ Memory maps a displacement map file, returns (origin, spacing, dict of name -> array[z, y, x])
+
+    The errors are negative for voxels without measured displacement and infinite for voxels with a single entry.
+    """
+    with open(filename, "rb") as f:
+        header = struct.unpack("<8sII3f3f3IIQQ24x", f.read(HEADER_SIZE))
+
+    magic, version, header_size = header[0:3]
+    origin, spacing, size = header[3:6], header[6:9], header[9:12]
+    n_arrays = header[12]
+
+    if magic != MAGIC or version != 1 or header_size != HEADER_SIZE or n_arrays != len(ARRAYS):
+        raise ValueError(filename + " is not a laser displacement map (version 1)")
+
+    data = np.memmap(filename, dtype="<f4", mode="r", offset=HEADER_SIZE,
+                     shape=(n_arrays, size[2], size[1], size[0]))
+    return np.array(origin), np.array(spacing), dict(zip(ARRAYS, data))
+
+
+def voxel_centers(origin, spacing, shape):
+    """ Voxel center coordinates along x, y and z for a map array of the given shape (z, y, x) """
+    return [origin[axis] + (np.arange(shape[2 - axis]) + 0.5) * spacing[axis] for axis in range(3)]
+
+
+# Layout written by lasercal::LaserDistortionMapBuilder::Write (LaserObjects/LaserDistortionMap.h)
+ACC_HEADER_FORMAT = "<8sII3f3f3IIIIQQ"
+ACC_HEADER_SIZE = 80
+ACC_MAGIC = b"LASERACC"
+
+ACC_DTYPE = np.dtype([("entries", "<u8"), ("sum", "<f8", 3), ("sum_squares", "<f8", 3)])
+
+
+def read_accumulator(filename):
+    """ Reads a voxel accumulator, returns (header dict, structured array of the voxels) """
+    with open(filename, "rb") as f:
+        values = struct.unpack(ACC_HEADER_FORMAT, f.read(ACC_HEADER_SIZE))
+        header = {"origin": values[3:6], "spacing": values[6:9], "size": values[9:12],
+                  "first_run": values[13], "last_run": values[14], "outside": values[15], "inputs": values[16]}
+
+        if values[0] != ACC_MAGIC or values[1] != 1 or values[2] != ACC_HEADER_SIZE \
+                or values[12] != ACC_DTYPE.itemsize:
+            raise ValueError(filename + " is not a laser voxel accumulator (version 1)")
+
+        n_voxels = header["size"][0] * header["size"][1] * header["size"][2]
+        voxels = np.fromfile(f, dtype=ACC_DTYPE, count=n_voxels)
+
+    if len(voxels) != n_voxels:
+        raise ValueError(filename + " is truncated")
+    return header, voxels
+
+
+def write_accumulator(filename, header, voxels):
+    """ Writes a voxel accumulator (through a temporary file, like the C++ writer) """
+    tmp_name = filename + ".tmp" + str(os.getpid())
+    with open(tmp_name, "wb") as f:
+        f.write(struct.pack(ACC_HEADER_FORMAT, ACC_MAGIC, 1, ACC_HEADER_SIZE,
+                            *(list(header["origin"]) + list(header["spacing"]) + list(header["size"])
+                              + [ACC_DTYPE.itemsize, header["first_run"], header["last_run"],
+                                 header["outside"], header["inputs"]])))
+        voxels.astype(ACC_DTYPE).tofile(f)
+    os.rename(tmp_name, filename)
+
+
+def merge_accumulators(filenames):
+    """ Adds accumulators of the same grid, returns (header, voxels) of the sum """
+    header, total = read_accumulator(filenames[0])
+    total = total.copy()
+
+    for filename in filenames[1:]:
+        other_header, voxels = read_accumulator(filename)
+        for key in ["origin", "spacing", "size"]:
+            if other_header[key] != header[key]:
+                raise ValueError(filename + " has a different grid than " + filenames[0])
+
+        total["entries"] += voxels["entries"]
+        total["sum"] += voxels["sum"]
+        total["sum_squares"] += voxels["sum_squares"]
+
+        runs = [run for run in [header["first_run"], header["last_run"],
+                                other_header["first_run"], other_header["last_run"]] if run > 0]
+        if runs:
+            header["first_run"], header["last_run"] = min(runs), max(runs)
+        header["outside"] += other_header["outside"]
+        header["inputs"] += other_header["inputs"]
+
+    return header, total
@@ -0,0 +1,24 @@
+import argparse
+import os
+
+from datadefs.mapfile import merge_accumulators, write_accumulator
+
+# Adds per-run voxel accumulators (LaserDistortionMapBuilder::Write) of the same grid, like hadd does for
+# histograms. A new run is folded into the running sum with: merge_accumulators.py total.acc run.acc total.acc -f
+
+parser = argparse.ArgumentParser()
+parser.add_argument("files", help="accumulator files to add", nargs="+")
+parser.add_argument("out_file", help="path to the output file")
+parser.add_argument("-f", "--force", action="store_true", help="overwrite the output file")
+args = parser.parse_args()
+
+if len(args.files) < 2:
+    raise ValueError("need at least two files to add.")
+if os.path.isfile(args.out_file) and not args.force:
+    raise ValueError("output file exists: " + str(args.out_file))
+
+header, voxels = merge_accumulators(args.files)
+write_accumulator(args.out_file, header, voxels)
+
+print("merged {} accumulators ({} inputs, runs {}-{}) into {}".format(
+    len(args.files), header["inputs"], header["first_run"], header["last_run"], args.out_file))
@@ -0,0 +1,132 @@
+#ifndef LaserActiveVolumeTest_Module
+#define LaserActiveVolumeTest_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+
+#include "larcore/Geometry/Geometry.h"
+#include "larcore/Geometry/GeometryCore.h"
+#include "larcore/Geometry/BoxBoundedGeo.h"
+
+#include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserActiveVolume.h"
+
+#include <TVector3.h>
+#include <TMath.h>
+
+#include <assert.h>
+#include <array>
+#include <cmath>
+
+/*
+ *  Compares the batch intersection of many laser beams with the active volume against
+ *  geo::BoxBoundedGeo::GetIntersections and the single beam path of LaserBeam.
+ */
+
+namespace LaserActiveVolumeTest {
+
+    class LaserActiveVolumeTest : public art::EDAnalyzer {
+
+    public:
+        explicit LaserActiveVolumeTest(fhicl::ParameterSet const& pset);
+        virtual ~LaserActiveVolumeTest();
+
+        virtual void analyze(const art::Event& event) override;
+
+        virtual void beginJob() override;
+
+        virtual void endJob() override;
+
+        virtual void reconfigure(fhicl::ParameterSet const &p) override;
+
+    private:
+        std::vector<TVector3> fPositions;
+        unsigned int fStepsPerAngle;
+
+    protected:
+    };
+
+    LaserActiveVolumeTest::LaserActiveVolumeTest(fhicl::ParameterSet const& pset) : EDAnalyzer(pset) {
+            this->reconfigure(pset);
+    }
+
+    LaserActiveVolumeTest::~LaserActiveVolumeTest() {
+    }
+
+    void LaserActiveVolumeTest::reconfigure(fhicl::ParameterSet const &pset) {
+        auto Positions = pset.get<std::vector<std::array<float, 3> > >("Positions");
+        for (const auto &Position : Positions) {
+            fPositions.push_back(TVector3(Position[0], Position[1], Position[2]));
+        }
+        fStepsPerAngle = pset.get<unsigned int>("StepsPerAngle", 50);
+    }
+
+    void LaserActiveVolumeTest::beginJob() {
+    }
+
+    void LaserActiveVolumeTest::endJob() {
+    }
+
+    void LaserActiveVolumeTest::analyze(const art::Event& evt) {
+        geo::GeometryCore const* Geometry = &*(art::ServiceHandle<geo::Geometry>());
+
+        geo::BoxBoundedGeo ActiveVolume( 0,2*Geometry->TPC().ActiveHalfWidth(),
+                                         -Geometry->TPC().ActiveHalfHeight(),Geometry->TPC().ActiveHalfHeight(),
+                                         0,Geometry->TPC().ActiveLength());
+
+        // Fan of beams out of every mirror position
+        lasercal::LaserBeamArrays Beams;
+        std::vector<TVector3> Directions;
+        std::vector<TVector3> Starts;
+
+        for (const auto &Position : fPositions) {
+            for (unsigned int theta_no = 0; theta_no < fStepsPerAngle; theta_no++) {
+                for (unsigned int phi_no = 0; phi_no < fStepsPerAngle; phi_no++) {
+                    TVector3 Direction;
+                    Direction.SetMagThetaPhi(1., TMath::Pi() * (theta_no + 0.5) / fStepsPerAngle,
+                                             2 * TMath::Pi() * (phi_no + 0.5) / fStepsPerAngle);
+
+                    Beams.push_back(Position.X(), Position.Y(), Position.Z(), Direction.X(), Direction.Y(), Direction.Z());
+                    Starts.push_back(Position);
+                    Directions.push_back(Direction);
+                }
+            }
+        }
+
+        lasercal::LaserIntersectionArrays Intersections;
+        lasercal::IntersectBeams(lasercal::GetActiveVolume(), Beams, Intersections);
+
+        assert(Intersections.size() == Directions.size());
+
+        unsigned int NumberOfHits = 0;
+        for (unsigned int beam_no = 0; beam_no < Directions.size(); beam_no++) {
+            auto IntersectionPoints = ActiveVolume.GetIntersections(Starts.at(beam_no), Directions.at(beam_no));
+
+            assert(Intersections.Hit.at(beam_no) == !IntersectionPoints.empty());
+            if (IntersectionPoints.empty()) continue;
+            NumberOfHits++;
+
+            TVector3 Entry(Intersections.EntryX.at(beam_no), Intersections.EntryY.at(beam_no), Intersections.EntryZ.at(beam_no));
+            TVector3 Exit(Intersections.ExitX.at(beam_no), Intersections.ExitY.at(beam_no), Intersections.ExitZ.at(beam_no));
+
+            assert((Entry - IntersectionPoints.front()).Mag() < 0.01);
+            assert((Exit - IntersectionPoints.back()).Mag() < 0.01);
+
+            // The single beam path has to give the same result
+            lasercal::LaserBeam Beam(Starts.at(beam_no), Directions.at(beam_no));
+            assert((Beam.GetEntryPoint() - IntersectionPoints.front()).Mag() < 0.01);
+            assert((Beam.GetExitPoint() - IntersectionPoints.back()).Mag() < 0.01);
+        }
+
+        std::cout << "==> Tested " << Directions.size() << " beams, " << NumberOfHits << " hit the active volume" << std::endl;
+        assert(NumberOfHits > 0);
+    }
+
+    DEFINE_ART_MODULE(LaserActiveVolumeTest)
+}
+
+#endif //LaserActiveVolumeTest_Module
@@ -0,0 +1,173 @@
+#ifndef LaserDataFileTest_Module
+#define LaserDataFileTest_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+
+#include "LaserObjects/LaserDataFile.h"
+
+#include <assert.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+/*
+ *  Writes a laser data text file and reads it through the binary cache: the first read parses the text and writes
+ *  the cache, the second one loads the cache. A changed text file, a cache with a wrong record count in its header
+ *  and a truncated cache all have to fall back to parsing the text file with the same records.
+ */
+
+namespace LaserDataFileTest {
+
+    class LaserDataFileTest : public art::EDAnalyzer {
+
+    public:
+        explicit LaserDataFileTest(fhicl::ParameterSet const& pset);
+        virtual ~LaserDataFileTest();
+
+        virtual void analyze(const art::Event& event) override;
+
+        virtual void beginJob() override;
+
+        virtual void endJob() override;
+
+        virtual void reconfigure(fhicl::ParameterSet const &p) override;
+
+    private:
+        /// Appends laser data lines with trigger counts [First, First + Number) to the text file
+        void AppendLines(unsigned int First, unsigned int Number) const;
+
+        /// Checks that the records are the lines written with trigger counts [0, Number)
+        bool Same(const lasercal::LaserDataFile &File, unsigned int Number) const;
+
+        std::string fFileName;
+        unsigned int fNumberOfLines;
+
+    protected:
+    };
+
+    LaserDataFileTest::LaserDataFileTest(fhicl::ParameterSet const& pset) : EDAnalyzer(pset) {
+            this->reconfigure(pset);
+    }
+
+    LaserDataFileTest::~LaserDataFileTest() {
+    }
+
+    void LaserDataFileTest::reconfigure(fhicl::ParameterSet const &pset) {
+        fFileName = pset.get<std::string>("FileName", "LaserDataFileTest.txt");
+        fNumberOfLines = pset.get<unsigned int>("NumberOfLines", 1000);
+    }
+
+    void LaserDataFileTest::beginJob() {
+    }
+
+    void LaserDataFileTest::endJob() {
+        std::remove(fFileName.c_str());
+        std::remove(lasercal::LaserDataFile::CacheName(fFileName).c_str());
+    }
+
+    void LaserDataFileTest::AppendLines(unsigned int First, unsigned int Number) const {
+        std::ofstream Text(fFileName, std::ios::out | std::ios::app);
+        for (unsigned int line_no = First; line_no < First + Number; line_no++) {
+            Text << 1 + line_no % 2 << " 0 " << 0.25 * line_no << " " << 1000. - line_no << " 0.5 1.5 "
+                 << 1500000000 + line_no << " " << (line_no * 7919) % 1000000 << " " << line_no << " 3 0 "
+                 << 0.1 * line_no << " -0.2 0.3 " << -0.1 * line_no << "\n";
+        }
+    }
+
+    bool LaserDataFileTest::Same(const lasercal::LaserDataFile &File, unsigned int Number) const {
+        if (File.size() != Number) return false;
+        for (unsigned int line_no = 0; line_no < Number; line_no++) {
+            const lasercal::LaserDataRecord &Record = File.at(line_no);
+            if (Record.LaserSystem != (int32_t) (1 + line_no % 2)
+                || Record.RotaryPosition != 0.25 * line_no
+                || Record.TriggerTimeSec != 1500000000 + (int64_t) line_no
+                || Record.TriggerTimeUsec != (int64_t) ((line_no * 7919) % 1000000)
+                || Record.TriggerCount != (int32_t) line_no
+                || Record.RunControlStep != 3) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void LaserDataFileTest::analyze(const art::Event &event) {
+        const std::string CacheFile = lasercal::LaserDataFile::CacheName(fFileName);
+        std::remove(fFileName.c_str());
+        std::remove(CacheFile.c_str());
+        AppendLines(0, fNumberOfLines);
+
+        // Without cache nothing is written
+        {
+            lasercal::LaserDataFile File(fFileName, false);
+            assert(!File.FromCache() && Same(File, fNumberOfLines));
+            assert(!std::ifstream(CacheFile));
+        }
+
+        // First read parses and writes the cache, the second one loads it
+        {
+            lasercal::LaserDataFile File(fFileName);
+            assert(!File.FromCache() && Same(File, fNumberOfLines));
+        }
+        {
+            lasercal::LaserDataFile File(fFileName);
+            assert(File.FromCache() && Same(File, fNumberOfLines));
+        }
+
+        // A changed text file invalidates the cache
+        AppendLines(fNumberOfLines, 1);
+        {
+            lasercal::LaserDataFile File(fFileName);
+            assert(!File.FromCache() && Same(File, fNumberOfLines + 1));
+        }
+        {
+            lasercal::LaserDataFile File(fFileName);
+            assert(File.FromCache() && Same(File, fNumberOfLines + 1));
+        }
+
+        // Huge record count in the header (after magic, version and record size)
+        {
+            std::fstream Cache(CacheFile, std::ios::in | std::ios::out | std::ios::binary);
+            uint64_t Count = (uint64_t) 1 << 40;
+            Cache.seekp(16);
+            Cache.write(reinterpret_cast<const char *>(&Count), sizeof(Count));
+            assert(Cache);
+        }
+        {
+            lasercal::LaserDataFile File(fFileName);
+            assert(!File.FromCache() && Same(File, fNumberOfLines + 1));
+        }
+
+        // Cache cut in the middle of a record
+        std::vector<char> Content;
+        {
+            std::ifstream Cache(CacheFile, std::ios::in | std::ios::binary);
+            Content.assign(std::istreambuf_iterator<char>(Cache), std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream Cache(CacheFile, std::ios::out | std::ios::binary | std::ios::trunc);
+            Cache.write(Content.data(), Content.size() / 2);
+        }
+        {
+            lasercal::LaserDataFile File(fFileName);
+            assert(!File.FromCache() && Same(File, fNumberOfLines + 1));
+        }
+        {
+            lasercal::LaserDataFile File(fFileName);
+            assert(File.FromCache() && Same(File, fNumberOfLines + 1));
+        }
+
+        std::cout << "==> Read " << fNumberOfLines + 1 << " laser data lines through the cache" << std::endl;
+    }
+
+    DEFINE_ART_MODULE(LaserDataFileTest)
+}
+
+#endif //LaserDataFileTest_Module
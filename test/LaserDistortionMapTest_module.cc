@@ -0,0 +1,256 @@
+#ifndef LaserDistortionMapTest_Module
+#define LaserDistortionMapTest_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art/Framework/Services/Optional/TFileService.h"
+
+#include "LaserObjects/LaserTrack.h"
+#include "LaserObjects/LaserDistortionMap.h"
+#include "LaserObjects/LaserMapFile.h"
+#include "LaserObjects/LaserDistortionSolver.h"
+
+#include <TVector3.h>
+
+#include <assert.h>
+#include <array>
+#include <cmath>
+
+/*
+ *  Builds a displacement map from straight tracks shifted by a constant offset and checks that single and
+ *  multi-threaded accumulation give the same field, which has to be the offset perpendicular to the beams. The field
+ *  is written to a binary map file and read back, and per run accumulators are merged again. With crossing beams
+ *  along z and x the solver has to find the full offset.
+ */
+
+namespace LaserDistortionMapTest {
+
+    class LaserDistortionMapTest : public art::EDAnalyzer {
+
+    public:
+        explicit LaserDistortionMapTest(fhicl::ParameterSet const& pset);
+        virtual ~LaserDistortionMapTest();
+
+        virtual void analyze(const art::Event& event) override;
+
+        virtual void beginJob() override;
+
+        virtual void endJob() override;
+
+        virtual void reconfigure(fhicl::ParameterSet const &p) override;
+
+    private:
+        lasercal::ActiveVolumeBox fBox;
+        unsigned int fNumberOfVoxels[3];
+        std::array<float, 3> fOffset;
+        unsigned int fNumberOfTracks;
+        unsigned int fNumberOfThreads;
+
+    protected:
+    };
+
+    LaserDistortionMapTest::LaserDistortionMapTest(fhicl::ParameterSet const& pset) : EDAnalyzer(pset) {
+            this->reconfigure(pset);
+    }
+
+    LaserDistortionMapTest::~LaserDistortionMapTest() {
+    }
+
+    void LaserDistortionMapTest::reconfigure(fhicl::ParameterSet const &pset) {
+        auto Min = pset.get<std::array<float, 3> >("VolumeMin");
+        auto Max = pset.get<std::array<float, 3> >("VolumeMax");
+        auto NumberOfVoxels = pset.get<std::array<unsigned int, 3> >("NumberOfVoxels");
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            fBox.Min[axis] = Min[axis];
+            fBox.Max[axis] = Max[axis];
+            fNumberOfVoxels[axis] = NumberOfVoxels[axis];
+        }
+        fOffset = pset.get<std::array<float, 3> >("Offset");
+        fNumberOfTracks = pset.get<unsigned int>("NumberOfTracks", 200);
+        fNumberOfThreads = pset.get<unsigned int>("NumberOfThreads", 4);
+    }
+
+    void LaserDistortionMapTest::beginJob() {
+    }
+
+    void LaserDistortionMapTest::endJob() {
+    }
+
+    void LaserDistortionMapTest::analyze(const art::Event& evt) {
+        lasercal::LaserVoxelGrid Grid(fBox, fNumberOfVoxels);
+        TVector3 Offset(fOffset[0], fOffset[1], fOffset[2]);
+
+        // Beams along z spread over the volume, every sample shifted by the same offset
+        std::vector<lasercal::LaserTrack> Tracks;
+        for (unsigned int track_no = 0; track_no < fNumberOfTracks; track_no++) {
+            float Fraction = (track_no + 0.5) / fNumberOfTracks;
+            TVector3 Position(fBox.Min[0] + Fraction * (fBox.Max[0] - fBox.Min[0]),
+                              fBox.Max[1] - Fraction * (fBox.Max[1] - fBox.Min[1]), fBox.Min[2] - 10.);
+            TVector3 Direction(0., 0., 1.);
+
+            lasercal::LaserTrack Track;
+            Track.SetPosition(Position);
+            Track.SetDirection(Direction);
+            for (float Step = 0.; Step < fBox.Max[2] - fBox.Min[2] + 20.; Step += 1.) {
+                TVector3 Sample = Position + Step * Direction + Offset;
+                Track.AppendSample(Sample);
+            }
+            Tracks.push_back(Track);
+        }
+
+        lasercal::LaserDistortionMapBuilder Single(Grid, 1);
+        lasercal::LaserDistortionMapBuilder Parallel(Grid, fNumberOfThreads);
+        Single.AddTracks(Tracks);
+        Parallel.AddTracks(Tracks);
+
+        auto SingleMap = Single.GetMap();
+        auto ParallelMap = Parallel.GetMap();
+        assert(Single.GetNumberOfOutside() == Parallel.GetNumberOfOutside());
+
+        unsigned int FilledVoxels = 0;
+        for (size_t voxel_no = 0; voxel_no < SingleMap.size(); voxel_no++) {
+            assert(SingleMap.Entries[voxel_no] == ParallelMap.Entries[voxel_no]);
+            if (!SingleMap.Entries[voxel_no]) continue;
+            FilledVoxels++;
+
+            assert(std::fabs(SingleMap.DisplacementX[voxel_no] - ParallelMap.DisplacementX[voxel_no]) < 1e-4);
+            assert(std::fabs(SingleMap.DisplacementX[voxel_no] + fOffset[0]) < 1e-3);
+            assert(std::fabs(SingleMap.DisplacementY[voxel_no] + fOffset[1]) < 1e-3);
+            assert(std::fabs(SingleMap.DisplacementZ[voxel_no]) < 1e-3);
+            assert(SingleMap.RMSX[voxel_no] < 1e-3);
+        }
+
+        // The per-sample correction has to agree with the map
+        Tracks.front().CorrectTrack(0);
+        TVector3 Correction = Tracks.front().GetCorrection(0);
+        assert(std::fabs(Correction.X() + fOffset[0]) < 1e-3 && std::fabs(Correction.Y() + fOffset[1]) < 1e-3);
+
+        // Bulk copy and resampling to 2.5 cm keep the samples on the line and their corrections
+        lasercal::LaserTrack Resampled(Tracks.front());
+        lasercal::LaserSampleView Samples = Tracks.front().GetSamples();
+        lasercal::LaserSampleView Corrections = Tracks.front().GetCorrections();
+        Resampled.ClearSamples();
+        Resampled.Reserve(Samples.Size);
+        Resampled.AppendSamples(Samples.X, Samples.Y, Samples.Z, Samples.Size, Corrections.X, Corrections.Y,
+                                Corrections.Z);
+        Resampled.Resample(2.5);
+        Samples = Resampled.GetSamples();
+        Corrections = Resampled.GetCorrections();
+        assert(Samples.Size == (unsigned long) ((Tracks.front().GetNumberOfSamples() - 1) / 2.5) + 1);
+        for (unsigned long sample_no = 0; sample_no < Samples.Size; sample_no++) {
+            assert(std::fabs(Samples.Z[sample_no] - Samples.Z[0] - 2.5 * sample_no) < 1e-3);
+            assert(std::fabs(Corrections.X[sample_no] + fOffset[0]) < 1e-3);
+        }
+
+        art::ServiceHandle<art::TFileService> tfs;
+        ParallelMap.WriteHistograms(&tfs->file());
+
+        // The binary map file has to give back the same field
+        lasercal::LaserMapFile::Write("LaserDistortionMapTest.map", ParallelMap);
+        lasercal::LaserMapFile MapFile("LaserDistortionMapTest.map", true);
+        assert(MapFile.GetGrid().NumberOfVoxels() == ParallelMap.size());
+        for (size_t voxel_no = 0; voxel_no < ParallelMap.size(); voxel_no++) {
+            assert(MapFile.Data(lasercal::LaserMapFile::kDisplacementX)[voxel_no] == ParallelMap.DisplacementX[voxel_no]);
+            assert(MapFile.Data(lasercal::LaserMapFile::kDisplacementY)[voxel_no] == ParallelMap.DisplacementY[voxel_no]);
+            assert(MapFile.Data(lasercal::LaserMapFile::kDisplacementZ)[voxel_no] == ParallelMap.DisplacementZ[voxel_no]);
+            assert((MapFile.Data(lasercal::LaserMapFile::kErrorX)[voxel_no] < 0) == !ParallelMap.Valid[voxel_no]);
+        }
+
+        // Voxels below MinEntries keep their entries, but have no displacement and no error in the file
+        const unsigned int MinEntries = 50;
+        lasercal::LaserDisplacementMap SparseMap = Parallel.GetMap(MinEntries);
+        lasercal::LaserMapFile::Write("LaserDistortionMapTest.sparse.map", SparseMap);
+        lasercal::LaserMapFile SparseFile("LaserDistortionMapTest.sparse.map");
+        size_t BelowMinEntries = 0;
+        for (size_t voxel_no = 0; voxel_no < SparseMap.size(); voxel_no++) {
+            bool Measured = SparseMap.Entries[voxel_no] >= MinEntries;
+            assert(SparseMap.Valid[voxel_no] == Measured);
+            assert((SparseFile.Data(lasercal::LaserMapFile::kErrorX)[voxel_no] < 0) == !Measured);
+            if (!Measured && SparseMap.Entries[voxel_no] > 0) BelowMinEntries++;
+        }
+        assert(BelowMinEntries > 0);
+
+        // Accumulators of two halves written per run and merged again have to give the same sums
+        std::vector<lasercal::LaserTrack> FirstHalf(Tracks.begin(), Tracks.begin() + Tracks.size() / 2);
+        std::vector<lasercal::LaserTrack> SecondHalf(Tracks.begin() + Tracks.size() / 2, Tracks.end());
+        lasercal::LaserDistortionMapBuilder FirstRun(Grid, fNumberOfThreads), SecondRun(Grid, 1);
+        FirstRun.SetRun(1);
+        FirstRun.AddTracks(FirstHalf);
+        FirstRun.Write("LaserDistortionMapTest.1.acc");
+        SecondRun.SetRun(2);
+        SecondRun.AddTracks(SecondHalf);
+        SecondRun.Write("LaserDistortionMapTest.2.acc");
+
+        lasercal::LaserDistortionMapBuilder Merged(Grid);
+        Merged.Merge("LaserDistortionMapTest.1.acc");
+        Merged.Merge("LaserDistortionMapTest.2.acc");
+        assert(Merged.GetFirstRun() == 1 && Merged.GetLastRun() == 2);
+        assert(Merged.GetNumberOfOutside() == Single.GetNumberOfOutside());
+        const auto &SingleVoxels = Single.GetVoxels();
+        const auto &MergedVoxels = Merged.GetVoxels();
+        for (size_t voxel_no = 0; voxel_no < SingleVoxels.size(); voxel_no++) {
+            assert(SingleVoxels[voxel_no].Entries == MergedVoxels[voxel_no].Entries);
+            assert(std::fabs(SingleVoxels[voxel_no].Sum[0] - MergedVoxels[voxel_no].Sum[0]) < 1e-6);
+        }
+
+        // Crossing beams along z and x on a coarse grid, every voxel is hit from both directions
+        unsigned int CoarseVoxels[3] = {5, 4, 10};
+        lasercal::LaserVoxelGrid CoarseGrid(fBox, CoarseVoxels);
+        std::vector<lasercal::LaserTrack> CrossingTracks;
+        for (unsigned int first_no = 0; first_no < 20; first_no++) {
+            for (unsigned int second_no = 0; second_no < 20; second_no++) {
+                float First = (first_no + 0.5) / 20.;
+                float Second = (second_no + 0.5) / 20.;
+                TVector3 Positions[2] = {
+                        TVector3(fBox.Min[0] + First * (fBox.Max[0] - fBox.Min[0]),
+                                 fBox.Min[1] + Second * (fBox.Max[1] - fBox.Min[1]), fBox.Min[2] - 10.),
+                        TVector3(fBox.Min[0] - 10., fBox.Min[1] + First * (fBox.Max[1] - fBox.Min[1]),
+                                 fBox.Min[2] + Second * (fBox.Max[2] - fBox.Min[2]))};
+                TVector3 Directions[2] = {TVector3(0., 0., 1.), TVector3(1., 0., 0.)};
+
+                for (unsigned int beam_no = 0; beam_no < 2; beam_no++) {
+                    lasercal::LaserTrack Track;
+                    Track.SetPosition(Positions[beam_no]);
+                    Track.SetDirection(Directions[beam_no]);
+                    for (float Step = 0.; Step < fBox.Max[2] - fBox.Min[2] + 20.; Step += 2.) {
+                        TVector3 Sample = Positions[beam_no] + Step * Directions[beam_no] + Offset;
+                        Track.AppendSample(Sample);
+                    }
+                    CrossingTracks.push_back(Track);
+                }
+            }
+        }
+
+        lasercal::LaserDistortionSolver Solver(CoarseGrid, fNumberOfThreads);
+        Solver.SetTolerance(1e-3);
+        Solver.SetMaxIterations(200);
+        Solver.SetCheckpointFile("LaserDistortionMapTest.checkpoint.map");
+        Solver.Solve(CrossingTracks);
+        assert(Solver.HasConverged());
+
+        const auto &SolvedMap = Solver.GetMap();
+        for (size_t voxel_no = 0; voxel_no < SolvedMap.size(); voxel_no++) {
+            assert(SolvedMap.Entries[voxel_no] > 0);
+            assert(std::fabs(SolvedMap.DisplacementX[voxel_no] + fOffset[0]) < 0.05);
+            assert(std::fabs(SolvedMap.DisplacementY[voxel_no] + fOffset[1]) < 0.05);
+            assert(std::fabs(SolvedMap.DisplacementZ[voxel_no] + fOffset[2]) < 0.05);
+        }
+
+        // Continuing from the checkpoint is already converged
+        lasercal::LaserDistortionSolver Continued(CoarseGrid, 1);
+        Continued.SetStartMap(lasercal::LaserMapFile("LaserDistortionMapTest.checkpoint.map", true));
+        assert(Continued.Iterate(CrossingTracks) < 1e-3);
+
+        std::cout << "==> Filled " << FilledVoxels << " of " << SingleMap.size() << " voxels with "
+                  << fNumberOfTracks << " tracks" << std::endl;
+        assert(FilledVoxels > 0);
+    }
+
+    DEFINE_ART_MODULE(LaserDistortionMapTest)
+}
+
+#endif //LaserDistortionMapTest_Module
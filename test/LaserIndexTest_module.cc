@@ -0,0 +1,231 @@
+#ifndef LaserIndexTest_Module
+#define LaserIndexTest_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Utilities/Exception.h"
+
+#include "LaserObjects/LaserTrack.h"
+#include "LaserObjects/Laser.h"
+
+#include <TVector3.h>
+
+#include <assert.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+ *  Puts straight tracks with random directions through the volume and compares the queries of the spatial index
+ *  of lasercal::Laser (sphere, box and ray) with a scan over all samples. The found samples have to be exactly the
+ *  same. Appending a track has to invalidate the index.
+ */
+
+namespace LaserIndexTest {
+
+    class LaserIndexTest : public art::EDAnalyzer {
+
+    public:
+        explicit LaserIndexTest(fhicl::ParameterSet const& pset);
+        virtual ~LaserIndexTest();
+
+        virtual void analyze(const art::Event& event) override;
+
+        virtual void beginJob() override;
+
+        virtual void endJob() override;
+
+        virtual void reconfigure(fhicl::ParameterSet const &p) override;
+
+    private:
+        /// Samples of all tracks that pass the test, sorted as the index results below
+        template<class Test>
+        std::vector<lasercal::LaserSampleRef> Scan(const std::vector<lasercal::LaserTrack> &Tracks,
+                                                   const Test &Accept) const;
+
+        /// Sorts the found samples by track and sample and checks them against the scan
+        bool Same(std::vector<lasercal::LaserSampleRef> Found,
+                  const std::vector<lasercal::LaserSampleRef> &Expected) const;
+
+        std::array<float, 3> fMin, fMax;
+        unsigned int fNumberOfTracks;
+        unsigned int fNumberOfQueries;
+        float fCellSize;
+        float fRadius;
+
+    protected:
+    };
+
+    LaserIndexTest::LaserIndexTest(fhicl::ParameterSet const& pset) : EDAnalyzer(pset) {
+            this->reconfigure(pset);
+    }
+
+    LaserIndexTest::~LaserIndexTest() {
+    }
+
+    void LaserIndexTest::reconfigure(fhicl::ParameterSet const &pset) {
+        fMin = pset.get<std::array<float, 3> >("VolumeMin");
+        fMax = pset.get<std::array<float, 3> >("VolumeMax");
+        fNumberOfTracks = pset.get<unsigned int>("NumberOfTracks", 100);
+        fNumberOfQueries = pset.get<unsigned int>("NumberOfQueries", 50);
+        fCellSize = pset.get<float>("CellSize", 10.);
+        fRadius = pset.get<float>("Radius", 15.);
+    }
+
+    void LaserIndexTest::beginJob() {
+    }
+
+    void LaserIndexTest::endJob() {
+    }
+
+    template<class Test>
+    std::vector<lasercal::LaserSampleRef> LaserIndexTest::Scan(const std::vector<lasercal::LaserTrack> &Tracks,
+                                                               const Test &Accept) const {
+        std::vector<lasercal::LaserSampleRef> Expected;
+        for (uint32_t track_no = 0; track_no < Tracks.size(); track_no++) {
+            const lasercal::LaserSampleView Samples = Tracks[track_no].GetSamples();
+            for (uint32_t sample_no = 0; sample_no < Samples.Size; sample_no++) {
+                if (Accept(Samples.X[sample_no], Samples.Y[sample_no], Samples.Z[sample_no])) {
+                    Expected.push_back({track_no, sample_no});
+                }
+            }
+        }
+        return Expected;
+    }
+
+    bool LaserIndexTest::Same(std::vector<lasercal::LaserSampleRef> Found,
+                              const std::vector<lasercal::LaserSampleRef> &Expected) const {
+        std::sort(Found.begin(), Found.end(), [](const lasercal::LaserSampleRef &Left,
+                                                 const lasercal::LaserSampleRef &Right) {
+            return Left.Track < Right.Track || (Left.Track == Right.Track && Left.Sample < Right.Sample);
+        });
+        if (Found.size() != Expected.size()) return false;
+        for (size_t ref_no = 0; ref_no < Found.size(); ref_no++) {
+            if (Found[ref_no].Track != Expected[ref_no].Track || Found[ref_no].Sample != Expected[ref_no].Sample) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void LaserIndexTest::analyze(const art::Event &event) {
+        std::mt19937 Generator(4711);
+        std::uniform_real_distribution<float> Uniform(0.f, 1.f);
+        auto RandomPoint = [&](float Margin) {
+            return TVector3(fMin[0] - Margin + Uniform(Generator) * (fMax[0] - fMin[0] + 2 * Margin),
+                            fMin[1] - Margin + Uniform(Generator) * (fMax[1] - fMin[1] + 2 * Margin),
+                            fMin[2] - Margin + Uniform(Generator) * (fMax[2] - fMin[2] + 2 * Margin));
+        };
+        auto RandomDirection = [&]() {
+            TVector3 Direction;
+            do {
+                Direction.SetXYZ(2 * Uniform(Generator) - 1, 2 * Uniform(Generator) - 1, 2 * Uniform(Generator) - 1);
+            } while (Direction.Mag() < 0.1 || Direction.Mag() > 1.);
+            return Direction.Unit();
+        };
+
+        // Straight tracks in random directions, sampled every cm inside the volume
+        std::vector<lasercal::LaserTrack> Tracks;
+        for (unsigned int track_no = 0; track_no < fNumberOfTracks; track_no++) {
+            TVector3 Position = RandomPoint(0.);
+            TVector3 Direction = RandomDirection();
+
+            lasercal::LaserTrack Track;
+            Track.SetPosition(Position);
+            Track.SetDirection(Direction);
+            for (int sign : {-1, 1}) {
+                for (float Step = (sign > 0) ? 0.f : 1.f; ; Step += 1.f) {
+                    TVector3 Sample = Position + sign * Step * Direction;
+                    if (Sample.X() < fMin[0] || Sample.X() > fMax[0] || Sample.Y() < fMin[1] || Sample.Y() > fMax[1]
+                        || Sample.Z() < fMin[2] || Sample.Z() > fMax[2]) break;
+                    Track.AppendSample(Sample);
+                }
+            }
+            Tracks.push_back(Track);
+        }
+
+        lasercal::Laser Laser(Tracks);
+        Laser.BuildIndex(fCellSize);
+        assert(Laser.HasIndex());
+
+        std::vector<lasercal::LaserSampleRef> Found;
+        size_t FoundSamples = 0;
+        for (unsigned int query_no = 0; query_no < fNumberOfQueries; query_no++) {
+            // Sphere, also around points outside of the volume
+            const TVector3 Point = RandomPoint(fRadius);
+            const float Center[3] = {(float) Point.X(), (float) Point.Y(), (float) Point.Z()};
+            const float RadiusSquared = fRadius * fRadius;
+            Laser.FindSamples(Point, fRadius, Found);
+            assert(Same(Found, Scan(Tracks, [&Center, RadiusSquared](float X, float Y, float Z) {
+                float dX = X - Center[0], dY = Y - Center[1], dZ = Z - Center[2];
+                return dX * dX + dY * dY + dZ * dZ <= RadiusSquared;
+            })));
+            FoundSamples += Found.size();
+
+            // Box of random size, partly outside of the volume
+            const TVector3 Corner = RandomPoint(2 * fCellSize);
+            const float Min[3] = {(float) Corner.X(), (float) Corner.Y(), (float) Corner.Z()};
+            const float Max[3] = {Min[0] + 4 * fCellSize * Uniform(Generator),
+                                  Min[1] + 4 * fCellSize * Uniform(Generator),
+                                  Min[2] + 4 * fCellSize * Uniform(Generator)};
+            Laser.FindSamplesInBox(Min, Max, Found);
+            assert(Same(Found, Scan(Tracks, [&Min, &Max](float X, float Y, float Z) {
+                return X >= Min[0] && X <= Max[0] && Y >= Min[1] && Y <= Max[1] && Z >= Min[2] && Z <= Max[2];
+            })));
+            FoundSamples += Found.size();
+
+            // Ray from inside or outside of the volume, only the samples ahead of the origin count
+            const TVector3 Origin = RandomPoint(fRadius);
+            const TVector3 Direction = RandomDirection();
+            const float Start[3] = {(float) Origin.X(), (float) Origin.Y(), (float) Origin.Z()};
+            const float Step[3] = {(float) Direction.X(), (float) Direction.Y(), (float) Direction.Z()};
+            const float RayRadius = 0.2f * fRadius;
+            Laser.FindSamplesAlongRay(Origin, Direction, RayRadius, Found);
+            assert(Same(Found, Scan(Tracks, [&Start, &Step, RayRadius](float X, float Y, float Z) {
+                float Relative[3] = {X - Start[0], Y - Start[1], Z - Start[2]};
+                float Projection = std::max(Relative[0] * Step[0] + Relative[1] * Step[1] + Relative[2] * Step[2], 0.f);
+                float DistanceSquared = 0.f;
+                for (unsigned int axis = 0; axis < 3; axis++) {
+                    float Distance = Relative[axis] - Projection * Step[axis];
+                    DistanceSquared += Distance * Distance;
+                }
+                return DistanceSquared <= RayRadius * RayRadius;
+            })));
+            FoundSamples += Found.size();
+        }
+        assert(FoundSamples > 0);
+
+        // A ray along a track, starting behind the volume, finds all of its samples
+        const lasercal::LaserTrack &First = Tracks.front();
+        const TVector3 Behind = First.GetLaserPosition() - 2 * (fMax[2] - fMin[2]) * First.GetLaserDirection();
+        Laser.FindSamplesAlongRay(Behind, First.GetLaserDirection(), 0.01, Found);
+        size_t OnTrack = std::count_if(Found.begin(), Found.end(),
+                                       [](const lasercal::LaserSampleRef &Ref) { return Ref.Track == 0; });
+        assert(OnTrack == First.GetNumberOfSamples());
+
+        // Appending a track invalidates the index
+        Laser.AppendTrack(First);
+        assert(!Laser.HasIndex());
+        bool Thrown = false;
+        try {
+            Laser.FindSamples(TVector3(0., 0., 0.), fRadius, Found);
+        }
+        catch (art::Exception &) {
+            Thrown = true;
+        }
+        assert(Thrown);
+
+        std::cout << "==> " << 3 * fNumberOfQueries << " index queries on " << fNumberOfTracks << " tracks found "
+                  << FoundSamples << " samples" << std::endl;
+    }
+
+    DEFINE_ART_MODULE(LaserIndexTest)
+}
+
+#endif //LaserIndexTest_Module
@@ -0,0 +1,277 @@
+#ifndef LaserMapInterpolatorTest_Module
+#define LaserMapInterpolatorTest_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Utilities/Exception.h"
+
+#include "LaserObjects/LaserDistortionMap.h"
+#include "LaserObjects/LaserMapFile.h"
+#include "LaserObjects/LaserMapInterpolator.h"
+
+#include <assert.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+/*
+ *  Interpolates a linear displacement field, which trilinear interpolation has to give back exactly between the
+ *  voxel centers. Points outside of the centers (and of the grid) have to get the value at the closest border and
+ *  axes with a single voxel have to give a field that is constant along them. Unmeasured voxels with a bogus value
+ *  must not leak into the result, the same has to hold for a map read from a map file.
+ */
+
+namespace LaserMapInterpolatorTest {
+
+    class LaserMapInterpolatorTest : public art::EDAnalyzer {
+
+    public:
+        explicit LaserMapInterpolatorTest(fhicl::ParameterSet const& pset);
+        virtual ~LaserMapInterpolatorTest();
+
+        virtual void analyze(const art::Event& event) override;
+
+        virtual void beginJob() override;
+
+        virtual void endJob() override;
+
+        virtual void reconfigure(fhicl::ParameterSet const &p) override;
+
+    private:
+        // Linear field: displacement = Constant + Gradient * position (row per component)
+        void LinearField(const float Point[3], float Displacement[3]) const;
+
+        lasercal::LaserDisplacementMap MakeMap(const unsigned int NumberOfVoxels[3]) const;
+
+        lasercal::ActiveVolumeBox fBox;
+        unsigned int fNumberOfVoxels[3];
+        unsigned int fNumberOfPoints;
+        std::array<float, 3> fConstant;
+        std::array<float, 9> fGradient;
+
+    protected:
+    };
+
+    LaserMapInterpolatorTest::LaserMapInterpolatorTest(fhicl::ParameterSet const& pset) : EDAnalyzer(pset) {
+            this->reconfigure(pset);
+    }
+
+    LaserMapInterpolatorTest::~LaserMapInterpolatorTest() {
+    }
+
+    void LaserMapInterpolatorTest::reconfigure(fhicl::ParameterSet const &pset) {
+        auto Min = pset.get<std::array<float, 3> >("VolumeMin");
+        auto Max = pset.get<std::array<float, 3> >("VolumeMax");
+        auto NumberOfVoxels = pset.get<std::array<unsigned int, 3> >("NumberOfVoxels");
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            fBox.Min[axis] = Min[axis];
+            fBox.Max[axis] = Max[axis];
+            fNumberOfVoxels[axis] = NumberOfVoxels[axis];
+        }
+        fNumberOfPoints = pset.get<unsigned int>("NumberOfPoints", 1000);
+        fConstant = pset.get<std::array<float, 3> >("Constant");
+        fGradient = pset.get<std::array<float, 9> >("Gradient");
+    }
+
+    void LaserMapInterpolatorTest::beginJob() {
+    }
+
+    void LaserMapInterpolatorTest::endJob() {
+    }
+
+    void LaserMapInterpolatorTest::LinearField(const float Point[3], float Displacement[3]) const {
+        for (unsigned int component = 0; component < 3; component++) {
+            Displacement[component] = fConstant[component];
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                Displacement[component] += fGradient[3 * component + axis] * Point[axis];
+            }
+        }
+    }
+
+    lasercal::LaserDisplacementMap LaserMapInterpolatorTest::MakeMap(const unsigned int NumberOfVoxels[3]) const {
+        lasercal::LaserDisplacementMap Map;
+        Map.Grid = lasercal::LaserVoxelGrid(fBox, NumberOfVoxels);
+        const size_t Size = Map.Grid.NumberOfVoxels();
+        for (auto *Values : {&Map.DisplacementX, &Map.DisplacementY, &Map.DisplacementZ,
+                             &Map.RMSX, &Map.RMSY, &Map.RMSZ}) {
+            Values->assign(Size, 0.f);
+        }
+        Map.Entries.assign(Size, 10);
+        Map.Valid.assign(Size, 1);
+
+        for (size_t voxel_no = 0; voxel_no < Size; voxel_no++) {
+            float Center[3], Displacement[3];
+            Map.Grid.VoxelCenter(voxel_no, Center);
+            LinearField(Center, Displacement);
+            Map.DisplacementX[voxel_no] = Displacement[0];
+            Map.DisplacementY[voxel_no] = Displacement[1];
+            Map.DisplacementZ[voxel_no] = Displacement[2];
+            Map.RMSX[voxel_no] = Map.RMSY[voxel_no] = Map.RMSZ[voxel_no] = 0.5f;
+        }
+        return Map;
+    }
+
+    void LaserMapInterpolatorTest::analyze(const art::Event &event) {
+        std::mt19937 Generator(12345);
+        const float Tolerance = 1e-3;
+
+        // Linear field between the first and the last voxel center, single points and batches
+        lasercal::LaserDisplacementMap Map = MakeMap(fNumberOfVoxels);
+        const lasercal::LaserMapInterpolator Interpolator(Map);
+        const lasercal::LaserVoxelGrid &Grid = Map.Grid;
+
+        std::vector<float> X(fNumberOfPoints), Y(fNumberOfPoints), Z(fNumberOfPoints);
+        std::vector<float> *Coordinates[3] = {&X, &Y, &Z};
+        for (unsigned int axis = 0; axis < 3; axis++) {
+            std::uniform_real_distribution<float> Inside(Grid.Origin[axis] + 0.5f * Grid.Spacing[axis],
+                                                         fBox.Max[axis] - 0.5f * Grid.Spacing[axis]);
+            for (auto &Value : *Coordinates[axis]) Value = Inside(Generator);
+        }
+
+        std::vector<float> CorrectedX(X), CorrectedY(Y), CorrectedZ(Z);
+        Interpolator.Correct(CorrectedX.data(), CorrectedY.data(), CorrectedZ.data(), fNumberOfPoints);
+        for (unsigned int point_no = 0; point_no < fNumberOfPoints; point_no++) {
+            const float Point[3] = {X[point_no], Y[point_no], Z[point_no]};
+            float Expected[3], Displacement[3];
+            LinearField(Point, Expected);
+            Interpolator.GetDisplacement(Point[0], Point[1], Point[2], Displacement);
+            for (unsigned int component = 0; component < 3; component++) {
+                assert(std::fabs(Displacement[component] - Expected[component]) < Tolerance);
+            }
+            assert(std::fabs(CorrectedX[point_no] - X[point_no] - Expected[0]) < Tolerance);
+            assert(std::fabs(CorrectedY[point_no] - Y[point_no] - Expected[1]) < Tolerance);
+            assert(std::fabs(CorrectedZ[point_no] - Z[point_no] - Expected[2]) < Tolerance);
+        }
+
+        // Outside of the centers (and far outside of the grid) the value at the closest border point
+        for (unsigned int point_no = 0; point_no < fNumberOfPoints; point_no++) {
+            float Point[3], Clamped[3];
+            for (unsigned int axis = 0; axis < 3; axis++) {
+                const float First = Grid.Origin[axis] + 0.5f * Grid.Spacing[axis];
+                const float Last = fBox.Max[axis] - 0.5f * Grid.Spacing[axis];
+                std::uniform_real_distribution<float> Around(fBox.Min[axis] - 2 * (fBox.Max[axis] - fBox.Min[axis]),
+                                                             fBox.Max[axis] + 2 * (fBox.Max[axis] - fBox.Min[axis]));
+                Point[axis] = Around(Generator);
+                Clamped[axis] = std::min(std::max(Point[axis], First), Last);
+            }
+            float Expected[3], Displacement[3];
+            LinearField(Clamped, Expected);
+            Interpolator.GetDisplacement(Point[0], Point[1], Point[2], Displacement);
+            for (unsigned int component = 0; component < 3; component++) {
+                assert(std::fabs(Displacement[component] - Expected[component]) < Tolerance);
+            }
+        }
+
+        // Single voxel along y and z: constant along them, still linear along x
+        const unsigned int FlatVoxels[3] = {fNumberOfVoxels[0], 1, 1};
+        lasercal::LaserDisplacementMap FlatMap = MakeMap(FlatVoxels);
+        const lasercal::LaserMapInterpolator Flat(FlatMap);
+        float Center[3];
+        FlatMap.Grid.VoxelCenter(0, Center);
+        for (unsigned int point_no = 0; point_no < fNumberOfPoints; point_no++) {
+            std::uniform_real_distribution<float> Inside(0.f, 1.f);
+            const float Point[3] = {Center[0] + Inside(Generator) * (fBox.Max[0] - fBox.Min[0] - Grid.Spacing[0]),
+                                    fBox.Min[1] + Inside(Generator) * (fBox.Max[1] - fBox.Min[1]),
+                                    fBox.Min[2] + Inside(Generator) * (fBox.Max[2] - fBox.Min[2])};
+            const float OnAxis[3] = {std::min(Point[0], fBox.Max[0] - 0.5f * Grid.Spacing[0]), Center[1], Center[2]};
+            float Expected[3], Displacement[3];
+            LinearField(OnAxis, Expected);
+            Flat.GetDisplacement(Point[0], Point[1], Point[2], Displacement);
+            for (unsigned int component = 0; component < 3; component++) {
+                assert(std::fabs(Displacement[component] - Expected[component]) < Tolerance);
+            }
+        }
+
+        // Unmeasured voxels with a bogus value must not be blended in: one inner voxel and the whole last x layer
+        const float Bogus = 1000.;
+        lasercal::LaserDisplacementMap HoleMap = MakeMap(fNumberOfVoxels);
+        const size_t Hole = Grid.Index(fNumberOfVoxels[0] / 2, fNumberOfVoxels[1] / 2, fNumberOfVoxels[2] / 2);
+        std::vector<size_t> Unmeasured = {Hole};
+        for (unsigned int k = 0; k < fNumberOfVoxels[2]; k++) {
+            for (unsigned int j = 0; j < fNumberOfVoxels[1]; j++) {
+                Unmeasured.push_back(Grid.Index(fNumberOfVoxels[0] - 1, j, k));
+            }
+        }
+        for (auto voxel_no : Unmeasured) {
+            HoleMap.Valid[voxel_no] = 0;
+            HoleMap.DisplacementX[voxel_no] = HoleMap.DisplacementY[voxel_no] = HoleMap.DisplacementZ[voxel_no] = Bogus;
+        }
+        lasercal::LaserMapFile::Write("LaserMapInterpolatorTest.map", HoleMap);
+        std::shared_ptr<const lasercal::LaserMapFile> HoleFile(
+                new lasercal::LaserMapFile("LaserMapInterpolatorTest.map", true));
+        const lasercal::LaserMapInterpolator Holes(HoleMap), FileHoles(HoleFile);
+
+        // Largest displacement of the measured field, the result cannot go beyond
+        float Largest = 0.;
+        for (size_t voxel_no = 0; voxel_no < HoleMap.size(); voxel_no++) {
+            if (!HoleMap.Valid[voxel_no]) continue;
+            Largest = std::max({Largest, std::fabs(HoleMap.DisplacementX[voxel_no]),
+                                std::fabs(HoleMap.DisplacementY[voxel_no]),
+                                std::fabs(HoleMap.DisplacementZ[voxel_no])});
+        }
+
+        float HoleCenter[3];
+        Grid.VoxelCenter(Hole, HoleCenter);
+        for (unsigned int point_no = 0; point_no < fNumberOfPoints; point_no++) {
+            std::uniform_real_distribution<float> Around(-1.5f, 1.5f);
+            const float Point[3] = {HoleCenter[0] + Around(Generator) * Grid.Spacing[0],
+                                    HoleCenter[1] + Around(Generator) * Grid.Spacing[1],
+                                    HoleCenter[2] + Around(Generator) * Grid.Spacing[2]};
+            float Displacement[3], FileDisplacement[3];
+            Holes.GetDisplacement(Point[0], Point[1], Point[2], Displacement);
+            FileHoles.GetDisplacement(Point[0], Point[1], Point[2], FileDisplacement);
+            for (unsigned int component = 0; component < 3; component++) {
+                assert(std::fabs(Displacement[component]) <= Largest + Tolerance);
+                assert(Displacement[component] == FileDisplacement[component]);
+            }
+        }
+
+        // On the hole itself the mean of the measured nodes around it
+        float Displacement[3];
+        Holes.GetDisplacement(HoleCenter[0], HoleCenter[1], HoleCenter[2], Displacement);
+        for (unsigned int component = 0; component < 3; component++) {
+            assert(std::fabs(Displacement[component]) <= Largest + Tolerance);
+        }
+
+        // Between the last measured and the unmeasured x layer the field of the measured layer
+        for (unsigned int point_no = 0; point_no < fNumberOfPoints; point_no++) {
+            std::uniform_real_distribution<float> Inside(0.f, 1.f);
+            const float Point[3] = {fBox.Max[0] - (0.51f + 0.98f * Inside(Generator)) * Grid.Spacing[0],
+                                    Grid.Origin[1] + (0.5f + Inside(Generator) * (Grid.Size[1] - 1)) * Grid.Spacing[1],
+                                    Grid.Origin[2] + (0.5f + Inside(Generator) * (Grid.Size[2] - 1)) * Grid.Spacing[2]};
+            const float LastLayer[3] = {fBox.Max[0] - 1.5f * Grid.Spacing[0], Point[1], Point[2]};
+
+            float Expected[3];
+            LinearField(LastLayer, Expected);
+            Holes.GetDisplacement(Point[0], Point[1], Point[2], Displacement);
+            for (unsigned int component = 0; component < 3; component++) {
+                assert(std::fabs(Displacement[component] - Expected[component]) < Tolerance);
+            }
+        }
+
+        // A map without measurement flags is refused
+        bool Thrown = false;
+        try {
+            lasercal::LaserDisplacementMap Unflagged = MakeMap(fNumberOfVoxels);
+            Unflagged.Valid.clear();
+            lasercal::LaserMapInterpolator Refused(Unflagged);
+        }
+        catch (art::Exception &) {
+            Thrown = true;
+        }
+        assert(Thrown);
+
+        std::cout << "==> Interpolated " << fNumberOfPoints << " points on " << Grid.NumberOfVoxels() << " voxels, "
+                  << Unmeasured.size() << " of them unmeasured" << std::endl;
+    }
+
+    DEFINE_ART_MODULE(LaserMapInterpolatorTest)
+}
+
+#endif //LaserMapInterpolatorTest_Module
@@ -18,6 +18,7 @@
 #include "messagefacility/MessageLogger/MessageLogger.h"
 #include "LaserObjects/LaserHits.h"
 #include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserBeamTable.h"
 
 #include "LaserObjects/LaserUtils.h"
 
@@ -45,6 +46,8 @@ public:
 
     void beginJob() override;
 
+    void beginRun(art::Run const &run) override;
+
 private:
 
 
@@ -52,6 +55,9 @@ private:
     std::vector<std::vector<std::vector<float> > > RawDigitDefs; ///< line by line csv container
     std::string fHitModul, fHitLabel;
     std::string fTestConfigFile;
+
+    bool fFromRunTable;
+    lasercal::LaserBeamTable fLaserBeamTable;
 };
 
 
@@ -67,7 +73,14 @@ void LaserMergerTest::analyze(art::Event const &event) {
     auto id = event.id().event();
     auto DigitTag = art::InputTag(fHitModul, fHitLabel );
 
-    art::ValidHandle <lasercal::LaserBeam> LaserBeam = event.getValidHandle<lasercal::LaserBeam>(DigitTag);
+    std::unique_ptr<lasercal::LaserBeam> LaserBeam;
+    if (fFromRunTable) {
+        // Same checks as for the event product, the table has to give back the same beam
+        assert(fLaserBeamTable.HasBeam(id));
+        LaserBeam.reset(new lasercal::LaserBeam(fLaserBeamTable.GetBeam(id)));
+    } else {
+        LaserBeam.reset(new lasercal::LaserBeam(*event.getValidHandle<lasercal::LaserBeam>(DigitTag)));
+    }
 
 
     if (fTestConfigFile.compare("HitDefs-10000.txt") == 0) {
@@ -95,10 +108,21 @@ void LaserMergerTest::reconfigure(fhicl::ParameterSet const &pset) {
     fHitModul = pset.get<std::string>("MergerModul");
     fHitLabel = pset.get<std::string>("MergerLabel");
     fTestConfigFile = pset.get<std::string>("TestConfigFile");
+    fFromRunTable = pset.get<bool>("FromRunTable", false);
 }
 
 void LaserMergerTest::beginJob() {
 }
 
+void LaserMergerTest::beginRun(art::Run const &run) {
+    if (fFromRunTable) {
+        auto TableTag = art::InputTag(fHitModul, "LaserBeamTable");
+        fLaserBeamTable = *run.getValidHandle<lasercal::LaserBeamTable>(TableTag);
+
+        std::cout << "==> Testing run-level table with " << fLaserBeamTable.NumberOfBeams() << " beams" << std::endl;
+        assert(fLaserBeamTable.NumberOfBeams() > 0);
+    }
+}
+
 
 DEFINE_ART_MODULE(LaserMergerTest)
@@ -0,0 +1,180 @@
+#ifndef LaserSparseHist2DTest_Module
+#define LaserSparseHist2DTest_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Utilities/Exception.h"
+
+#include "LaserObjects/LaserSparseHist2D.h"
+
+#include <TH2D.h>
+#include <TFile.h>
+#include <TROOT.h>
+
+#include <assert.h>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ *  Fills a sparse and a dense histogram with the same values, including bin edges, under- and overflow in both axes,
+ *  and checks that the copy of the sparse histogram has the same content in every bin (under- and overflow
+ *  included) and the same number of entries as the dense one. The copy is also written as by HitAna, into its own
+ *  subdirectory of a file while another directory is current, and read back from the closed file.
+ */
+
+namespace LaserSparseHist2DTest {
+
+    class LaserSparseHist2DTest : public art::EDAnalyzer {
+
+    public:
+        explicit LaserSparseHist2DTest(fhicl::ParameterSet const& pset);
+        virtual ~LaserSparseHist2DTest();
+
+        virtual void analyze(const art::Event& event) override;
+
+        virtual void beginJob() override;
+
+        virtual void endJob() override;
+
+        virtual void reconfigure(fhicl::ParameterSet const &p) override;
+
+    private:
+        int fNumberOfBinsX, fNumberOfBinsY;
+        std::array<double, 2> fRangeX, fRangeY;
+        std::string fOutputFile;
+
+    protected:
+    };
+
+    LaserSparseHist2DTest::LaserSparseHist2DTest(fhicl::ParameterSet const& pset) : EDAnalyzer(pset) {
+            this->reconfigure(pset);
+    }
+
+    LaserSparseHist2DTest::~LaserSparseHist2DTest() {
+    }
+
+    void LaserSparseHist2DTest::reconfigure(fhicl::ParameterSet const &pset) {
+        fNumberOfBinsX = pset.get<int>("NumberOfBinsX", 40);
+        fNumberOfBinsY = pset.get<int>("NumberOfBinsY", 25);
+        fRangeX = pset.get<std::array<double, 2> >("RangeX");
+        fRangeY = pset.get<std::array<double, 2> >("RangeY");
+        fOutputFile = pset.get<std::string>("OutputFile", "LaserSparseHist2DTest.root");
+    }
+
+    void LaserSparseHist2DTest::beginJob() {
+    }
+
+    void LaserSparseHist2DTest::endJob() {
+    }
+
+    void LaserSparseHist2DTest::analyze(const art::Event &event) {
+        // Not owned by any directory, both histograms live only in this test
+        TH1::AddDirectory(false);
+
+        lasercal::LaserSparseHist2D Sparse("Sparse", "Sparse", fNumberOfBinsX, fRangeX[0], fRangeX[1],
+                                           fNumberOfBinsY, fRangeY[0], fRangeY[1]);
+        TH2D Dense("Dense", "Dense", fNumberOfBinsX, fRangeX[0], fRangeX[1], fNumberOfBinsY, fRangeY[0], fRangeY[1]);
+
+        const double WidthX = (fRangeX[1] - fRangeX[0]) / fNumberOfBinsX;
+        const double WidthY = (fRangeY[1] - fRangeY[0]) / fNumberOfBinsY;
+
+        // Bin centers, low edges, under- and overflow (the upper edge itself is overflow) in both axes
+        std::vector<double> ValuesX = {fRangeX[0] + 0.5 * WidthX, fRangeX[0] + 3.5 * WidthX, fRangeX[0],
+                                       fRangeX[0] + 7 * WidthX, fRangeX[1] - 0.5 * WidthX,
+                                       fRangeX[0] - WidthX, fRangeX[1], fRangeX[1] + 10 * WidthX};
+        std::vector<double> ValuesY = {fRangeY[0] + 0.5 * WidthY, fRangeY[0] + 2.5 * WidthY, fRangeY[0],
+                                       fRangeY[1] - 0.5 * WidthY, fRangeY[0] - 3 * WidthY, fRangeY[1]};
+
+        size_t Fills = 0;
+        for (size_t x_no = 0; x_no < ValuesX.size(); x_no++) {
+            for (size_t y_no = 0; y_no < ValuesY.size(); y_no++) {
+                // Some bins get several fills with different weights
+                for (size_t repeat = 0; repeat <= (x_no + y_no) % 3; repeat++) {
+                    float Weight = 0.5f * (1 + (x_no * 7 + y_no * 3 + repeat) % 5);
+                    Sparse.Fill(ValuesX[x_no], ValuesY[y_no], Weight);
+                    Dense.Fill(ValuesX[x_no], ValuesY[y_no], Weight);
+                    Fills++;
+                }
+            }
+        }
+        assert(Sparse.GetEntries() == Fills);
+        assert(Sparse.NumberOfFilledBins() <= ValuesX.size() * ValuesY.size());
+
+        TH2D Copy("Copy", "Copy", Sparse.GetNbinsX(), Sparse.GetXmin(), Sparse.GetXmax(),
+                  Sparse.GetNbinsY(), Sparse.GetYmin(), Sparse.GetYmax());
+        Sparse.CopyTo(Copy);
+
+        double Underflow = 0., Overflow = 0.;
+        for (int bin_x = 0; bin_x <= fNumberOfBinsX + 1; bin_x++) {
+            for (int bin_y = 0; bin_y <= fNumberOfBinsY + 1; bin_y++) {
+                // The weights are exact in float, so the sums have to agree exactly
+                assert(Copy.GetBinContent(bin_x, bin_y) == Dense.GetBinContent(bin_x, bin_y));
+                assert(Sparse.GetBinContent(bin_x, bin_y) == Dense.GetBinContent(bin_x, bin_y));
+                if (bin_x == 0 || bin_y == 0) Underflow += Copy.GetBinContent(bin_x, bin_y);
+                if (bin_x == fNumberOfBinsX + 1 || bin_y == fNumberOfBinsY + 1) {
+                    Overflow += Copy.GetBinContent(bin_x, bin_y);
+                }
+            }
+        }
+        assert(Underflow > 0. && Overflow > 0.);
+        assert(Copy.GetEntries() == Dense.GetEntries());
+        assert(std::fabs(Copy.GetSumOfWeights() - Dense.GetSumOfWeights()) < 1e-9);
+
+        // A histogram with another binning is refused
+        bool Thrown = false;
+        try {
+            TH2D Other("Other", "Other", fNumberOfBinsX + 1, fRangeX[0], fRangeX[1],
+                       fNumberOfBinsY, fRangeY[0], fRangeY[1]);
+            Sparse.CopyTo(Other);
+        }
+        catch (art::Exception &) {
+            Thrown = true;
+        }
+        assert(Thrown);
+
+        // Histogram booked in a subdirectory, but the current directory is another one (as after TFileService::make)
+        {
+            std::unique_ptr<TFile> Output(TFile::Open(fOutputFile.c_str(), "RECREATE"));
+            assert(Output && !Output->IsZombie());
+            TDirectory *Module = Output->mkdir("Module");
+            Output->mkdir("Other")->cd();
+
+            TH2D *Booked = new TH2D(Sparse.GetName().c_str(), Sparse.GetTitle().c_str(),
+                                    Sparse.GetNbinsX(), Sparse.GetXmin(), Sparse.GetXmax(),
+                                    Sparse.GetNbinsY(), Sparse.GetYmin(), Sparse.GetYmax());
+            Booked->SetDirectory(Module);
+            Sparse.WriteTo(Booked);
+            assert(!Module->FindObject(Sparse.GetName().c_str()));
+            gROOT->cd();
+            Output->Close();
+        }
+        {
+            std::unique_ptr<TFile> Input(TFile::Open(fOutputFile.c_str(), "READ"));
+            assert(Input && !Input->IsZombie());
+            TH2D *Written = dynamic_cast<TH2D *>(Input->Get(("Module/" + Sparse.GetName()).c_str()));
+            assert(Written);
+            assert(!Input->Get(("Other/" + Sparse.GetName()).c_str()));
+            for (int bin_x = 0; bin_x <= fNumberOfBinsX + 1; bin_x++) {
+                for (int bin_y = 0; bin_y <= fNumberOfBinsY + 1; bin_y++) {
+                    assert(Written->GetBinContent(bin_x, bin_y) == Dense.GetBinContent(bin_x, bin_y));
+                }
+            }
+            assert(Written->GetEntries() == Dense.GetEntries());
+        }
+        std::remove(fOutputFile.c_str());
+
+        std::cout << "==> " << Fills << " fills in " << Sparse.NumberOfFilledBins() << " sparse bins, sum "
+                  << Copy.GetSumOfWeights() << " (under " << Underflow << ", over " << Overflow << ")" << std::endl;
+    }
+
+    DEFINE_ART_MODULE(LaserSparseHist2DTest)
+}
+
+#endif //LaserSparseHist2DTest_Module
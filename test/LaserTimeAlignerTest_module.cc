@@ -0,0 +1,153 @@
+#ifndef LaserTimeAlignerTest_Module
+#define LaserTimeAlignerTest_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Utilities/Exception.h"
+
+#include "LaserObjects/LaserDataFile.h"
+#include "LaserObjects/LaserTimeAligner.h"
+
+#include <assert.h>
+#include <cmath>
+#include <vector>
+
+/*
+ *  Matches a synthetic DAQ event stream to a list of laser triggers with a clock offset and a slow drift. The stream
+ *  misses one laser trigger, has an event far from any trigger and a second event next to an already matched trigger,
+ *  which has to be rejected. Streams not starting at the first event or not in time order have to throw.
+ */
+
+namespace LaserTimeAlignerTest {
+
+    class LaserTimeAlignerTest : public art::EDAnalyzer {
+
+    public:
+        explicit LaserTimeAlignerTest(fhicl::ParameterSet const& pset);
+        virtual ~LaserTimeAlignerTest();
+
+        virtual void analyze(const art::Event& event) override;
+
+        virtual void beginJob() override;
+
+        virtual void endJob() override;
+
+        virtual void reconfigure(fhicl::ParameterSet const &p) override;
+
+    private:
+        unsigned int fNumberOfTriggers;
+        double fTriggerPeriod;
+        double fClockOffset;
+        double fClockDrift;
+
+    protected:
+    };
+
+    LaserTimeAlignerTest::LaserTimeAlignerTest(fhicl::ParameterSet const& pset) : EDAnalyzer(pset) {
+            this->reconfigure(pset);
+    }
+
+    LaserTimeAlignerTest::~LaserTimeAlignerTest() {
+    }
+
+    void LaserTimeAlignerTest::reconfigure(fhicl::ParameterSet const &pset) {
+        fNumberOfTriggers = pset.get<unsigned int>("NumberOfTriggers", 20);
+        fTriggerPeriod = pset.get<double>("TriggerPeriod", 2.);
+        fClockOffset = pset.get<double>("ClockOffset", 5000.3);
+        fClockDrift = pset.get<double>("ClockDrift", 1e-4);
+    }
+
+    void LaserTimeAlignerTest::beginJob() {
+    }
+
+    void LaserTimeAlignerTest::endJob() {
+    }
+
+    void LaserTimeAlignerTest::analyze(const art::Event &event) {
+        // Laser triggers at 1000 s (laser clock), the laser data lines are written in order
+        std::vector<lasercal::LaserDataRecord> LaserData(fNumberOfTriggers);
+        std::vector<double> LaserTimes(fNumberOfTriggers);
+        for (unsigned int trigger_no = 0; trigger_no < fNumberOfTriggers; trigger_no++) {
+            LaserTimes[trigger_no] = 1000. + trigger_no * fTriggerPeriod;
+            LaserData[trigger_no] = lasercal::LaserDataRecord();
+            LaserData[trigger_no].TriggerTimeSec = (int64_t) LaserTimes[trigger_no];
+            LaserData[trigger_no].TriggerTimeUsec =
+                    (int64_t) std::round(1e6 * (LaserTimes[trigger_no] - LaserData[trigger_no].TriggerTimeSec));
+            LaserData[trigger_no].TriggerCount = (int32_t) trigger_no + 100;
+        }
+
+        // DAQ clock runs ahead of the laser clock by an offset and drifts slowly
+        auto DaqSec = [this](double LaserTime) {
+            return (unsigned long) (LaserTime + fClockOffset + fClockDrift * (LaserTime - 1000.));
+        };
+        auto DaqNsec = [this](double LaserTime) {
+            double Time = LaserTime + fClockOffset + fClockDrift * (LaserTime - 1000.);
+            return (unsigned long) std::round(1e9 * (Time - std::floor(Time)));
+        };
+
+        const unsigned int MissingTrigger = 7;
+        const unsigned int DuplicateTrigger = 12;
+        const unsigned int LonelyTrigger = 15;
+
+        lasercal::LaserTimeAligner Aligner(LaserData, 0.1, 0.1);
+        unsigned int EventNumber = 0;
+        for (unsigned int trigger_no = 0; trigger_no < fNumberOfTriggers; trigger_no++) {
+            if (trigger_no == MissingTrigger) continue;
+
+            double LaserTime = LaserTimes[trigger_no];
+            assert(Aligner.Match(EventNumber++, DaqSec(LaserTime), DaqNsec(LaserTime)) == (int) trigger_no);
+
+            // Second event close to the same trigger gets no laser data
+            if (trigger_no == DuplicateTrigger) {
+                assert(Aligner.Match(EventNumber++, DaqSec(LaserTime + 0.04), DaqNsec(LaserTime + 0.04)) == -1);
+            }
+            // Event in the middle between two triggers
+            if (trigger_no == LonelyTrigger) {
+                double Between = LaserTime + 0.5 * fTriggerPeriod;
+                assert(Aligner.Match(EventNumber++, DaqSec(Between), DaqNsec(Between)) == -1);
+            }
+        }
+
+        assert(Aligner.GetNumberOfMatches() == fNumberOfTriggers - 1);
+        assert(Aligner.GetNumberOfMisses() == 1);
+        assert(Aligner.GetNumberOfDuplicates() == 1);
+        assert(Aligner.GetNumberOfSkippedTriggers() == 1);
+        assert(Aligner.GetNumberOfCounterJumps() == 0);
+        assert(std::fabs(Aligner.GetResidualMean()) < 0.01);
+        Aligner.PrintSummary();
+
+        // The clock offset needs the first event of the run
+        bool Thrown = false;
+        try {
+            lasercal::LaserTimeAligner LateStart(LaserData);
+            LateStart.Match(3, DaqSec(LaserTimes[3]), DaqNsec(LaserTimes[3]));
+        }
+        catch (art::Exception &) {
+            Thrown = true;
+        }
+        assert(Thrown);
+
+        // Events have to come in time order
+        Thrown = false;
+        try {
+            lasercal::LaserTimeAligner Unordered(LaserData);
+            Unordered.Match(0, DaqSec(LaserTimes[0]), DaqNsec(LaserTimes[0]));
+            Unordered.Match(1, DaqSec(LaserTimes[2]), DaqNsec(LaserTimes[2]));
+            Unordered.Match(2, DaqSec(LaserTimes[1]), DaqNsec(LaserTimes[1]));
+        }
+        catch (art::Exception &) {
+            Thrown = true;
+        }
+        assert(Thrown);
+
+        std::cout << "==> Matched " << Aligner.GetNumberOfMatches() << " of " << EventNumber << " events to "
+                  << fNumberOfTriggers << " laser triggers" << std::endl;
+    }
+
+    DEFINE_ART_MODULE(LaserTimeAlignerTest)
+}
+
+#endif //LaserTimeAlignerTest_Module
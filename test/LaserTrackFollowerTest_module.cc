@@ -0,0 +1,185 @@
+#ifndef LaserTrackFollowerTest_Module
+#define LaserTrackFollowerTest_Module
+
+#include "fhiclcpp/ParameterSet.h"
+
+#include "art/Framework/Core/ModuleMacros.h"
+#include "art/Framework/Core/EDAnalyzer.h"
+#include "art/Framework/Principal/Event.h"
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+
+#include "larcore/Geometry/Geometry.h"
+#include "lardata/DetectorInfoServices/DetectorPropertiesService.h"
+#include "lardata/RawData/RawDigit.h"
+
+#include "LaserObjects/LaserBeam.h"
+#include "LaserObjects/LaserParameters.h"
+#include "LaserObjects/LaserTrackFollower.h"
+
+#include <TVector3.h>
+
+#include <assert.h>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <vector>
+
+/*
+ *  Generates the raw digits of a straight laser track on the collection plane, with a kink in the drift time halfway
+ *  along the track which is larger than the narrow tick window. The track follower has to find exactly one hit at
+ *  the generated time tick on every wire of the track, after widening its window at the kink, and may only decode
+ *  the wires along the track.
+ */
+
+namespace LaserTrackFollowerTest {
+
+    class LaserTrackFollowerTest : public art::EDAnalyzer {
+
+    public:
+        explicit LaserTrackFollowerTest(fhicl::ParameterSet const& pset);
+        virtual ~LaserTrackFollowerTest();
+
+        virtual void analyze(const art::Event& event) override;
+
+        virtual void beginJob() override;
+
+        virtual void endJob() override;
+
+        virtual void reconfigure(fhicl::ParameterSet const &p) override;
+
+    private:
+        lasercal::LaserRecoParameters fParameters;
+        std::array<float, 3> fLaserPosition;
+        std::array<float, 3> fLaserDirection;
+        float fKinkTicks;
+        float fAmplitude;
+        float fWidth;
+
+    protected:
+    };
+
+    LaserTrackFollowerTest::LaserTrackFollowerTest(fhicl::ParameterSet const& pset) : EDAnalyzer(pset) {
+            this->reconfigure(pset);
+    }
+
+    LaserTrackFollowerTest::~LaserTrackFollowerTest() {
+    }
+
+    void LaserTrackFollowerTest::reconfigure(fhicl::ParameterSet const &pset) {
+        fLaserPosition = pset.get<std::array<float, 3> >("LaserPosition");
+        fLaserDirection = pset.get<std::array<float, 3> >("LaserDirection");
+        fKinkTicks = pset.get<float>("KinkTicks", 40.);
+        fAmplitude = pset.get<float>("Amplitude", 200.);
+        fWidth = pset.get<float>("Width", 4.);
+
+        // Hit finder and follower settings as in LaserReco
+        fParameters.WireMapGenerator = false;
+        fParameters.UseROI = false;
+        fParameters.HitBoxSize = pset.get<float>("HitBoxSize", 100.);
+        fParameters.MinAllowedChanStatus = pset.get<int>("MinAllowedChannelStatus", 0);
+        fParameters.HighAmplitudeThreshold = pset.get<float>("HighAmplThreshold");
+
+        fParameters.UHitThreshold = pset.get<float>("UHitPeakThreshold");
+        fParameters.UAmplitudeToWidthRatio = pset.get<float>("UAmplitudeToWidthRatio");
+        fParameters.UHitWidthThreshold = pset.get<int>("UHitWidthThreshold");
+
+        fParameters.VHitThreshold = pset.get<float>("VHitPeakThreshold");
+        fParameters.VAmplitudeToWidthRatio = pset.get<float>("VAmplitudeToWidthRatio");
+        fParameters.VAmplitudeToRMSRatio = pset.get<float>("VAmplitudeToRMSRatio");
+        fParameters.VHitWidthThreshold = pset.get<int>("VHitWidthThreshold");
+        fParameters.VRMSThreshold = pset.get<int>("VRMSThreshold");
+
+        fParameters.YHitThreshold = pset.get<float>("YHitPeakThreshold");
+        fParameters.YAmplitudeToWidthRatio = pset.get<float>("YAmplitudeToWidthRatio");
+        fParameters.YHitWidthThreshold = pset.get<int>("YHitWidthThreshold");
+
+        fParameters.UseTrackFollower = true;
+        fParameters.FollowerSeedWires = pset.get<unsigned int>("FollowerSeedWires", 5);
+        fParameters.FollowerSeedTickWindow = pset.get<float>("FollowerSeedTickWindow", 100.);
+        fParameters.FollowerTickWindow = pset.get<float>("FollowerTickWindow", 15.);
+        fParameters.FollowerMaxTickWindow = pset.get<float>("FollowerMaxTickWindow", 120.);
+        fParameters.FollowerFitPoints = pset.get<unsigned int>("FollowerFitPoints", 10);
+        fParameters.FollowerMaxMisses = pset.get<unsigned int>("FollowerMaxMisses", 20);
+    }
+
+    void LaserTrackFollowerTest::beginJob() {
+    }
+
+    void LaserTrackFollowerTest::endJob() {
+    }
+
+    void LaserTrackFollowerTest::analyze(const art::Event &event) {
+        const geo::GeometryCore *Geometry = &*(art::ServiceHandle<geo::Geometry>());
+        const detinfo::DetectorProperties *DetProperties = lar::providerFrom<detinfo::DetectorPropertiesService>();
+        const unsigned int Plane = 2;
+        const unsigned int NumberOfTicks = DetProperties->NumberTimeSamples();
+
+        const TVector3 Position(fLaserPosition[0], fLaserPosition[1], fLaserPosition[2]);
+        const TVector3 Direction(fLaserDirection[0], fLaserDirection[1], fLaserDirection[2]);
+        const lasercal::LaserBeam Beam(Position, Direction);
+
+        // Same entry and exit wires as the follower
+        TVector3 EntryPoint = Beam.GetEntryPoint();
+        TVector3 ExitPoint = Beam.GetExitPoint();
+        double Entry[] = {EntryPoint[0], EntryPoint[1], EntryPoint[2]};
+        double Exit[] = {ExitPoint[0], ExitPoint[1], ExitPoint[2]};
+        unsigned int EntryWire = Geometry->NearestWireID(Entry, geo::PlaneID(0, 0, Plane)).Wire;
+        unsigned int ExitWire = Geometry->NearestWireID(Exit, geo::PlaneID(0, 0, Plane)).Wire;
+        assert(ExitWire > EntryWire + 2 * fParameters.FollowerSeedWires);
+
+        // Gaussian pulse on every collection wire of the track, at the drift time of the beam at the wire position
+        std::vector<raw::RawDigit> RawDigits;
+        std::map<unsigned int, int> GeneratedTicks;
+        const unsigned int KinkWire = (EntryWire + ExitWire) / 2;
+        for (unsigned int wire_no = EntryWire; wire_no <= ExitWire; wire_no++) {
+            double WireCenter[3];
+            Geometry->WireIDToWireGeo(geo::WireID(0, 0, Plane, wire_no)).GetCenter(WireCenter);
+            TVector3 BeamPoint = Position + ((WireCenter[2] - Position.Z()) / Direction.Z()) * Direction;
+
+            float Tick = DetProperties->ConvertXToTicks(BeamPoint.X(), Plane, 0, 0);
+            if (wire_no >= KinkWire) Tick += fKinkTicks;
+            int CenterTick = (int) std::round(Tick);
+            if (CenterTick < 0 || CenterTick >= (int) NumberOfTicks) continue;
+
+            raw::RawDigit::ADCvector_t ADC(NumberOfTicks, 0);
+            for (int tick = std::max(CenterTick - (int) (5 * fWidth), 0);
+                 tick < std::min(CenterTick + (int) (5 * fWidth) + 1, (int) NumberOfTicks); tick++) {
+                float Distance = (tick - CenterTick) / fWidth;
+                ADC[tick] = (short) std::round(fAmplitude * std::exp(-0.5 * Distance * Distance));
+            }
+
+            raw::ChannelID_t Channel = Geometry->PlaneWireToChannel(Plane, wire_no, 0, 0);
+            RawDigits.emplace_back(Channel, NumberOfTicks, ADC);
+            GeneratedTicks[wire_no] = CenterTick;
+        }
+        assert(GeneratedTicks.size() > 0);
+
+        lasercal::LaserTrackFollower Follower(fParameters, Beam);
+        Follower.Follow(RawDigits, false);
+
+        // Only the wires of the track are decoded, the other planes have no data
+        assert(Follower.GetNumberOfDecodedWires() == GeneratedTicks.size());
+        assert(Follower.GetPlaneHits(0)->empty());
+        assert(Follower.GetPlaneHits(1)->empty());
+
+        // Exactly one hit at the generated tick on every wire, also behind the kink
+        auto Hits = Follower.GetPlaneHits(Plane);
+        std::map<unsigned int, unsigned int> HitsPerWire;
+        for (const auto &Hit : *Hits) {
+            unsigned int Wire = Hit.WireID().Wire;
+            assert(GeneratedTicks.count(Wire));
+            assert(std::fabs(Hit.PeakTime() - GeneratedTicks[Wire]) <= 1.);
+            HitsPerWire[Wire]++;
+        }
+        assert(HitsPerWire.size() == GeneratedTicks.size());
+        for (const auto &Wire : HitsPerWire) assert(Wire.second == 1);
+
+        std::cout << "==> Followed " << Hits->size() << " hits on " << GeneratedTicks.size() << " wires (wires "
+                  << EntryWire << " to " << ExitWire << ", kink at " << KinkWire << ")" << std::endl;
+    }
+
+    DEFINE_ART_MODULE(LaserTrackFollowerTest)
+}
+
+#endif //LaserTrackFollowerTest_Module